@@ -0,0 +1,341 @@
+#include "benchmarks.h"
+#include "spatial_hash.h"
+#include "kd_tree.h"
+#include "point_cloud.h"
+#include "proximity_service.h"
+#include "normals.h"
+
+#include <glm.hpp>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double elapsed_ms( Clock::time_point start )
+{
+	return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+namespace
+{
+	// Puts std::cout's number format back when a report is done with it, so later log lines aren't affected
+	struct CoutFormat
+	{
+		CoutFormat() : flags( std::cout.flags() ), precision( std::cout.precision() ) {}
+		~CoutFormat() { std::cout.flags( flags ); std::cout.precision( precision ); }
+
+		std::ios::fmtflags flags;
+		std::streamsize precision;
+	};
+}
+
+void benchmark_spatial_hash()
+{
+	CoutFormat restore_format;
+	const float target_radius = 0.01f;
+	const float probe_radius = 0.04f;
+	const int num_probes = 1000;
+	const size_t target_counts[] = { 10, 100, 1000, 10000, 100000 };
+
+	// Targets and probes spread through a 2m cube, roughly the size of the play area
+	std::mt19937 rng( 1234 );
+	std::uniform_real_distribution<float> dist( -1.0f, 1.0f );
+
+	std::vector<glm::vec3> probes( num_probes );
+	for( glm::vec3& p : probes ) p = glm::vec3( dist( rng ), dist( rng ), dist( rng ) );
+
+	std::cout << "BENCHMARK: spatial hash, " << num_probes << " probes, times are per probe" << std::endl;
+	std::cout << std::setw( 10 ) << "targets"
+		<< std::setw( 14 ) << "brute tests" << std::setw( 14 ) << "brute (us)"
+		<< std::setw( 14 ) << "hash tests" << std::setw( 14 ) << "hash (us)"
+		<< std::setw( 14 ) << "build (ms)" << std::setw( 8 ) << "hits" << std::endl;
+
+	std::vector<unsigned int> candidates;
+	for( size_t num_targets : target_counts )
+	{
+		std::vector<glm::vec3> targets( num_targets );
+		for( glm::vec3& t : targets ) t = glm::vec3( dist( rng ), dist( rng ), dist( rng ) );
+
+		const float touch_distance = target_radius + probe_radius;
+
+		// Test every target against every probe, what Scene::update used to do
+		size_t brute_hits = 0;
+		Clock::time_point start = Clock::now();
+		for( const glm::vec3& p : probes )
+		{
+			for( const glm::vec3& t : targets )
+			{
+				if( glm::length( t - p ) <= touch_distance ) brute_hits++;
+			}
+		}
+		double brute_ms = elapsed_ms( start );
+
+		// Build the hash then only test the candidates
+		start = Clock::now();
+		SpatialHash hash( 0.1f );
+		for( size_t i = 0; i < targets.size(); i++ ) hash.insert( (unsigned int)i, targets[i] );
+		double build_ms = elapsed_ms( start );
+
+		size_t hash_hits = 0;
+		size_t hash_tests = 0;
+		start = Clock::now();
+		for( const glm::vec3& p : probes )
+		{
+			candidates.clear();
+			hash.query( p, touch_distance, candidates );
+			hash_tests += candidates.size();
+			for( unsigned int i : candidates )
+			{
+				if( glm::length( targets[i] - p ) <= touch_distance ) hash_hits++;
+			}
+		}
+		double hash_ms = elapsed_ms( start );
+
+		if( brute_hits != hash_hits )
+		{
+			std::cout << "ERROR: spatial hash found " << hash_hits << " hits, expected " << brute_hits << std::endl;
+		}
+
+		std::cout << std::fixed << std::setprecision( 3 )
+			<< std::setw( 10 ) << num_targets
+			<< std::setw( 14 ) << num_targets << std::setw( 14 ) << brute_ms * 1000.0 / num_probes
+			<< std::setw( 14 ) << (double)hash_tests / num_probes << std::setw( 14 ) << hash_ms * 1000.0 / num_probes
+			<< std::setw( 14 ) << build_ms << std::setw( 8 ) << hash_hits << std::endl;
+	}
+}
+
+void benchmark_kd_tree()
+{
+	CoutFormat restore_format;
+	const int num_queries = 10000;
+	const size_t k = 8;
+	const size_t point_counts[] = { 100000, 1000000, 10000000 };
+
+	std::mt19937 rng( 1234 );
+	std::uniform_real_distribution<float> dist( -1.0f, 1.0f );
+
+	std::vector<glm::vec3> queries( num_queries );
+	for( glm::vec3& q : queries ) q = glm::vec3( dist( rng ), dist( rng ), dist( rng ) );
+
+	std::cout << "BENCHMARK: k-d tree, " << num_queries << " queries, times are per query" << std::endl;
+	std::cout << std::setw( 10 ) << "points" << std::setw( 14 ) << "build (ms)"
+		<< std::setw( 14 ) << "nearest (us)" << std::setw( 14 ) << "8 nearest (us)" << std::endl;
+
+	std::vector<int> results;
+	for( size_t num_points : point_counts )
+	{
+		// Same XYZRGB layout as the point cloud
+		std::vector<GLfloat> data( num_points * 6 );
+		for( size_t i = 0; i < num_points; i++ )
+		{
+			data[i * 6 + 0] = dist( rng );
+			data[i * 6 + 1] = dist( rng );
+			data[i * 6 + 2] = dist( rng );
+		}
+
+		KdTree tree;
+		tree.build( data, 6 );
+
+		// Sum the results so the queries can't be optimised away
+		long long checksum = 0;
+		Clock::time_point start = Clock::now();
+		for( const glm::vec3& q : queries ) checksum += tree.nearest( q );
+		double nearest_ms = elapsed_ms( start );
+
+		start = Clock::now();
+		for( const glm::vec3& q : queries )
+		{
+			tree.nearest( q, k, results );
+			checksum += results.size();
+		}
+		double k_nearest_ms = elapsed_ms( start );
+
+		std::cout << std::fixed << std::setprecision( 3 )
+			<< std::setw( 10 ) << num_points << std::setw( 14 ) << tree.buildTime()
+			<< std::setw( 14 ) << nearest_ms * 1000.0 / num_queries
+			<< std::setw( 14 ) << k_nearest_ms * 1000.0 / num_queries
+			<< "  (" << checksum << ")" << std::endl;
+	}
+}
+
+void benchmark_raycast( const PointCloud& point_cloud )
+{
+	CoutFormat restore_format;
+	const KdTree& tree = point_cloud.kdTree();
+	if( tree.empty() )
+	{
+		std::cout << "BENCHMARK: no point cloud loaded" << std::endl;
+		return;
+	}
+
+	const int num_rays = 100000;
+
+	// Rays start on a sphere around the cloud and aim at random points inside its bounds,
+	// everything is in the space the points were loaded in so the radius is relative to the size
+	glm::vec3 lower = glm::min( point_cloud.lowerBound(), point_cloud.upperBound() );
+	glm::vec3 upper = glm::max( point_cloud.lowerBound(), point_cloud.upperBound() );
+	glm::vec3 centre = (lower + upper) * 0.5f;
+	float size = glm::length( upper - lower );
+	float radius = size * 0.001f;
+
+	std::mt19937 rng( 1234 );
+	std::uniform_real_distribution<float> dist( -1.0f, 1.0f );
+	std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+
+	std::vector<glm::vec3> origins( num_rays );
+	std::vector<glm::vec3> directions( num_rays );
+	for( int i = 0; i < num_rays; i++ )
+	{
+		glm::vec3 offset = glm::normalize( glm::vec3( dist( rng ), dist( rng ), dist( rng ) ) + glm::vec3( 0.0f, 0.0f, 1e-6f ) );
+		origins[i] = centre + offset * size;
+		glm::vec3 target = lower + (upper - lower) * glm::vec3( unit( rng ), unit( rng ), unit( rng ) );
+		directions[i] = glm::normalize( target - origins[i] );
+	}
+
+	auto cast_rays = [&]( size_t first, size_t last, size_t* hits ) {
+		KdTree::RayHit hit;
+		for( size_t i = first; i < last; i++ )
+		{
+			if( tree.raycast( origins[i], directions[i], radius, size * 2.0f, &hit ) ) (*hits)++;
+		}
+	};
+
+	std::cout << "BENCHMARK: ray cast against " << tree.size() << " points, " << num_rays << " rays, point radius " << radius << std::endl;
+
+	size_t hits = 0;
+	Clock::time_point start = Clock::now();
+	cast_rays( 0, num_rays, &hits );
+	double single_ms = elapsed_ms( start );
+
+	unsigned int num_threads = std::max( 1u, std::thread::hardware_concurrency() );
+	std::vector<size_t> thread_hits( num_threads, 0 );
+	std::vector<std::thread> threads;
+	size_t chunk = (num_rays + num_threads - 1) / num_threads;
+	start = Clock::now();
+	for( unsigned int t = 0; t < num_threads; t++ )
+	{
+		size_t first = std::min( (size_t)num_rays, chunk * t );
+		size_t last = std::min( (size_t)num_rays, first + chunk );
+		threads.push_back( std::thread( cast_rays, first, last, &thread_hits[t] ) );
+	}
+	for( auto& thread : threads ) thread.join();
+	double multi_ms = elapsed_ms( start );
+
+	std::cout << std::fixed << std::setprecision( 0 )
+		<< "\t1 thread: " << num_rays / (single_ms / 1000.0) << " rays/s, "
+		<< std::setprecision( 3 ) << single_ms * 1000.0 / num_rays << "us per ray, "
+		<< std::setprecision( 1 ) << 100.0 * hits / num_rays << "% hit" << std::endl;
+	std::cout << std::setprecision( 0 )
+		<< "\t" << num_threads << " threads: " << num_rays / (multi_ms / 1000.0) << " rays/s" << std::endl;
+}
+
+namespace
+{
+	// Stands in for the controller, remembers every pulse it is given
+	class RecordingSink : public HapticsSink
+	{
+	public:
+		void pulse( const HapticPulse& pulse ) override { pulses.push_back( pulse ); }
+		std::vector<HapticPulse> pulses;
+	};
+}
+
+void replay_proximity( const PointCloud& point_cloud, const std::string& filepath )
+{
+	std::vector<ProximityService::PoseSample> poses;
+	if( !ProximityService::loadRecording( filepath, poses ) || poses.empty() ) return;
+
+	std::cout << "REPLAY: blocking for " << poses.back().time - poses.front().time << "s while the recording plays" << std::endl;
+
+	ProximityService proximity;
+	RecordingSink sink;
+	proximity.start( &point_cloud );
+
+	// Publish and drain at the rate the poses were recorded, restamped to now so they aren't too old
+	Clock::time_point start = Clock::now();
+	for( const ProximityService::PoseSample& recorded : poses )
+	{
+		std::this_thread::sleep_until( start + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( recorded.time - poses.front().time ) ) );
+
+		ProximityService::PoseSample pose = recorded;
+		pose.time = ProximityService::now();
+		proximity.publish( pose );
+		proximity.drain( sink );
+	}
+
+	double ms = elapsed_ms( start );
+	unsigned int queries_per_second = proximity.queriesPerSecond();
+	proximity.stop();
+
+	unsigned int strongest = 0;
+	for( const HapticPulse& pulse : sink.pulses ) strongest = std::max( strongest, (unsigned int)pulse.duration_us );
+
+	std::cout << "REPLAY: " << poses.size() << " poses over " << ms << "ms, " << queries_per_second << " queries/s" << std::endl;
+	std::cout << "\t" << sink.pulses.size() << " pulses played, strongest " << strongest << "us" << std::endl;
+}
+
+void benchmark_backface_culling( const PointCloud& point_cloud )
+{
+	CoutFormat restore_format;
+	const std::vector<ChunkBounds>& chunks = point_cloud.chunkBounds();
+	const std::vector<uint32_t>& normals = point_cloud.normals();
+	const size_t count = point_cloud.numPoints();
+	if( count == 0 || chunks.empty() ) return;
+
+	// Views spread evenly over a sphere around the cloud, a few times further out than it is big
+	glm::vec3 lower( 1e30f );
+	glm::vec3 upper( -1e30f );
+	for( const ChunkBounds& chunk : chunks )
+	{
+		lower = glm::min( lower, chunk.centre - glm::vec3( chunk.radius ) );
+		upper = glm::max( upper, chunk.centre + glm::vec3( chunk.radius ) );
+	}
+	glm::vec3 middle = (lower + upper) * 0.5f;
+	float distance = glm::length( upper - lower ) * 1.5f;
+
+	const int num_views = 64;
+	double culled_total = 0.0;
+	double facing_away_total = 0.0;
+	double culled_min = 1.0;
+	double culled_max = 0.0;
+
+	Clock::time_point start = Clock::now();
+	for( int v = 0; v < num_views; v++ )
+	{
+		// Fibonacci sphere
+		float y = 1.0f - 2.0f * (v + 0.5f) / num_views;
+		float r = std::sqrt( 1.0f - y * y );
+		float angle = v * 2.39996323f;
+		glm::vec3 eye = middle + glm::vec3( std::cos( angle ) * r, y, std::sin( angle ) * r ) * distance;
+
+		size_t culled = 0;
+		for( size_t c = 0; c < chunks.size(); c++ )
+		{
+			if( chunks[c].facesAway( eye ) ) culled += std::min( ChunkBounds::CHUNK_POINTS, count - c * ChunkBounds::CHUNK_POINTS );
+		}
+
+		size_t facing_away = 0;
+		for( size_t i = 0; i < count; i++ )
+		{
+			glm::vec3 p = point_cloud.position( i );
+			if( glm::dot( decode_normal( normals[i] ), p - eye ) > 0.0f ) facing_away++;
+		}
+
+		double fraction = (double)culled / count;
+		culled_total += fraction;
+		facing_away_total += (double)facing_away / count;
+		culled_min = std::min( culled_min, fraction );
+		culled_max = std::max( culled_max, fraction );
+	}
+
+	std::cout << "BENCHMARK: normal cone culling, " << count << " points in " << chunks.size() << " chunks of " << ChunkBounds::CHUNK_POINTS << ", " << num_views << " views" << std::endl;
+	std::cout << std::fixed << std::setprecision( 1 )
+		<< "\tculled " << 100.0 * culled_total / num_views << "% (" << 100.0 * culled_min << "% - " << 100.0 * culled_max << "%)"
+		<< ", facing away " << 100.0 * facing_away_total / num_views << "%"
+		<< ", " << elapsed_ms( start ) << "ms" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+// Standalone timings for the data structures, each prints a small table to std::cout.
+// They make their own test data so they can be run at any time without touching the scene,
+// except where they are timing queries against the real data.
+// All of them block the calling thread until they are done, so the frame loop stops while they run.
+
+#include <string>
+
+class PointCloud;
+
+// Pointer sphere against targets, brute force compared to the spatial hash broad phase
+void benchmark_spatial_hash();
+
+// Build time and nearest / k nearest query latency for the k-d tree
+void benchmark_kd_tree();
+
+// Rays per second against the loaded point cloud's k-d tree, on one thread and on every core
+void benchmark_raycast( const PointCloud& point_cloud );
+
+// Plays recorded pointer poses into a proximity service at their original pace and counts the pulses
+// it asks for, so the haptics can be checked without a headset. Blocks for as long as the recording lasts
+void replay_proximity( const PointCloud& point_cloud, const std::string& filepath );
+
+// Fraction of points the normal cone test culls from views all around the loaded point cloud,
+// compared to the fraction that really face away
+void benchmark_backface_culling( const PointCloud& point_cloud );
\ No newline at end of file
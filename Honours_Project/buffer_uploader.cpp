@@ -0,0 +1,195 @@
+#include "buffer_uploader.h"
+#include <iostream>
+#include <chrono>
+#include "window.h"
+#include "gl_state.h"
+
+// Static member delcarations
+BufferUploader* BufferUploader::self_ = nullptr;
+
+BufferUploader::BufferUploader()
+{}
+
+BufferUploader::~BufferUploader()
+{
+	// Anything still queued is uploaded before the thread stops, whoever asked for it may be waiting
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	if( thread_.joinable() ) thread_.join();
+
+	if( context_ ) SDL_GL_DeleteContext( context_ );
+	context_ = nullptr;
+
+	self_ = nullptr;
+}
+
+BufferUploader* BufferUploader::get()
+{
+	if( self_ == nullptr )
+	{
+		self_ = new BufferUploader();
+		bool success = self_->init();
+
+		if( success == false )
+		{
+			delete self_;
+		}
+	}
+
+	return self_;
+}
+
+bool BufferUploader::init()
+{
+	Window* window = Window::get();
+	if( !window ) return false;
+	window_ = window->SDLWindow();
+
+	// Creating the context makes it current, so put the window's back straight away
+	SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1 );
+	context_ = SDL_GL_CreateContext( window_ );
+	SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0 );
+	SDL_GL_MakeCurrent( window_, window->SDLGLContext() );
+
+	if( !context_ )
+	{
+		std::cout << "WARNING: could not create a shared GL context, buffers will be uploaded on the render thread: " << SDL_GetError() << std::endl;
+		return true;
+	}
+
+	thread_ = std::thread( &BufferUploader::upload_thread, this );
+	return true;
+}
+
+BufferUploader::Handle BufferUploader::upload( GLsizeiptr size, std::function<void( void* )> fill, GLenum usage )
+{
+	Handle upload = std::make_shared<Upload>();
+	upload->size = size;
+	upload->usage = usage;
+	upload->fill = std::move( fill );
+
+	if( !isThreaded() )
+	{
+		perform( *upload, true );
+		return upload;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		queue_.push_back( upload );
+		queued_++;
+	}
+	wake_.notify_one();
+	return upload;
+}
+
+bool BufferUploader::finished( const Handle& upload )
+{
+	if( !upload->submitted ) return false;
+	if( !upload->fence ) return true;
+
+	// A timeout of zero only asks if the fence has passed
+	GLenum result = glClientWaitSync( upload->fence, 0, 0 );
+	if( result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED ) return false;
+
+	glDeleteSync( upload->fence );
+	upload->fence = nullptr;
+	return true;
+}
+
+void BufferUploader::wait( const Handle& upload )
+{
+	{
+		std::unique_lock<std::mutex> lock( mutex_ );
+		done_.wait( lock, [&upload]() { return upload->submitted.load(); } );
+	}
+
+	while( upload->fence )
+	{
+		GLenum result = glClientWaitSync( upload->fence, 0, 1000000000 );
+		if( result == GL_WAIT_FAILED )
+		{
+			std::cout << "ERROR: waiting for a buffer upload failed" << std::endl;
+			break;
+		}
+		if( result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED ) break;
+	}
+
+	if( upload->fence ) glDeleteSync( upload->fence );
+	upload->fence = nullptr;
+}
+
+void BufferUploader::upload_thread()
+{
+	SDL_GL_MakeCurrent( window_, context_ );
+
+	while( true )
+	{
+		Handle upload;
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+			wake_.wait( lock, [this]() { return stopping_ || !queue_.empty(); } );
+			if( queue_.empty() ) break;
+
+			upload = queue_.front();
+			queue_.pop_front();
+		}
+
+		perform( *upload, false );
+
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			queued_--;
+		}
+		done_.notify_all();
+	}
+
+	SDL_GL_MakeCurrent( window_, nullptr );
+}
+
+void BufferUploader::perform( Upload& upload, bool render_thread )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// GLState only knows about the window's context, the upload context binds directly
+	glGenBuffers( 1, &upload.buffer );
+	if( render_thread ) GLState::bindBuffer( GL_ARRAY_BUFFER, upload.buffer );
+	else glBindBuffer( GL_ARRAY_BUFFER, upload.buffer );
+
+	glBufferData( GL_ARRAY_BUFFER, upload.size, nullptr, upload.usage );
+	if( upload.size > 0 && upload.fill )
+	{
+		void* destination = glMapBufferRange( GL_ARRAY_BUFFER, 0, upload.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+		if( destination )
+		{
+			upload.fill( destination );
+			// The contents can be lost while mapped, in which case there is nothing to do but say so
+			upload.failed = glUnmapBuffer( GL_ARRAY_BUFFER ) == GL_FALSE;
+		}
+		else
+		{
+			upload.failed = true;
+		}
+	}
+	if( !render_thread ) glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	// Whatever the data was captured in is no longer needed
+	upload.fill = nullptr;
+
+	// Flushed so the fence is seen by the render thread's context without this one doing anything else
+	if( !render_thread )
+	{
+		upload.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		glFlush();
+	}
+
+	uploaded_bytes_ += (size_t)upload.size;
+	double ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	if( ms > longest_ms_ ) longest_ms_ = ms;
+
+	std::lock_guard<std::mutex> lock( mutex_ );
+	upload.submitted = true;
+}
\ No newline at end of file
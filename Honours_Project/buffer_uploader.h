@@ -0,0 +1,78 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL.h>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Creates and fills vertex buffers on a thread with its own GL context, shared with the window's, so
+// big uploads never stall a frame. Each upload places a fence when it is done and the render thread
+// only starts using a buffer once finished() sees the fence has passed. Vertex arrays aren't shared
+// between contexts, so those are still made on the render thread once the buffer is finished.
+// If the shared context can't be made everything still works, uploads just happen straight away
+// on the calling thread.
+
+/* SINGLETON */
+class BufferUploader
+{
+public:
+	// Returns the uploader, the first call must be on the render thread with the window's context current
+	static BufferUploader* get();
+	~BufferUploader();
+
+	struct Upload {
+		GLuint buffer = 0;           // Owned by whoever asked for the upload once it is finished
+		GLsizeiptr size = 0;
+		bool failed = false;         // The buffer exists but its contents couldn't be written
+
+		GLenum usage = GL_STATIC_DRAW;
+		std::function<void( void* )> fill;
+		GLsync fence = nullptr;
+		std::atomic<bool> submitted{ false };
+	};
+	typedef std::shared_ptr<Upload> Handle;
+
+	// Makes a buffer of 'size' bytes and calls 'fill' with a pointer to write its contents to, both on the
+	// upload thread. Anything 'fill' reads must stay the same until the upload is finished
+	Handle upload( GLsizeiptr size, std::function<void( void* )> fill, GLenum usage = GL_STATIC_DRAW );
+
+	// Never blocks, true once the buffer can be drawn from on the render thread
+	bool finished( const Handle& upload );
+	// Blocks until finished, for when the data being read is about to change
+	void wait( const Handle& upload );
+
+	// Getters
+	bool isThreaded() const { return thread_.joinable(); }
+	unsigned int queuedUploads() const { return queued_; }
+	size_t uploadedBytes() const { return uploaded_bytes_; }
+	// Longest time a single upload took on the upload thread
+	double longestUploadTime() const { return longest_ms_; }
+
+private:
+	BufferUploader();
+	static BufferUploader* self_;
+	bool init();
+
+	void upload_thread();
+	// Creates, fills and fences the buffer with whatever context is current
+	void perform( Upload& upload, bool render_thread );
+
+	SDL_Window* window_ = nullptr;
+	SDL_GLContext context_ = nullptr;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::deque<Handle> queue_;
+	bool stopping_ = false;
+
+	std::atomic<unsigned int> queued_{ 0 };
+	std::atomic<size_t> uploaded_bytes_{ 0 };
+	std::atomic<double> longest_ms_{ 0.0 };
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "camera_uniforms.h"
+#include "gl_state.h"
+#include "frame_pipeline.h"
+#include <iostream>
+
+CameraUniforms::CameraUniforms()
+{}
+
+CameraUniforms::~CameraUniforms()
+{
+	shutdown();
+}
+
+bool CameraUniforms::init()
+{
+	// Each slot has to start on a multiple of the alignment to be bound as a range
+	GLint alignment = 0;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+	if( alignment <= 0 ) alignment = 256;
+	slot_size_ = ((sizeof( Block ) + alignment - 1) / alignment) * alignment;
+
+	glGenBuffers( 1, &ubo_ );
+	GLState::bindBuffer( GL_UNIFORM_BUFFER, ubo_ );
+	glBufferData( GL_UNIFORM_BUFFER, slot_size_ * NUM_SLOTS * FramePipeline::FRAMES_IN_FLIGHT, nullptr, GL_DYNAMIC_DRAW );
+	GLState::bindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+	if( ubo_ == 0 )
+	{
+		std::cout << "ERROR: could not create camera uniform buffer!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void CameraUniforms::shutdown()
+{
+	if( ubo_ ) {
+		GLState::deleteBuffers( 1, &ubo_ );
+		ubo_ = 0;
+	}
+}
+
+void CameraUniforms::update( int eye, const glm::mat4& view, const glm::mat4& projection )
+{
+	Block block;
+	block.view = view;
+	block.projection = projection;
+	block.view_projection = projection * view;
+	block.position = glm::inverse( view )[3];
+	block.eye = eye;
+
+	int slot = (eye >= 0 && eye < NUM_SLOTS) ? eye : CAMERA_EYE_STANDARD;
+	GLintptr offset = slot_size_ * (slot + NUM_SLOTS * FramePipeline::get()->frameSlot());
+
+	GLState::bindBuffer( GL_UNIFORM_BUFFER, ubo_ );
+	glBufferSubData( GL_UNIFORM_BUFFER, offset, sizeof( Block ), &block );
+	glBindBufferRange( GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, ubo_, offset, sizeof( Block ) );
+}
\ No newline at end of file
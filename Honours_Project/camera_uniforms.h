@@ -0,0 +1,44 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+
+// Every shader that declares the 'Camera' uniform block is bound to this point when it is linked
+#define CAMERA_UNIFORM_BINDING 0
+
+// Index used for the eye when rendering with the desktop camera
+#define CAMERA_EYE_STANDARD 2
+
+// Holds the view and projection for each eye in a uniform buffer so they are only sent once
+// per eye, rather than once per object per eye. Must match the 'Camera' block in the shaders.
+// There is a set of slots per FramePipeline slot, so writing them never waits on a frame still being drawn.
+
+class CameraUniforms
+{
+public:
+	CameraUniforms();
+	~CameraUniforms();
+
+	bool init();
+	void shutdown();
+
+	// Writes the matrices for the eye and binds its slot of the buffer to CAMERA_UNIFORM_BINDING
+	void update( int eye, const glm::mat4& view, const glm::mat4& projection );
+
+protected:
+	// std140 layout
+	struct Block {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 view_projection;
+		glm::vec4 position;
+		GLint eye;
+		GLint padding[3];
+	};
+
+	// Left, right and the standard camera each get their own slot, in every frame in flight
+	static const int NUM_SLOTS = 3;
+
+	GLuint ubo_ = 0;
+	GLsizeiptr slot_size_ = 0;
+};
\ No newline at end of file
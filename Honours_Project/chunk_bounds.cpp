@@ -0,0 +1,83 @@
+#include "chunk_bounds.h"
+#include "normals.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+bool ChunkBounds::facesAway( const glm::vec3& eye ) const
+{
+	if( cone_cos < 0.0f ) return false;
+
+	glm::vec3 to_chunk = centre - eye;
+	float distance = glm::length( to_chunk );
+	if( distance <= radius ) return false;
+
+	// A point faces away when its normal points away from the eye. The worst normal in the cone is tipped
+	// back towards the eye by the cone angle, and the worst point is 'radius' closer than the centre
+	float cos_view = glm::dot( to_chunk, cone_axis ) / distance;
+	float sin_view = std::sqrt( std::max( 0.0f, 1.0f - cos_view * cos_view ) );
+	return distance * (cos_view * cone_cos - sin_view * cone_sin) > radius;
+}
+
+void compute_chunk_bounds( const std::vector<GLfloat>& data, size_t stride, const std::vector<uint32_t>& normals, size_t first_chunk, std::vector<ChunkBounds>& chunks )
+{
+	const size_t count = data.size() / stride;
+	const size_t num_chunks = (count + ChunkBounds::CHUNK_POINTS - 1) / ChunkBounds::CHUNK_POINTS;
+	chunks.resize( num_chunks );
+	if( first_chunk >= num_chunks || normals.size() != count ) return;
+
+	parallel_for( num_chunks - first_chunk, [&]( size_t first, size_t last ) {
+		std::vector<glm::vec3> chunk_normals;
+		chunk_normals.reserve( ChunkBounds::CHUNK_POINTS );
+
+		for( size_t c = first_chunk + first; c < first_chunk + last; c++ )
+		{
+			size_t begin = c * ChunkBounds::CHUNK_POINTS;
+			size_t end = std::min( count, begin + ChunkBounds::CHUNK_POINTS );
+			ChunkBounds& bounds = chunks[c];
+
+			// Sphere around the box of the points
+			glm::vec3 lower( data[begin * stride + 0], data[begin * stride + 1], data[begin * stride + 2] );
+			glm::vec3 upper = lower;
+			for( size_t i = begin; i < end; i++ )
+			{
+				glm::vec3 p( data[i * stride + 0], data[i * stride + 1], data[i * stride + 2] );
+				lower = glm::min( lower, p );
+				upper = glm::max( upper, p );
+			}
+			bounds.centre = (lower + upper) * 0.5f;
+
+			float radius2 = 0.0f;
+			for( size_t i = begin; i < end; i++ )
+			{
+				glm::vec3 d = glm::vec3( data[i * stride + 0], data[i * stride + 1], data[i * stride + 2] ) - bounds.centre;
+				radius2 = std::max( radius2, glm::dot( d, d ) );
+			}
+			bounds.radius = std::sqrt( radius2 );
+
+			// Cone around the average normal, wide enough for the one furthest from it
+			chunk_normals.clear();
+			glm::vec3 sum( 0.0f );
+			for( size_t i = begin; i < end; i++ )
+			{
+				chunk_normals.push_back( decode_normal( normals[i] ) );
+				sum += chunk_normals.back();
+			}
+
+			bounds.cone_cos = -1.0f;
+			bounds.cone_sin = 0.0f;
+			float length = glm::length( sum );
+			if( length < 1e-6f ) continue;
+
+			bounds.cone_axis = sum / length;
+			float min_cos = 1.0f;
+			for( const glm::vec3& n : chunk_normals ) min_cos = std::min( min_cos, glm::dot( n, bounds.cone_axis ) );
+
+			if( min_cos > 0.0f )
+			{
+				bounds.cone_cos = min_cos;
+				bounds.cone_sin = std::sqrt( 1.0f - min_cos * min_cos );
+			}
+		}
+	}, 16 );
+}
\ No newline at end of file
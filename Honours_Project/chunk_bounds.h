@@ -0,0 +1,28 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// Bounds of a run of CHUNK_POINTS consecutive points. The points are in k-d tree order, so each run
+// is a compact patch of the surface: a bounding sphere and a cone holding every normal in the patch
+// are enough to tell when the whole patch faces away from the viewer.
+
+struct ChunkBounds
+{
+	static const size_t CHUNK_POINTS = 1024;
+
+	glm::vec3 centre;
+	float radius = 0.0f;
+	glm::vec3 cone_axis;
+	float cone_cos = -1.0f;      // Cosine and sine of the cone's half angle, cone_cos is -1 if the normals
+	float cone_sin = 0.0f;       // point more than 90 degrees apart and the chunk can never face away
+
+	// True if every point of the chunk faces away from the eye, all in the same space as the points
+	bool facesAway( const glm::vec3& eye ) const;
+};
+
+// Recalculates the bounds from 'first_chunk' onwards, on every core. 'data' is XYZ followed by stride - 3 other
+// floats per point, 'normals' are octahedral encoded in the same order. Resizes 'chunks' to fit the points
+void compute_chunk_bounds( const std::vector<GLfloat>& data, size_t stride, const std::vector<uint32_t>& normals, size_t first_chunk, std::vector<ChunkBounds>& chunks );
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "helpers.h"
 #include "vr_system.h"
 #include "tool.h"
+#include "gl_state.h"
+#include "debug_draw.h"
 #include <iostream>
 #include <vector>
 
@@ -12,11 +14,7 @@ Controller::Controller() :
 	shader_( nullptr ),
 	model_mat_location_( 0 ),
 	index_( vr::k_unTrackedDeviceIndexInvalid ),
-	model_vao_( 0 ),
-	model_vbo_( 0 ),
-	model_ebo_( 0 ),
-	model_texture_( 0 ),
-	model_num_verts_( 0 )
+	model_( nullptr )
 {
 }
 
@@ -32,82 +30,10 @@ void Controller::init( vr::TrackedDeviceIndex_t index, VRSystem* vr_system, cons
 
 	initialised_ = true;
 
-	shader.bind();
-
-	// Setup render models
+	// Setup render models, the model loads over the next few frames and a placeholder is drawn until then
 	vr::TrackedPropertyError tracked_property_error;
-	std::string render_model_name = vr_system->getDeviceString( index_, vr::Prop_RenderModelName_String, &tracked_property_error );
-	vr::EVRRenderModelError render_model_error = vr::VRRenderModelError_Loading;
-	std::cout << "Loading render model '" << render_model_name << "'... " << std::flush;
-
-	// Suspend the application while we wait for the render models to load
-	while( true )
-	{
-		render_model_error = vr::VRRenderModels()->LoadRenderModel_Async( render_model_name.c_str(), &vr_model_ );
-		if( render_model_error != vr::VRRenderModelError_Loading )
-			break;
-
-		SDL_Delay( 10 );
-	}
-
-	// Suspend the application while we wait for the texture data
-	while( true )
-	{
-		render_model_error = vr::VRRenderModels()->LoadTexture_Async( vr_model_->diffuseTextureId, &vr_texture_ );
-		if( render_model_error != vr::VRRenderModelError_Loading )
-			break;
-		
-		SDL_Delay( 10 );
-	}
-
-	if( render_model_error != vr::VRRenderModelError_None )
-	{
-		std::cout << "FAILED!" << std::endl;
-	}
-	if( render_model_error == vr::VRRenderModelError_None )
-	{
-		glGenVertexArrays( 1, &model_vao_ );
-		glBindVertexArray( model_vao_ );
-
-		glGenBuffers( 1, &model_ebo_ );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, model_ebo_ );
-		glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( uint16_t ) * vr_model_->unTriangleCount * 3, vr_model_->rIndexData, GL_STATIC_DRAW );
-		model_num_verts_ = vr_model_->unTriangleCount * 3;
-
-		glGenTextures( 1, &model_texture_ );
-		glBindTexture( GL_TEXTURE_2D, model_texture_ );
-		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, vr_texture_->unWidth, vr_texture_->unHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, vr_texture_->rubTextureMapData );
-
-		glGenBuffers( 1, &model_vbo_ );
-		glBindBuffer( GL_ARRAY_BUFFER, model_vbo_ );
-		glBufferData( GL_ARRAY_BUFFER, sizeof( vr::RenderModel_Vertex_t ) * vr_model_->unVertexCount, vr_model_->rVertexData, GL_STATIC_DRAW );
-		std::cout << "OK " << vr_model_->unTriangleCount << " triangles" << std::endl;
-
-		// Identify the components in the vertex buffer
-		glEnableVertexAttribArray( 0 );
-		glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( vr::RenderModel_Vertex_t ), (void *)offsetof( vr::RenderModel_Vertex_t, vPosition ) );
-		glEnableVertexAttribArray( 1 );
-		glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( vr::RenderModel_Vertex_t ), (void *)offsetof( vr::RenderModel_Vertex_t, vNormal ) );
-		glEnableVertexAttribArray( 2 );
-		glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( vr::RenderModel_Vertex_t ), (void *)offsetof( vr::RenderModel_Vertex_t, rfTextureCoord ) );
-
-		glGenerateMipmap( GL_TEXTURE_2D );
-
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
-
-		GLfloat fLargest;
-		glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest );
-		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest );
-	}
-	else
-	{
-		std::cout << "ERROR: could not load render model!" << std::endl;
-	}
-
-	glUseProgram( 0 );
+	model_name_ = vr_system->getDeviceString( index_, vr::Prop_RenderModelName_String, &tracked_property_error );
+	model_ = vr_system->renderModels()->request( model_name_ );
 }
 
 void Controller::shutdown()
@@ -115,46 +41,12 @@ void Controller::shutdown()
 	initialised_ = false;
 	vr_system_ = nullptr;
 	active_tool_ = nullptr;
-	ShaderProgram* shader_ = nullptr;
-	std::string model_name_ = "";
+	shader_ = nullptr;
+	model_name_ = "";
 	model_mat_location_ = 0; // Kinda redundant
-	model_num_verts_ = 0;
 
-	if( vr_model_ )
-	{
-		vr::VRRenderModels()->FreeRenderModel( vr_model_ );
-		vr_model_ = nullptr;
-	}
-
-	if( vr_texture_ )
-	{
-		vr::VRRenderModels()->FreeTexture( vr_texture_ );
-		vr_texture_ = nullptr;
-	}
-
-	if( model_vao_ )
-	{
-		glDeleteVertexArrays( 1, &model_vao_ );
-		model_vao_ = 0;
-	}
-
-	if( model_vbo_ )
-	{
-		glDeleteBuffers( 1, &model_vbo_ );
-		model_vbo_ = 0;
-	}
-
-	if( model_ebo_ )
-	{
-		glDeleteBuffers( 1, &model_ebo_ );
-		model_ebo_ = 0;
-	}
-
-	if( model_texture_ )
-	{
-		glDeleteTextures( 1, &model_texture_ );
-		model_texture_ = 0;
-	}
+	// The GL objects are shared through the cache, so they stay for the next controller to use
+	model_ = nullptr;
 }
 
 void Controller::update( float dt )
@@ -174,11 +66,30 @@ void Controller::update( float dt )
 	}
 }
 
-void Controller::draw()
+void Controller::submit( RenderQueue& queue, GLuint program, GLint model_location )
 {
-	glBindTexture( GL_TEXTURE_2D, model_texture_ );
-	glBindVertexArray( model_vao_ );
-	glDrawElements( GL_TRIANGLES, model_num_verts_, GL_UNSIGNED_SHORT, 0 );
+	if( !isModelReady() )
+	{
+		// Roughly the size of a Vive wand, so there is something to aim with while the model loads
+		if( isPoseValid() )
+		{
+			glm::mat4 transform = deviceToAbsoluteTracking();
+			DebugDraw::box( glm::vec3( -0.025f, -0.03f, -0.01f ), glm::vec3( 0.025f, 0.0f, 0.16f ), glm::vec3( 0.6f ), transform );
+			DebugDraw::axes( transform, 0.05f );
+		}
+		return;
+	}
+
+	DrawItem item;
+	item.program = program;
+	item.vao = model_->vao;
+	item.texture = model_->texture;
+	item.primitive = GL_TRIANGLES;
+	item.count = model_->num_indices;
+	item.index_type = GL_UNSIGNED_SHORT;
+	item.model_location = model_location;
+	item.model = deviceToAbsoluteTracking();
+	queue.submit( item );
 }
 
 void Controller::handleEvent( vr::VREvent_t event )
@@ -197,6 +108,14 @@ void Controller::handleEvent( vr::VREvent_t event )
 	}
 }
 
+void Controller::pulse( const HapticPulse& pulse )
+{
+	if( !initialised_ ) return;
+
+	// Axis 0 is the touchpad, which is where the haptic actuator is on the Vive wands
+	vr_system_->TriggerHapticPulse( index_, 0, pulse.duration_us );
+}
+
 void Controller::setActiveTool( VRTool* tool )
 {
 	// deactivate the currently active tool if there is one
@@ -278,4 +197,4 @@ glm::vec2 Controller::touchpadDelta() const
 glm::mat4 Controller::deviceToAbsoluteTracking() const
 {
 	return convertHMDmat3ToGLMMat4( pose_.mDeviceToAbsoluteTracking );
-}
+}
\ No newline at end of file
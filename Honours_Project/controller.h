@@ -3,6 +3,9 @@
 #include <openvr.h>
 
 #include "shader_program.h"
+#include "render_queue.h"
+#include "haptics.h"
+#include "render_model_cache.h"
 
 // With help from: https://github.com/zecbmo/ViveSkyrim/blob/master/Source
 // Because the openvr documentation is sparse...
@@ -11,7 +14,7 @@
 class VRSystem;
 class VRTool;
 
-class Controller
+class Controller : public HapticsSink
 {
 public:
 	Controller();
@@ -21,8 +24,9 @@ public:
 	void shutdown();
 
 	void update( float dt );
-	void draw();
+	void submit( RenderQueue& queue, GLuint program, GLint model_location );
 	void handleEvent( vr::VREvent_t event );
+	void pulse( const HapticPulse& pulse ) override;
 
 	// Setters
 	void setPose( vr::TrackedDevicePose_t pose ) { pose_ = pose; }
@@ -47,6 +51,7 @@ public:
 
 	// Getters: members
 	bool isInitialised() const { return initialised_; }
+	bool isModelReady() const { return model_ && model_->state == RenderModelCache::State::Ready; }
 	vr::TrackedDeviceIndex_t index() const { return index_; }
 	vr::VRControllerState_t state() const { return state_; }
 	vr::VRControllerState_t prevState() const { return prev_state_; }
@@ -68,15 +73,9 @@ protected:
 	// Tool info
 	VRTool* active_tool_         = nullptr;
 
-	// Rendering Info
-	vr::RenderModel_t* vr_model_           = nullptr;
-	vr::RenderModel_TextureMap_t* vr_texture_ = nullptr;
+	// Rendering Info, the model belongs to the VRSystem's cache and may still be loading
+	const RenderModelCache::Model* model_ = nullptr;
 	ShaderProgram* shader_     = nullptr;
 	GLuint model_mat_location_ = 0;
-	GLuint model_vao_          = 0;
-	GLuint model_vbo_          = 0;
-	GLuint model_ebo_          = 0;
-	GLuint model_texture_      = 0;
-	GLsizei model_num_verts_   = 0;
 	std::string model_name_    = "";
-};
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "debug_draw.h"
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include <gtc/type_ptr.hpp>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Static member delcarations
+ShaderProgram DebugDraw::shader_;
+GLint DebugDraw::modl_matrix_location_ = 0;
+GLuint DebugDraw::vao_ = 0;
+std::vector<DebugDraw::Vertex> DebugDraw::verts_;
+GLsizei DebugDraw::last_frame_verts_ = 0;
+
+bool DebugDraw::init()
+{
+	shader_.loadVertexSourceFile( "colour_shader_vs.glsl" );
+	shader_.loadFragmentSourceFile( "colour_shader_fs.glsl" );
+	if( !shader_.init() )
+	{
+		std::cout << "ERROR: failed to init debug draw shader!" << std::endl;
+		return false;
+	}
+	modl_matrix_location_ = shader_.getUniformLocation( "model" );
+
+	// The vertices always come from the stream buffer, drawing starts from wherever they were written
+	glGenVertexArrays( 1, &vao_ );
+	GLState::bindVertexArray( vao_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, StreamBuffer::get()->buffer() );
+
+	GLsizei stride = sizeof( Vertex );
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)0 );
+	glEnableVertexAttribArray( 1 );
+	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)sizeof( glm::vec3 ) );
+
+	GLState::bindVertexArray( 0 );
+
+	verts_.reserve( 4096 );
+
+	return true;
+}
+
+void DebugDraw::shutdown()
+{
+	if( vao_ )
+	{
+		GLState::deleteVertexArrays( 1, &vao_ );
+		vao_ = 0;
+	}
+	verts_.clear();
+}
+
+void DebugDraw::line( const glm::vec3& a, const glm::vec3& b, const glm::vec3& colour, const glm::mat4& transform )
+{
+	line( a, b, colour, colour, transform );
+}
+
+void DebugDraw::line( const glm::vec3& a, const glm::vec3& b, const glm::vec3& colour_a, const glm::vec3& colour_b, const glm::mat4& transform )
+{
+	Vertex v;
+	v.position = glm::vec3( transform * glm::vec4( a, 1.0f ) );
+	v.colour = colour_a;
+	verts_.push_back( v );
+
+	v.position = glm::vec3( transform * glm::vec4( b, 1.0f ) );
+	v.colour = colour_b;
+	verts_.push_back( v );
+}
+
+void DebugDraw::box( const glm::vec3& lower, const glm::vec3& upper, const glm::vec3& colour, const glm::mat4& transform )
+{
+	glm::vec3 corners[8];
+	for( int i = 0; i < 8; i++ )
+	{
+		glm::vec3 corner( (i & 1) ? upper.x : lower.x, (i & 2) ? upper.y : lower.y, (i & 4) ? upper.z : lower.z );
+		corners[i] = glm::vec3( transform * glm::vec4( corner, 1.0f ) );
+	}
+
+	// Each edge joins two corners that differ on exactly one axis
+	for( int i = 0; i < 8; i++ )
+	{
+		for( int axis = 1; axis < 8; axis <<= 1 )
+		{
+			if( (i & axis) == 0 )
+			{
+				line( corners[i], corners[i | axis], colour );
+			}
+		}
+	}
+}
+
+void DebugDraw::circle( const glm::vec3& centre, float radius, const glm::vec3& normal, const glm::vec3& colour, const glm::mat4& transform, int segments )
+{
+	if( segments < 3 ) return;
+
+	// Find two directions perpendicular to the normal to build the circle from
+	glm::vec3 n = glm::normalize( normal );
+	glm::vec3 helper = std::abs( n.y ) < 0.99f ? glm::vec3( 0.0f, 1.0f, 0.0f ) : glm::vec3( 1.0f, 0.0f, 0.0f );
+	glm::vec3 u = glm::normalize( glm::cross( helper, n ) ) * radius;
+	glm::vec3 v = glm::cross( n, u );
+
+	const float incr = 6.283f / (float)segments;
+	glm::vec3 prev = glm::vec3( transform * glm::vec4( centre + v, 1.0f ) );
+	for( int i = 1; i <= segments; i++ )
+	{
+		float angle = (i == segments) ? 0.0f : incr * i;
+		glm::vec3 next = glm::vec3( transform * glm::vec4( centre + u * std::sin( angle ) + v * std::cos( angle ), 1.0f ) );
+		line( prev, next, colour );
+		prev = next;
+	}
+}
+
+void DebugDraw::sphere( const glm::vec3& centre, float radius, const glm::vec3& colour, const glm::mat4& transform, int segments )
+{
+	circle( centre, radius, glm::vec3( 1.0f, 0.0f, 0.0f ), colour, transform, segments );
+	circle( centre, radius, glm::vec3( 0.0f, 1.0f, 0.0f ), colour, transform, segments );
+	circle( centre, radius, glm::vec3( 0.0f, 0.0f, 1.0f ), colour, transform, segments );
+}
+
+void DebugDraw::axes( const glm::mat4& transform, float size )
+{
+	glm::vec3 origin( 0.0f );
+	line( origin, glm::vec3( size, 0.0f, 0.0f ), glm::vec3( 1.0f, 0.0f, 0.0f ), transform );
+	line( origin, glm::vec3( 0.0f, size, 0.0f ), glm::vec3( 0.0f, 1.0f, 0.0f ), transform );
+	line( origin, glm::vec3( 0.0f, 0.0f, size ), glm::vec3( 0.0f, 0.0f, 1.0f ), transform );
+}
+
+void DebugDraw::submit( RenderQueue& queue )
+{
+	last_frame_verts_ = (GLsizei)verts_.size();
+	if( verts_.empty() ) return;
+
+	GLintptr offset = 0;
+	void* dest = StreamBuffer::get()->allocate<Vertex>( (GLsizei)verts_.size(), &offset );
+	if( dest )
+	{
+		memcpy( dest, verts_.data(), sizeof( Vertex ) * verts_.size() );
+
+		// Everything is already in world space
+		DrawItem item;
+		item.program = shader_.getProgram();
+		item.vao = vao_;
+		item.primitive = GL_LINES;
+		item.first = (GLint)(offset / sizeof( Vertex ));
+		item.count = (GLsizei)verts_.size();
+		item.model_location = modl_matrix_location_;
+		item.model = glm::mat4();
+		queue.submit( item );
+	}
+
+	verts_.clear();
+}
\ No newline at end of file
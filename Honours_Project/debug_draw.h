@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <vector>
+
+#include "shader_program.h"
+#include "render_queue.h"
+
+// Immediate mode line drawing for the floor, bounding boxes, tool rays and any other gizmos.
+// Shapes are transformed into world space as they are added and collected into one list,
+// which is written into the stream buffer and drawn with a single draw call per eye.
+// Anything can be added at any point in the frame before submit() is called.
+
+class DebugDraw
+{
+public:
+	static bool init();
+	static void shutdown();
+
+	static void line( const glm::vec3& a, const glm::vec3& b, const glm::vec3& colour, const glm::mat4& transform = glm::mat4() );
+	static void line( const glm::vec3& a, const glm::vec3& b, const glm::vec3& colour_a, const glm::vec3& colour_b, const glm::mat4& transform = glm::mat4() );
+	static void box( const glm::vec3& lower, const glm::vec3& upper, const glm::vec3& colour, const glm::mat4& transform = glm::mat4() );
+	// The circle lies in the plane facing along 'normal'
+	static void circle( const glm::vec3& centre, float radius, const glm::vec3& normal, const glm::vec3& colour, const glm::mat4& transform = glm::mat4(), int segments = 32 );
+	static void sphere( const glm::vec3& centre, float radius, const glm::vec3& colour, const glm::mat4& transform = glm::mat4(), int segments = 20 );
+	// Red, green and blue lines along the X, Y and Z axes of the transform
+	static void axes( const glm::mat4& transform, float size = 0.1f );
+
+	// Copy everything added this frame into the stream buffer, submit it and start a new list
+	static void submit( RenderQueue& queue );
+
+	// Getters
+	static GLsizei numVerts() { return last_frame_verts_; }
+
+private:
+	// Layout matches the position and colour attributes in colour_shader_vs.glsl
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec3 colour;
+	};
+
+	static ShaderProgram shader_;
+	static GLint modl_matrix_location_;
+	static GLuint vao_;
+
+	// Keeps its capacity between frames, so only grows while the amount of geometry does
+	static std::vector<Vertex> verts_;
+	static GLsizei last_frame_verts_;
+};
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "frame_pipeline.h"
+#include "gl_state.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+// Static member delcarations
+FramePipeline* FramePipeline::self_ = nullptr;
+
+FramePipeline::FramePipeline()
+{}
+
+FramePipeline::~FramePipeline()
+{
+	for( int i = 0; i < FRAMES_IN_FLIGHT; i++ )
+	{
+		if( slots_[i].fence ) glDeleteSync( slots_[i].fence );
+		slots_[i].fence = nullptr;
+		if( timed_ ) glDeleteQueries( MAX_SECTIONS + 1, slots_[i].queries );
+	}
+
+	self_ = nullptr;
+}
+
+FramePipeline* FramePipeline::get()
+{
+	if( self_ == nullptr )
+	{
+		self_ = new FramePipeline();
+		bool success = self_->init();
+
+		if( success == false )
+		{
+			delete self_;
+		}
+	}
+
+	return self_;
+}
+
+bool FramePipeline::init()
+{
+	epoch_ = std::chrono::steady_clock::now();
+
+	// Timestamps are core, but the counter is allowed to have no bits
+	GLint bits = 0;
+	glGetQueryiv( GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits );
+	timed_ = bits > 0;
+	if( timed_ )
+	{
+		for( int i = 0; i < FRAMES_IN_FLIGHT; i++ ) glGenQueries( MAX_SECTIONS + 1, slots_[i].queries );
+	}
+	else
+	{
+		std::cout << "WARNING: no GPU timestamps, only CPU times will be shown" << std::endl;
+	}
+
+	std::cout << "Frame pipeline: " << FRAMES_IN_FLIGHT << " slots, " << frames_ahead_ << " frames ahead" << std::endl;
+	return true;
+}
+
+void FramePipeline::setFramesAhead( int frames )
+{
+	frames_ahead_ = std::max( 1, std::min( frames, FRAMES_IN_FLIGHT ) );
+}
+
+double FramePipeline::now() const
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - epoch_ ).count();
+}
+
+void FramePipeline::beginFrame()
+{
+	frame_++;
+
+	// Every frame more than frames_ahead_ behind must be finished, which always includes the last one to use this slot
+	double waited = 0.0;
+	for( int i = 0; i < FRAMES_IN_FLIGHT; i++ )
+	{
+		Slot& slot = slots_[i];
+		if( slot.fence && slot.frame + frames_ahead_ <= frame_ ) waited += wait( slot );
+	}
+
+	slot_ = (int)(frame_ % FRAMES_IN_FLIGHT);
+	Slot& slot = slots_[slot_];
+	if( slot.in_flight ) resolve( slot, slots_[(slot_ + 1) % FRAMES_IN_FLIGHT] );
+
+	slot.frame = frame_;
+	slot.in_flight = false;
+	slot.num_marks = 0;
+	slot.fence_wait_ms = waited;
+	slot.cpu_begin = now();
+	if( timed_ )
+	{
+		// Pairs the clocks up, so GPU times can be compared with when the CPU started the next frame
+		GLint64 gpu_now = 0;
+		glGetInteger64v( GL_TIMESTAMP, &gpu_now );
+		slot.gpu_to_cpu = now() - gpu_now / 1000000.0;
+	}
+}
+
+void FramePipeline::beginSection( const char* name )
+{
+	GLState::beginSection( name );
+	mark( name );
+}
+
+void FramePipeline::endFrame()
+{
+	mark( nullptr );
+
+	Slot& slot = slots_[slot_];
+	slot.cpu_end = now();
+	slot.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	slot.in_flight = true;
+
+	// Gets the GPU going on this frame now, rather than whenever the next one fills the command buffer
+	glFlush();
+}
+
+void FramePipeline::mark( const char* name )
+{
+	Slot& slot = slots_[slot_];
+
+	// The last mark is kept for the end of the frame
+	if( name && slot.num_marks >= MAX_SECTIONS ) return;
+	if( slot.num_marks > MAX_SECTIONS ) return;
+
+	if( name ) slot.names[slot.num_marks] = name;
+	slot.cpu_marks[slot.num_marks] = now();
+	if( timed_ ) glQueryCounter( slot.queries[slot.num_marks], GL_TIMESTAMP );
+	slot.num_marks++;
+}
+
+double FramePipeline::wait( Slot& slot )
+{
+	double start = now();
+
+	GLenum result = glClientWaitSync( slot.fence, 0, 0 );
+	if( result == GL_TIMEOUT_EXPIRED )
+	{
+		fence_waits_++;
+		glClientWaitSync( slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 );
+	}
+	glDeleteSync( slot.fence );
+	slot.fence = nullptr;
+
+	return result == GL_TIMEOUT_EXPIRED ? now() - start : 0.0;
+}
+
+void FramePipeline::resolve( const Slot& slot, const Slot& next )
+{
+	// A frame that never reached endFrame() has nothing to show
+	if( slot.num_marks < 2 ) return;
+
+	GLuint64 timestamps[MAX_SECTIONS + 1];
+	if( timed_ )
+	{
+		// The fence has passed so these are ready, but never stall the frame if a driver disagrees
+		GLint available = 0;
+		glGetQueryObjectiv( slot.queries[slot.num_marks - 1], GL_QUERY_RESULT_AVAILABLE, &available );
+		if( !available ) return;
+		for( int i = 0; i < slot.num_marks; i++ ) glGetQueryObjectui64v( slot.queries[i], GL_QUERY_RESULT, &timestamps[i] );
+	}
+
+	FrameTimes times;
+	times.frame = slot.frame;
+	times.cpu_ms = slot.cpu_end - slot.cpu_begin;
+	times.fence_wait_ms = slot.fence_wait_ms;
+
+	// Sections that come round more than once in a frame, like each eye's render, are added together
+	for( int i = 0; i + 1 < slot.num_marks; i++ )
+	{
+		int s = 0;
+		while( s < times.num_sections && times.sections[s].name != slot.names[i] && std::strcmp( times.sections[s].name, slot.names[i] ) != 0 ) s++;
+		if( s == times.num_sections )
+		{
+			times.sections[s].name = slot.names[i];
+			times.num_sections++;
+		}
+		times.sections[s].cpu_ms += slot.cpu_marks[i + 1] - slot.cpu_marks[i];
+		if( timed_ ) times.sections[s].gpu_ms += (timestamps[i + 1] - timestamps[i]) / 1000000.0;
+	}
+
+	if( timed_ )
+	{
+		times.gpu_ms = (timestamps[slot.num_marks - 1] - timestamps[0]) / 1000000.0;
+		double gpu_end = timestamps[slot.num_marks - 1] / 1000000.0 + slot.gpu_to_cpu;
+		times.latency_ms = std::max( 0.0, gpu_end - slot.cpu_end );
+		if( next.frame == slot.frame + 1 )
+		{
+			times.overlap_ms = std::max( 0.0, std::min( gpu_end - next.cpu_begin, times.gpu_ms ) );
+		}
+	}
+
+	last_times_ = times;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <chrono>
+
+// Lets the CPU get on with the next frame while the GPU is still drawing the last one. Every frame
+// uses one of FRAMES_IN_FLIGHT slots, anything written per frame (the stream buffer, the camera
+// uniforms) keeps a copy per slot, and endFrame() places a fence so beginFrame() only has to wait
+// when the CPU gets more than framesAhead() frames in front of the GPU.
+//
+// Each section of the frame is also timed on the CPU and, with timestamp queries, on the GPU.
+// The queries are only read back once their slot comes round again, so timing never stalls either
+// side, and the times shown are from a few frames ago.
+
+/* SINGLETON */
+class FramePipeline
+{
+public:
+	// Returns the pipeline, or nullptr on failure. Needs a GL context.
+	static FramePipeline* get();
+	~FramePipeline();
+
+	static const int FRAMES_IN_FLIGHT = 3;
+	static const int MAX_SECTIONS = 16;
+
+	// Call before anything is written for the frame, waits if the GPU is too far behind
+	void beginFrame();
+	// Starts timing a section, also begins the GLState section of the same name so the counts line up.
+	// Names must be string literals
+	void beginSection( const char* name );
+	// Call after everything for the frame has been submitted, before presenting
+	void endFrame();
+
+	struct SectionTimes {
+		const char* name = nullptr;
+		double cpu_ms = 0.0;
+		double gpu_ms = 0.0;
+	};
+
+	// Timings for the most recent frame whose queries have come back
+	struct FrameTimes {
+		uint64_t frame = 0;
+		double cpu_ms = 0.0;          // beginFrame() to endFrame()
+		double gpu_ms = 0.0;          // First command of the frame to the last on the GPU
+		double overlap_ms = 0.0;      // GPU time spent on this frame while the CPU was already on the next
+		double latency_ms = 0.0;      // endFrame() to the GPU finishing the frame
+		double fence_wait_ms = 0.0;   // Time beginFrame() spent waiting before this frame could start
+		int num_sections = 0;
+		SectionTimes sections[MAX_SECTIONS];
+	};
+	const FrameTimes& lastFrameTimes() const { return last_times_; }
+
+	// Setters
+	// 1 waits for the GPU to finish each frame before the next starts, up to FRAMES_IN_FLIGHT
+	void setFramesAhead( int frames );
+
+	// Getters
+	int frameSlot() const { return slot_; }
+	uint64_t frame() const { return frame_; }
+	int framesAhead() const { return frames_ahead_; }
+	unsigned int fenceWaits() const { return fence_waits_; }
+	bool isTimed() const { return timed_; }
+
+private:
+	FramePipeline();
+	static FramePipeline* self_;
+	bool init();
+
+	struct Slot {
+		uint64_t frame = 0;
+		GLsync fence = nullptr;
+		bool in_flight = false;
+		// One mark at the start of each section and one at the end of the frame
+		GLuint queries[MAX_SECTIONS + 1];
+		const char* names[MAX_SECTIONS];
+		double cpu_marks[MAX_SECTIONS + 1];
+		int num_marks = 0;
+		double cpu_begin = 0.0;
+		double cpu_end = 0.0;
+		double fence_wait_ms = 0.0;
+		double gpu_to_cpu = 0.0;     // Added to a GPU timestamp in ms to put it on the CPU clock
+	};
+
+	// Milliseconds since the pipeline was made
+	double now() const;
+	// Blocks until the slot's fence has passed, returns the time spent waiting
+	double wait( Slot& slot );
+	// Reads the slot's queries into last_times_, 'next' is the slot of the frame after it
+	void resolve( const Slot& slot, const Slot& next );
+	void mark( const char* name );
+
+	Slot slots_[FRAMES_IN_FLIGHT];
+	int slot_ = 0;
+	uint64_t frame_ = 0;
+	int frames_ahead_ = 2;
+	bool timed_ = false;
+
+	std::chrono::steady_clock::time_point epoch_;
+	FrameTimes last_times_;
+	unsigned int fence_waits_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "gl_state.h"
+#include <cstring>
+
+GLState::Capability GLState::capabilities_[GLState::MAX_CAPABILITIES];
+int GLState::num_capabilities_ = 0;
+
+GLuint GLState::program_ = GLState::UNKNOWN;
+GLuint GLState::vao_ = GLState::UNKNOWN;
+GLuint GLState::array_buffer_ = GLState::UNKNOWN;
+GLuint GLState::uniform_buffer_ = GLState::UNKNOWN;
+GLuint GLState::pixel_pack_buffer_ = GLState::UNKNOWN;
+GLuint GLState::pixel_unpack_buffer_ = GLState::UNKNOWN;
+GLuint GLState::read_framebuffer_ = GLState::UNKNOWN;
+GLuint GLState::draw_framebuffer_ = GLState::UNKNOWN;
+GLuint GLState::texture_2d_ = GLState::UNKNOWN;
+GLuint GLState::texture_2d_multisample_ = GLState::UNKNOWN;
+
+bool GLState::viewport_known_ = false;
+GLint GLState::viewport_[4] = { 0, 0, 0, 0 };
+GLenum GLState::depth_func_ = GL_NONE;
+bool GLState::clear_colour_known_ = false;
+GLfloat GLState::clear_colour_[4] = { 0, 0, 0, 0 };
+bool GLState::clear_depth_known_ = false;
+GLdouble GLState::clear_depth_ = 0.0;
+
+GLState::SectionStats GLState::sections_[GLState::MAX_SECTIONS];
+int GLState::num_sections_ = 0;
+int GLState::current_section_ = -1;
+GLState::SectionStats GLState::last_sections_[GLState::MAX_SECTIONS];
+int GLState::last_num_sections_ = 0;
+
+bool GLState::issue( bool changed )
+{
+	if( current_section_ < 0 )
+	{
+		beginSection( "Other" );
+	}
+
+	if( changed ) sections_[current_section_].issued++;
+	else sections_[current_section_].skipped++;
+
+	return changed;
+}
+
+GLState::Capability* GLState::find_capability( GLenum cap )
+{
+	for( int i = 0; i < num_capabilities_; i++ )
+	{
+		if( capabilities_[i].cap == cap ) return &capabilities_[i];
+	}
+
+	if( num_capabilities_ < MAX_CAPABILITIES )
+	{
+		capabilities_[num_capabilities_] = Capability{ cap, -1 };
+		return &capabilities_[num_capabilities_++];
+	}
+
+	// Too many different capabilities, just don't track this one
+	return nullptr;
+}
+
+bool GLState::enable( GLenum cap )
+{
+	Capability* c = find_capability( cap );
+	if( issue( !c || c->state != 1 ) )
+	{
+		glEnable( cap );
+		if( c ) c->state = 1;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::disable( GLenum cap )
+{
+	Capability* c = find_capability( cap );
+	if( issue( !c || c->state != 0 ) )
+	{
+		glDisable( cap );
+		if( c ) c->state = 0;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::useProgram( GLuint program )
+{
+	if( issue( program != program_ ) )
+	{
+		glUseProgram( program );
+		program_ = program;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::bindVertexArray( GLuint vao )
+{
+	if( issue( vao != vao_ ) )
+	{
+		glBindVertexArray( vao );
+		vao_ = vao;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::bindBuffer( GLenum target, GLuint buffer )
+{
+	GLuint* current = nullptr;
+	switch( target )
+	{
+	case GL_ARRAY_BUFFER: current = &array_buffer_; break;
+	case GL_UNIFORM_BUFFER: current = &uniform_buffer_; break;
+	case GL_PIXEL_PACK_BUFFER: current = &pixel_pack_buffer_; break;
+	case GL_PIXEL_UNPACK_BUFFER: current = &pixel_unpack_buffer_; break;
+	default: break; // The element buffer belongs to the VAO, so it is never cached
+	}
+
+	if( issue( !current || *current != buffer ) )
+	{
+		glBindBuffer( target, buffer );
+		if( current ) *current = buffer;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::bindFramebuffer( GLenum target, GLuint framebuffer )
+{
+	bool changed = true;
+	if( target == GL_FRAMEBUFFER ) changed = read_framebuffer_ != framebuffer || draw_framebuffer_ != framebuffer;
+	else if( target == GL_READ_FRAMEBUFFER ) changed = read_framebuffer_ != framebuffer;
+	else if( target == GL_DRAW_FRAMEBUFFER ) changed = draw_framebuffer_ != framebuffer;
+
+	if( issue( changed ) )
+	{
+		glBindFramebuffer( target, framebuffer );
+		if( target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER ) read_framebuffer_ = framebuffer;
+		if( target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER ) draw_framebuffer_ = framebuffer;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::bindTexture( GLenum target, GLuint texture )
+{
+	// Only texture unit 0 is used by the application
+	GLuint* current = nullptr;
+	switch( target )
+	{
+	case GL_TEXTURE_2D: current = &texture_2d_; break;
+	case GL_TEXTURE_2D_MULTISAMPLE: current = &texture_2d_multisample_; break;
+	default: break;
+	}
+
+	if( issue( !current || *current != texture ) )
+	{
+		glBindTexture( target, texture );
+		if( current ) *current = texture;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::viewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+	bool changed = !viewport_known_ || viewport_[0] != x || viewport_[1] != y || viewport_[2] != width || viewport_[3] != height;
+	if( issue( changed ) )
+	{
+		glViewport( x, y, width, height );
+		viewport_[0] = x; viewport_[1] = y; viewport_[2] = width; viewport_[3] = height;
+		viewport_known_ = true;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::depthFunc( GLenum func )
+{
+	if( issue( func != depth_func_ ) )
+	{
+		glDepthFunc( func );
+		depth_func_ = func;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::clearColor( GLfloat r, GLfloat g, GLfloat b, GLfloat a )
+{
+	bool changed = !clear_colour_known_ || clear_colour_[0] != r || clear_colour_[1] != g || clear_colour_[2] != b || clear_colour_[3] != a;
+	if( issue( changed ) )
+	{
+		glClearColor( r, g, b, a );
+		clear_colour_[0] = r; clear_colour_[1] = g; clear_colour_[2] = b; clear_colour_[3] = a;
+		clear_colour_known_ = true;
+		return true;
+	}
+	return false;
+}
+
+bool GLState::clearDepth( GLdouble depth )
+{
+	if( issue( !clear_depth_known_ || clear_depth_ != depth ) )
+	{
+		glClearDepth( depth );
+		clear_depth_ = depth;
+		clear_depth_known_ = true;
+		return true;
+	}
+	return false;
+}
+
+void GLState::deleteVertexArrays( GLsizei n, const GLuint* vaos )
+{
+	for( GLsizei i = 0; i < n; i++ )
+	{
+		if( vaos[i] == vao_ ) vao_ = 0;
+	}
+	glDeleteVertexArrays( n, vaos );
+}
+
+void GLState::deleteBuffers( GLsizei n, const GLuint* buffers )
+{
+	for( GLsizei i = 0; i < n; i++ )
+	{
+		if( buffers[i] == array_buffer_ ) array_buffer_ = 0;
+		if( buffers[i] == uniform_buffer_ ) uniform_buffer_ = 0;
+		if( buffers[i] == pixel_pack_buffer_ ) pixel_pack_buffer_ = 0;
+		if( buffers[i] == pixel_unpack_buffer_ ) pixel_unpack_buffer_ = 0;
+	}
+	glDeleteBuffers( n, buffers );
+}
+
+void GLState::deleteFramebuffers( GLsizei n, const GLuint* framebuffers )
+{
+	for( GLsizei i = 0; i < n; i++ )
+	{
+		if( framebuffers[i] == read_framebuffer_ ) read_framebuffer_ = 0;
+		if( framebuffers[i] == draw_framebuffer_ ) draw_framebuffer_ = 0;
+	}
+	glDeleteFramebuffers( n, framebuffers );
+}
+
+void GLState::deleteTextures( GLsizei n, const GLuint* textures )
+{
+	for( GLsizei i = 0; i < n; i++ )
+	{
+		if( textures[i] == texture_2d_ ) texture_2d_ = 0;
+		if( textures[i] == texture_2d_multisample_ ) texture_2d_multisample_ = 0;
+	}
+	glDeleteTextures( n, textures );
+}
+
+void GLState::deleteProgram( GLuint program )
+{
+	// A program in use is only flagged for deletion, so its name can't be reused until it is unbound
+	glDeleteProgram( program );
+}
+
+void GLState::invalidate()
+{
+	for( int i = 0; i < num_capabilities_; i++ )
+	{
+		capabilities_[i].state = -1;
+	}
+
+	program_ = UNKNOWN;
+	vao_ = UNKNOWN;
+	array_buffer_ = UNKNOWN;
+	uniform_buffer_ = UNKNOWN;
+	pixel_pack_buffer_ = UNKNOWN;
+	pixel_unpack_buffer_ = UNKNOWN;
+	read_framebuffer_ = UNKNOWN;
+	draw_framebuffer_ = UNKNOWN;
+	texture_2d_ = UNKNOWN;
+	texture_2d_multisample_ = UNKNOWN;
+
+	viewport_known_ = false;
+	depth_func_ = GL_NONE;
+	clear_colour_known_ = false;
+	clear_depth_known_ = false;
+}
+
+void GLState::beginSection( const char* name )
+{
+	for( int i = 0; i < num_sections_; i++ )
+	{
+		if( sections_[i].name == name || std::strcmp( sections_[i].name, name ) == 0 )
+		{
+			current_section_ = i;
+			return;
+		}
+	}
+
+	if( num_sections_ < MAX_SECTIONS )
+	{
+		sections_[num_sections_] = SectionStats();
+		sections_[num_sections_].name = name;
+		current_section_ = num_sections_++;
+	}
+}
+
+void GLState::beginFrame()
+{
+	for( int i = 0; i < num_sections_; i++ )
+	{
+		last_sections_[i] = sections_[i];
+	}
+	last_num_sections_ = num_sections_;
+
+	num_sections_ = 0;
+	current_section_ = -1;
+}
+
+GLState::SectionStats GLState::lastFrameTotals()
+{
+	SectionStats totals;
+	totals.name = "Total";
+	for( int i = 0; i < last_num_sections_; i++ )
+	{
+		totals.issued += last_sections_[i].issued;
+		totals.skipped += last_sections_[i].skipped;
+	}
+	return totals;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Thin layer in front of the OpenGL state calls, remembers what is currently bound or enabled
+// and skips any call that would not change anything. Every call is counted as issued or skipped
+// against the current section so it is easy to see which part of the frame is the most chatty.
+//
+// Everything in the application must go through here for the cached state to stay correct,
+// code that changes state behind its back (ImGui restores everything it touches) is fine as long
+// as it puts things back, otherwise call invalidate() afterwards.
+
+class GLState
+{
+public:
+	struct SectionStats {
+		const char* name    = nullptr;
+		unsigned int issued  = 0;
+		unsigned int skipped = 0;
+	};
+
+	static const int MAX_SECTIONS = 16;
+
+	// The functions return true if the call was actually sent to OpenGL
+	static bool enable( GLenum cap );
+	static bool disable( GLenum cap );
+	static bool useProgram( GLuint program );
+	static bool bindVertexArray( GLuint vao );
+	static bool bindBuffer( GLenum target, GLuint buffer );
+	static bool bindFramebuffer( GLenum target, GLuint framebuffer );
+	static bool bindTexture( GLenum target, GLuint texture );
+	static bool viewport( GLint x, GLint y, GLsizei width, GLsizei height );
+	static bool depthFunc( GLenum func );
+	static bool clearColor( GLfloat r, GLfloat g, GLfloat b, GLfloat a );
+	static bool clearDepth( GLdouble depth );
+
+	// Deleting a bound object resets the binding to 0, so these keep the cache in step
+	static void deleteVertexArrays( GLsizei n, const GLuint* vaos );
+	static void deleteBuffers( GLsizei n, const GLuint* buffers );
+	static void deleteFramebuffers( GLsizei n, const GLuint* framebuffers );
+	static void deleteTextures( GLsizei n, const GLuint* textures );
+	static void deleteProgram( GLuint program );
+
+	// Forget everything, the next call of each kind will always be issued
+	static void invalidate();
+
+	// Calls are counted against the named section until the next one begins, names must be string literals
+	static void beginSection( const char* name );
+
+	// Moves the counters for this frame into the last frame stats
+	static void beginFrame();
+
+	// Getters
+	static int numSections() { return last_num_sections_; }
+	static const SectionStats& sectionStats( int index ) { return last_sections_[index]; }
+	static SectionStats lastFrameTotals();
+
+private:
+	static bool issue( bool changed );
+
+	struct Capability {
+		GLenum cap;
+		int state; // -1 unknown, 0 disabled, 1 enabled
+	};
+	static const int MAX_CAPABILITIES = 16;
+	static Capability capabilities_[MAX_CAPABILITIES];
+	static int num_capabilities_;
+	static Capability* find_capability( GLenum cap );
+
+	// Bindings, UNKNOWN means whatever is there has not been seen yet
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+	static GLuint program_;
+	static GLuint vao_;
+	static GLuint array_buffer_;
+	static GLuint uniform_buffer_;
+	static GLuint pixel_pack_buffer_;
+	static GLuint pixel_unpack_buffer_;
+	static GLuint read_framebuffer_;
+	static GLuint draw_framebuffer_;
+	static GLuint texture_2d_;
+	static GLuint texture_2d_multisample_;
+
+	static bool viewport_known_;
+	static GLint viewport_[4];
+	static GLenum depth_func_;
+	static bool clear_colour_known_;
+	static GLfloat clear_colour_[4];
+	static bool clear_depth_known_;
+	static GLdouble clear_depth_;
+
+	static SectionStats sections_[MAX_SECTIONS];
+	static int num_sections_;
+	static int current_section_;
+	static SectionStats last_sections_[MAX_SECTIONS];
+	static int last_num_sections_;
+};
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+// A single buzz of the controller, OpenVR accepts up to 3999 microseconds per pulse
+struct HapticPulse
+{
+	unsigned short duration_us = 0;
+};
+
+// Anything that can play haptic pulses, the controller or a stand in when replaying recorded poses
+class HapticsSink
+{
+public:
+	virtual ~HapticsSink() {}
+	virtual void pulse( const HapticPulse& pulse ) = 0;
+};
\ No newline at end of file
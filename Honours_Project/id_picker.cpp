@@ -0,0 +1,184 @@
+#include "id_picker.h"
+#include "point_cloud.h"
+#include "gl_state.h"
+#include <gtc/type_ptr.hpp>
+#include <iostream>
+
+IdPicker::IdPicker()
+{
+
+}
+
+IdPicker::~IdPicker()
+{
+	shutdown();
+}
+
+bool IdPicker::init()
+{
+	shader_.loadVertexSourceFile( "point_id_shader_vs.glsl" );
+	shader_.loadFragmentSourceFile( "point_id_shader_fs.glsl" );
+	if( !shader_.init() ) return false;
+	shader_.bind();
+	matrix_location_ = shader_.getUniformLocation( "pick_matrix" );
+
+	// The pick target only covers the region being searched, so it is tiny
+	glGenTextures( 1, &id_texture_ );
+	GLState::bindTexture( GL_TEXTURE_2D, id_texture_ );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_R32UI, PICK_SIZE, PICK_SIZE, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+	glGenRenderbuffers( 1, &depth_buffer_ );
+	glBindRenderbuffer( GL_RENDERBUFFER, depth_buffer_ );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, PICK_SIZE, PICK_SIZE );
+
+	glGenFramebuffers( 1, &fbo_ );
+	GLState::bindFramebuffer( GL_FRAMEBUFFER, fbo_ );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, id_texture_, 0 );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer_ );
+
+	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	GLState::bindFramebuffer( GL_FRAMEBUFFER, 0 );
+	if( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		std::cout << "ERROR: pick framebuffer incomplete, status 0x" << std::hex << status << std::dec << std::endl;
+		return false;
+	}
+
+	for( Slot& slot : slots_ )
+	{
+		glGenBuffers( 1, &slot.pbo );
+		GLState::bindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		glBufferData( GL_PIXEL_PACK_BUFFER, sizeof( GLuint ) * PICK_SIZE * PICK_SIZE, nullptr, GL_STREAM_READ );
+	}
+	GLState::bindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	return true;
+}
+
+void IdPicker::shutdown()
+{
+	for( Slot& slot : slots_ )
+	{
+		if( slot.fence ) glDeleteSync( slot.fence );
+		slot.fence = nullptr;
+		if( slot.pbo ) GLState::deleteBuffers( 1, &slot.pbo );
+		slot.pbo = 0;
+	}
+	in_flight_ = 0;
+
+	if( fbo_ ) GLState::deleteFramebuffers( 1, &fbo_ );
+	fbo_ = 0;
+	if( id_texture_ ) GLState::deleteTextures( 1, &id_texture_ );
+	id_texture_ = 0;
+	if( depth_buffer_ ) glDeleteRenderbuffers( 1, &depth_buffer_ );
+	depth_buffer_ = 0;
+
+	shader_.shutdown();
+}
+
+glm::mat4 IdPicker::regionMatrix( const glm::vec2& centre, const glm::vec2& size )
+{
+	// Move the centre of the region to the origin, then scale the region up to fill NDC
+	glm::mat4 region;
+	region[0][0] = 2.0f / size.x;
+	region[1][1] = 2.0f / size.y;
+	region[3][0] = -centre.x * 2.0f / size.x;
+	region[3][1] = -centre.y * 2.0f / size.y;
+	return region;
+}
+
+bool IdPicker::pick( const PointCloud& point_cloud, const glm::mat4& view_projection )
+{
+	if( !enabled_ || !fbo_ || point_cloud.numPoints() == 0 || point_cloud.buffersPending() ) return false;
+
+	if( in_flight_ == RING_SIZE )
+	{
+		dropped_picks_++;
+		return false;
+	}
+
+	GLState::bindFramebuffer( GL_FRAMEBUFFER, fbo_ );
+	GLState::viewport( 0, 0, PICK_SIZE, PICK_SIZE );
+	GLState::enable( GL_DEPTH_TEST );
+	GLState::depthFunc( GL_LESS );
+
+	const GLuint background = 0;
+	const GLfloat far_depth = 1.0f;
+	glClearBufferuiv( GL_COLOR, 0, &background );
+	glClearBufferfv( GL_DEPTH, 0, &far_depth );
+
+	// Only the position attribute is read, the vertex index is the point index
+	glm::mat4 pick_matrix = view_projection * point_cloud.worldMatrix();
+	GLState::useProgram( shader_.getProgram() );
+	glUniformMatrix4fv( matrix_location_, 1, GL_FALSE, glm::value_ptr( pick_matrix ) );
+	GLState::bindVertexArray( point_cloud.vao() );
+	glDrawArrays( GL_POINTS, 0, (GLsizei)point_cloud.numPoints() );
+
+	// Copy into the buffer on the GPU, it is only mapped once the fence says the copy is done
+	Slot& slot = slots_[head_];
+	GLState::bindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+	glReadPixels( 0, 0, PICK_SIZE, PICK_SIZE, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr );
+	GLState::bindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	slot.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	slot.frame = frame_;
+	head_ = (head_ + 1) % RING_SIZE;
+	in_flight_++;
+
+	return true;
+}
+
+bool IdPicker::poll()
+{
+	bool got_result = false;
+
+	while( in_flight_ > 0 )
+	{
+		// Don't wait, whatever isn't finished is looked at again next frame
+		Slot& slot = slots_[tail_];
+		GLenum status = glClientWaitSync( slot.fence, 0, 0 );
+		if( status == GL_TIMEOUT_EXPIRED ) break;
+
+		glDeleteSync( slot.fence );
+		slot.fence = nullptr;
+
+		GLState::bindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		const GLuint* ids = (const GLuint*)glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, sizeof( GLuint ) * PICK_SIZE * PICK_SIZE, GL_MAP_READ_BIT );
+		if( ids )
+		{
+			// The point drawn nearest the middle of the target wins
+			int best = -1;
+			int best_distance = PICK_SIZE * PICK_SIZE;
+			for( int y = 0; y < PICK_SIZE; y++ )
+			{
+				for( int x = 0; x < PICK_SIZE; x++ )
+				{
+					GLuint id = ids[y * PICK_SIZE + x];
+					int dx = x - PICK_SIZE / 2;
+					int dy = y - PICK_SIZE / 2;
+					if( id != 0 && dx * dx + dy * dy < best_distance )
+					{
+						best = (int)id - 1;
+						best_distance = dx * dx + dy * dy;
+					}
+				}
+			}
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+
+			result_.index = best;
+			result_.frame = slot.frame;
+			result_.latency = frame_ - slot.frame;
+			got_result = true;
+		}
+		GLState::bindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+		tail_ = (tail_ + 1) % RING_SIZE;
+		in_flight_--;
+	}
+
+	frame_++;
+	return got_result;
+}
\ No newline at end of file
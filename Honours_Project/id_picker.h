@@ -0,0 +1,78 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include "shader_program.h"
+
+class PointCloud;
+
+// Finds the point under a small region of the screen by drawing the point indices into an integer
+// target and reading it back through a ring of pixel buffers. The reads are never waited on, so each
+// result arrives a frame or two after it was asked for. Nothing is drawn or read while nobody is picking.
+
+class IdPicker
+{
+public:
+	// Width and height of the pick target in pixels, the whole target is searched for the nearest point
+	static const int PICK_SIZE = 15;
+	// Picks that can be in flight at once, when they are all busy new picks are dropped rather than waited on
+	static const int RING_SIZE = 3;
+
+	struct Result {
+		int index = -1;              // Point nearest the middle of the target, or -1 if there wasn't one
+		unsigned int frame = 0;      // Frame the pick was made on
+		unsigned int latency = 0;    // Frames between the pick and the result arriving
+	};
+
+	IdPicker();
+	~IdPicker();
+
+	bool init();
+	void shutdown();
+
+	// Maps the area 'size' NDC units across around 'centre' onto the whole pick target.
+	// For the pixels around the cursor use regionMatrix( cursor, PICK_SIZE * 2 / window size ) * projection * view
+	static glm::mat4 regionMatrix( const glm::vec2& centre, const glm::vec2& size );
+
+	// Draws the point cloud's indices with the view projection and starts reading them back.
+	// Leaves the pick target bound. Returns false if picking is disabled or every slot in the ring is still busy
+	bool pick( const PointCloud& point_cloud, const glm::mat4& view_projection );
+
+	// Collects any reads the GPU has finished, call once per frame. Returns true if a new result arrived
+	bool poll();
+
+	// Setters
+	void setEnabled( bool enabled ) { enabled_ = enabled; }
+
+	// Getters
+	bool enabled() const { return enabled_; }
+	const Result& result() const { return result_; }
+	int inFlight() const { return in_flight_; }
+	unsigned int droppedPicks() const { return dropped_picks_; }
+
+protected:
+	struct Slot {
+		GLuint pbo = 0;
+		GLsync fence = nullptr;
+		unsigned int frame = 0;
+	};
+
+	bool enabled_ = false;
+
+	ShaderProgram shader_;
+	GLint matrix_location_ = -1;
+
+	GLuint fbo_ = 0;
+	GLuint id_texture_ = 0;
+	GLuint depth_buffer_ = 0;
+
+	// Picks are written at head_ and collected from tail_ in the order they were made
+	Slot slots_[RING_SIZE];
+	int head_ = 0;
+	int tail_ = 0;
+	int in_flight_ = 0;
+
+	unsigned int frame_ = 0;
+	unsigned int dropped_picks_ = 0;
+	Result result_;
+};
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "kd_tree.h"
+#include "parallel.h"
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	// Each entry in the traversal stack is a range of the tree still to be visited
+	struct Range {
+		size_t first;
+		size_t last;
+		float distance2;   // Squared distance from the query to the split plane that led here
+	};
+
+	const int MAX_STACK = 128;
+}
+
+KdTree::KdTree()
+{}
+
+KdTree::~KdTree()
+{}
+
+void KdTree::clear()
+{
+	points_.clear();
+	axes_.clear();
+	order_.clear();
+}
+
+void KdTree::build( std::vector<GLfloat>& data, size_t stride, bool reorder_data, std::vector<unsigned int>* reordered )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	clear();
+	if( stride < 3 ) return;
+	size_t count = data.size() / stride;
+	if( count == 0 ) return;
+
+	points_.resize( count );
+	axes_.resize( count );
+	order_.resize( count );
+
+	parallel_for( count, [&]( size_t first, size_t last ) {
+		for( size_t i = first; i < last; i++ )
+		{
+			points_[i] = glm::vec3( data[i * stride + 0], data[i * stride + 1], data[i * stride + 2] );
+			order_[i] = (unsigned int)i;
+		}
+	} );
+
+	lower_ = points_[0];
+	upper_ = points_[0];
+	for( const glm::vec3& p : points_ )
+	{
+		lower_ = glm::min( lower_, p );
+		upper_ = glm::max( upper_, p );
+	}
+
+	// Enough threads to use every core, the split doubles the number of threads at each level
+	int threads = (int)std::max( 1u, std::thread::hardware_concurrency() );
+	build_range( 0, count, lower_, upper_, threads );
+
+	// Put the points into tree order
+	std::vector<glm::vec3> sorted_points( count );
+	parallel_for( count, [&]( size_t first, size_t last ) {
+		for( size_t i = first; i < last; i++ )
+		{
+			sorted_points[i] = points_[order_[i]];
+		}
+	} );
+	points_.swap( sorted_points );
+
+	// Then the vertex data, after which the tree order and the data order are the same
+	if( reorder_data )
+	{
+		std::vector<GLfloat> sorted_data( data.size() );
+		parallel_for( count, [&]( size_t first, size_t last ) {
+			for( size_t i = first; i < last; i++ )
+			{
+				size_t from = order_[i];
+				std::copy( data.begin() + from * stride, data.begin() + (from + 1) * stride, sorted_data.begin() + i * stride );
+			}
+		} );
+		data.swap( sorted_data );
+
+		if( reordered ) reordered->swap( order_ );
+		order_.clear();
+		order_.shrink_to_fit();
+	}
+
+	build_ms_ = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	std::cout << "KD TREE: built over " << count << " points in " << build_ms_ << "ms" << std::endl;
+}
+
+void KdTree::build_range( size_t first, size_t last, glm::vec3 lower, glm::vec3 upper, int threads )
+{
+	while( first < last )
+	{
+		// Split on the longest side of the range's bounds
+		glm::vec3 extent = upper - lower;
+		int axis = 0;
+		if( extent.y > extent[axis] ) axis = 1;
+		if( extent.z > extent[axis] ) axis = 2;
+
+		size_t mid = first + (last - first) / 2;
+		const std::vector<glm::vec3>& points = points_;
+		std::nth_element( order_.begin() + first, order_.begin() + mid, order_.begin() + last,
+			[&points, axis]( unsigned int a, unsigned int b ) { return points[a][axis] < points[b][axis]; } );
+
+		axes_[mid] = (unsigned char)axis;
+		float split = points_[order_[mid]][axis];
+
+		glm::vec3 left_upper = upper;
+		left_upper[axis] = split;
+		glm::vec3 right_lower = lower;
+		right_lower[axis] = split;
+
+		// Hand the lower half to another thread while this one carries on with the upper half
+		if( threads > 1 && mid - first > 10000 )
+		{
+			std::thread worker( &KdTree::build_range, this, first, mid, lower, left_upper, threads / 2 );
+			build_range( mid + 1, last, right_lower, upper, threads - threads / 2 );
+			worker.join();
+			return;
+		}
+
+		build_range( first, mid, lower, left_upper, 1 );
+		first = mid + 1;
+		lower = right_lower;
+	}
+}
+
+int KdTree::nearest( const glm::vec3& position, float max_distance, float* distance ) const
+{
+	int best = -1;
+	float best_distance2 = max_distance * max_distance;
+
+	Range stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = { 0, points_.size(), 0.0f };
+
+	while( top > 0 )
+	{
+		Range range = stack[--top];
+		if( range.distance2 > best_distance2 ) continue;
+
+		while( range.first < range.last )
+		{
+			size_t mid = range.first + (range.last - range.first) / 2;
+			const glm::vec3& p = points_[mid];
+
+			glm::vec3 d = p - position;
+			float distance2 = glm::dot( d, d );
+			if( distance2 < best_distance2 )
+			{
+				best_distance2 = distance2;
+				best = (int)mid;
+			}
+
+			// Visit the side the query is on first, come back for the other side if it could be closer
+			int axis = axes_[mid];
+			float offset = position[axis] - p[axis];
+			Range near_side = offset < 0.0f ? Range{ range.first, mid, 0.0f } : Range{ mid + 1, range.last, 0.0f };
+			Range far_side = offset < 0.0f ? Range{ mid + 1, range.last, offset * offset } : Range{ range.first, mid, offset * offset };
+
+			if( far_side.first < far_side.last && far_side.distance2 < best_distance2 && top < MAX_STACK )
+			{
+				stack[top++] = far_side;
+			}
+			range = near_side;
+		}
+	}
+
+	if( best < 0 ) return -1;
+
+	if( distance ) *distance = std::sqrt( best_distance2 );
+	return dataIndex( best );
+}
+
+void KdTree::nearest( const glm::vec3& position, size_t k, std::vector<int>& results, float max_distance ) const
+{
+	results.clear();
+	if( k == 0 || points_.empty() ) return;
+
+	// Max heap of the best k so far, the furthest is at the front
+	typedef std::pair<float, int> Candidate;
+	std::vector<Candidate> heap;
+	heap.reserve( k + 1 );
+	float limit2 = max_distance * max_distance;
+
+	Range stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = { 0, points_.size(), 0.0f };
+
+	while( top > 0 )
+	{
+		Range range = stack[--top];
+		if( range.distance2 > limit2 ) continue;
+
+		while( range.first < range.last )
+		{
+			size_t mid = range.first + (range.last - range.first) / 2;
+			const glm::vec3& p = points_[mid];
+
+			glm::vec3 d = p - position;
+			float distance2 = glm::dot( d, d );
+			if( distance2 < limit2 )
+			{
+				heap.push_back( Candidate( distance2, (int)mid ) );
+				std::push_heap( heap.begin(), heap.end() );
+				if( heap.size() > k )
+				{
+					std::pop_heap( heap.begin(), heap.end() );
+					heap.pop_back();
+				}
+				// Once we have k points nothing further than the worst of them matters
+				if( heap.size() == k ) limit2 = heap.front().first;
+			}
+
+			int axis = axes_[mid];
+			float offset = position[axis] - p[axis];
+			Range near_side = offset < 0.0f ? Range{ range.first, mid, 0.0f } : Range{ mid + 1, range.last, 0.0f };
+			Range far_side = offset < 0.0f ? Range{ mid + 1, range.last, offset * offset } : Range{ range.first, mid, offset * offset };
+
+			if( far_side.first < far_side.last && far_side.distance2 < limit2 && top < MAX_STACK )
+			{
+				stack[top++] = far_side;
+			}
+			range = near_side;
+		}
+	}
+
+	std::sort_heap( heap.begin(), heap.end() );
+	for( const Candidate& c : heap ) results.push_back( dataIndex( c.second ) );
+}
+
+bool KdTree::raycast( const glm::vec3& origin, const glm::vec3& direction, float radius, float max_distance, RayHit* hit ) const
+{
+	if( points_.empty() ) return false;
+
+	// Each range on the stack carries the part of the ray that could still hit something in it
+	struct RayRange {
+		size_t first;
+		size_t last;
+		float t0;
+		float t1;
+	};
+
+	int best = -1;
+	float best_t = max_distance;
+	float radius2 = radius * radius;
+
+	RayRange stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = { 0, points_.size(), 0.0f, max_distance };
+
+	while( top > 0 )
+	{
+		RayRange range = stack[--top];
+
+		while( range.first < range.last && range.t0 <= best_t )
+		{
+			size_t mid = range.first + (range.last - range.first) / 2;
+			const glm::vec3& p = points_[mid];
+
+			// Ray against the sphere around this point
+			glm::vec3 to_point = p - origin;
+			float along = glm::dot( to_point, direction );
+			float miss2 = glm::dot( to_point, to_point ) - along * along;
+			if( miss2 <= radius2 )
+			{
+				float t = along - std::sqrt( radius2 - miss2 );
+				if( t < 0.0f && along + std::sqrt( radius2 - miss2 ) >= 0.0f ) t = 0.0f;
+				if( t >= 0.0f && t < best_t )
+				{
+					best_t = t;
+					best = (int)mid;
+				}
+			}
+
+			// Points in the lower half are at most split + radius along the axis, and the upper half
+			// at least split - radius, find the part of the ray that is inside each of those
+			int axis = axes_[mid];
+			float o = origin[axis];
+			float d = direction[axis];
+			float split = p[axis];
+
+			RayRange lower = { range.first, mid, range.t0, std::min( range.t1, best_t ) };
+			RayRange upper = { mid + 1, range.last, range.t0, std::min( range.t1, best_t ) };
+			bool lower_first = true;
+
+			if( d == 0.0f )
+			{
+				if( o > split + radius ) lower.t0 = lower.t1 + 1.0f;
+				if( o < split - radius ) upper.t0 = upper.t1 + 1.0f;
+			}
+			else
+			{
+				float t_lower = (split + radius - o) / d;
+				float t_upper = (split - radius - o) / d;
+				if( d > 0.0f )
+				{
+					lower.t1 = std::min( lower.t1, t_lower );
+					upper.t0 = std::max( upper.t0, t_upper );
+				}
+				else
+				{
+					lower.t0 = std::max( lower.t0, t_lower );
+					upper.t1 = std::min( upper.t1, t_upper );
+					lower_first = false;
+				}
+			}
+
+			// Walk front to back, so once something is hit anything further away can be skipped
+			RayRange& near_side = lower_first ? lower : upper;
+			RayRange& far_side = lower_first ? upper : lower;
+
+			if( far_side.first < far_side.last && far_side.t0 <= far_side.t1 && top < MAX_STACK )
+			{
+				stack[top++] = far_side;
+			}
+
+			if( near_side.t0 > near_side.t1 ) break;
+			range = near_side;
+		}
+	}
+
+	if( best < 0 ) return false;
+
+	if( hit )
+	{
+		hit->index = dataIndex( best );
+		hit->distance = best_t;
+		hit->position = origin + direction * best_t;
+	}
+	return true;
+}
\ No newline at end of file
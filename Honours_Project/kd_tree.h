@@ -0,0 +1,129 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <vector>
+
+// Balanced k-d tree over the points of a cloud, stored implicitly: for any range of points the
+// middle one splits the range, everything before it is on the lower side of the split and
+// everything after it is on the upper side. Building normally reorders the point data itself into
+// tree order, so the index of a point in the tree is also its index in the vertex buffer. If the data
+// can't be moved the tree keeps a table from tree order back to the data instead.
+//
+// All queries return indices into the data the tree was built from.
+//
+// The build is split across threads, each level of the tree is partitioned with nth_element and
+// the two halves are handed to different threads until there are enough to keep every core busy.
+
+class KdTree
+{
+public:
+	struct RayHit {
+		int index = -1;          // Index of the point that was hit
+		float distance = 0.0f;   // Distance along the ray to the surface of the point
+		glm::vec3 position;      // Where the ray hit the surface of the point
+	};
+
+	KdTree();
+	~KdTree();
+
+	// Each point is 'stride' floats starting with XYZ. Reorders 'data' into tree order unless reorder_data is false.
+	// When the data is reordered, 'reordered' receives where each point came from so anything else stored per point can follow
+	void build( std::vector<GLfloat>& data, size_t stride, bool reorder_data = true, std::vector<unsigned int>* reordered = nullptr );
+	void clear();
+
+	// Index of the nearest point, or -1 if there are no points within max_distance.
+	// Positions are in the same space as the data the tree was built from
+	int nearest( const glm::vec3& position, float max_distance = 1e30f, float* distance = nullptr ) const;
+
+	// Up to k nearest points within max_distance, closest first. Clears 'results'
+	void nearest( const glm::vec3& position, size_t k, std::vector<int>& results, float max_distance = 1e30f ) const;
+
+	// First point hit by the ray, treating every point as a sphere of the given radius.
+	// The direction must be normalised, returns false if nothing is hit within max_distance
+	bool raycast( const glm::vec3& origin, const glm::vec3& direction, float radius, float max_distance, RayHit* hit ) const;
+
+	// Result of testing a range's bounds against whatever shape is being queried
+	enum class Overlap { Outside, Intersects, Inside };
+
+	// Walks the tree with the bounds of each range. 'classify( lower, upper )' returns an Overlap,
+	// points in ranges completely inside go to 'visit_range( first, last )' as runs of data indices, and
+	// every point in a range that only intersects goes to 'visit( index, position )' for an exact test
+	template<typename Classify, typename Visit, typename VisitRange>
+	void query( Classify classify, Visit visit, VisitRange visit_range ) const;
+
+	// Getters
+	bool empty() const { return points_.empty(); }
+	size_t size() const { return points_.size(); }
+	// True when tree order and data order are the same
+	bool isDataOrdered() const { return order_.empty(); }
+	double buildTime() const { return build_ms_; }
+
+private:
+	int dataIndex( size_t position ) const { return order_.empty() ? (int)position : (int)order_[position]; }
+
+	void build_range( size_t first, size_t last, glm::vec3 lower, glm::vec3 upper, int threads );
+
+	// Point positions in tree order, kept separately so queries don't have to stride over the colours
+	std::vector<glm::vec3> points_;
+	// The axis each point splits its range on
+	std::vector<unsigned char> axes_;
+	// Maps tree order back to the data, empty once the data has been put in tree order
+	std::vector<unsigned int> order_;
+
+	// Bounds of all the points, each split divides them further
+	glm::vec3 lower_;
+	glm::vec3 upper_;
+
+	double build_ms_ = 0.0;
+};
+
+template<typename Classify, typename Visit, typename VisitRange>
+void KdTree::query( Classify classify, Visit visit, VisitRange visit_range ) const
+{
+	if( points_.empty() ) return;
+
+	struct BoundedRange {
+		size_t first;
+		size_t last;
+		glm::vec3 lower;
+		glm::vec3 upper;
+	};
+
+	BoundedRange stack[128];
+	int top = 0;
+	stack[top++] = { 0, points_.size(), lower_, upper_ };
+
+	while( top > 0 )
+	{
+		BoundedRange range = stack[--top];
+		if( range.first >= range.last ) continue;
+
+		Overlap overlap = classify( range.lower, range.upper );
+		if( overlap == Overlap::Outside ) continue;
+		if( overlap == Overlap::Inside )
+		{
+			if( order_.empty() ) {
+				visit_range( range.first, range.last );
+			} else {
+				for( size_t i = range.first; i < range.last; i++ ) visit_range( (size_t)order_[i], (size_t)order_[i] + 1 );
+			}
+			continue;
+		}
+
+		size_t mid = range.first + (range.last - range.first) / 2;
+		visit( (size_t)dataIndex( mid ), points_[mid] );
+
+		// Both halves are always pushed, so the stack never gets deeper than the tree plus one
+		int axis = axes_[mid];
+		float split = points_[mid][axis];
+
+		BoundedRange lower_half = { range.first, mid, range.lower, range.upper };
+		lower_half.upper[axis] = split;
+		BoundedRange upper_half = { mid + 1, range.last, range.lower, range.upper };
+		upper_half.lower[axis] = split;
+
+		stack[top++] = upper_half;
+		stack[top++] = lower_half;
+	}
+}
\ No newline at end of file
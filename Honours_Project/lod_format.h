@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+// On disk layout of a LOD hierarchy, written by Octree_Converter and streamed back in by PointCloud.
+// A hierarchy is a directory holding two files:
+//	hierarchy.idx	an IndexHeader followed by num_nodes NodeRecords, every parent comes before its children
+//	hierarchy.bin	the points of each node as one contiguous block of lod::Points
+// Every node is a cube and each child covers one octant of its parent. Inner nodes hold a subsample
+// of the points below them with roughly 'spacing' between points, halving every level, so drawing
+// a node and its resident ancestors always gives a complete if coarser picture.
+// Positions are stored relative to the root's lower corner so float precision holds across a whole site.
+
+namespace lod
+{
+	const char INDEX_FILE[] = "hierarchy.idx";
+	const char BLOCK_FILE[] = "hierarchy.bin";
+
+	const uint32_t MAGIC = 0x31444f4c; // "LOD1"
+	const uint32_t VERSION = 1;
+	const int32_t NO_NODE = -1;
+
+	struct IndexHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t num_points;
+		uint32_t num_nodes;
+		uint32_t max_level;
+		double offset[3];		// Original position of the root's lower corner
+		float size;				// Edge length of the root cube
+		float spacing;			// Distance between points in the root, halves every level
+	};
+
+	struct NodeRecord {
+		uint64_t offset;		// Byte offset of the node's block in hierarchy.bin
+		uint32_t num_points;
+		uint32_t level;
+		int32_t parent;
+		int32_t children[8];	// Indexed by octant, x | y << 1 | z << 2
+		float lower[3];			// Relative to the header offset
+		float size;
+	};
+
+	struct Point {
+		float x, y, z;
+		uint8_t r, g, b, a;
+	};
+
+	static_assert( sizeof( Point ) == 16, "lod::Point must be tightly packed" );
+}
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "lod_streamer.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include "gl_state.h"
+
+LodStreamer::LodStreamer()
+{
+	std::memset( &header_, 0, sizeof( header_ ) );
+}
+
+LodStreamer::~LodStreamer()
+{
+	close();
+}
+
+LodStreamer::View LodStreamer::makeView( const glm::mat4& view, const glm::mat4& projection, float viewport_height )
+{
+	View result;
+	result.view_projection = projection * view;
+	result.eye = glm::vec3( glm::inverse( view )[3] );
+	result.pixel_scale = projection[1][1] * viewport_height * 0.5f;
+	return result;
+}
+
+bool LodStreamer::open( const std::string& directory )
+{
+	close();
+
+	std::string index_path = directory + "/" + lod::INDEX_FILE;
+	std::ifstream index( index_path, std::ios::binary );
+	if( !index.good() )
+	{
+		std::cout << "ERROR: could not open '" << index_path << "'" << std::endl;
+		return false;
+	}
+
+	lod::IndexHeader header;
+	index.read( (char*)&header, sizeof( header ) );
+	if( !index.good() || header.magic != lod::MAGIC || header.version != lod::VERSION || header.num_nodes == 0 )
+	{
+		std::cout << "ERROR: '" << index_path << "' is not a LOD hierarchy this version can read" << std::endl;
+		return false;
+	}
+
+	std::vector<lod::NodeRecord> records( header.num_nodes );
+	index.read( (char*)records.data(), sizeof( lod::NodeRecord ) * records.size() );
+	if( !index.good() )
+	{
+		std::cout << "ERROR: '" << index_path << "' is missing nodes" << std::endl;
+		return false;
+	}
+
+	if( !std::ifstream( directory + "/" + lod::BLOCK_FILE, std::ios::binary ).good() )
+	{
+		std::cout << "ERROR: could not open '" << directory << "/" << lod::BLOCK_FILE << "'" << std::endl;
+		return false;
+	}
+
+	directory_ = directory;
+	header_ = header;
+	nodes_.resize( records.size() );
+	for( size_t i = 0; i < records.size(); i++ ) nodes_[i].record = records[i];
+	busy_.assign( nodes_.size(), 0 );
+	stats_ = Stats();
+	frame_ = 0;
+
+	stopping_ = false;
+	for( int t = 0; t < IO_THREADS; t++ ) threads_.push_back( std::thread( &LodStreamer::io_thread, this ) );
+
+	std::cout << "Opened hierarchy '" << directory << "', " << header.num_points << " points in " << header.num_nodes << " nodes over " << header.max_level + 1 << " levels" << std::endl;
+	return true;
+}
+
+void LodStreamer::close()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for( auto& thread : threads_ ) thread.join();
+	threads_.clear();
+
+	while( !lru_.empty() ) evict( lru_.back() );
+	for( uint32_t index : uploading_ )
+	{
+		Node& node = nodes_[index];
+		BufferUploader::get()->wait( node.upload );
+		GLState::deleteBuffers( 1, &node.upload->buffer );
+		node.upload = nullptr;
+	}
+	uploading_.clear();
+	stats_.resident_bytes = 0;
+
+	nodes_.clear();
+	pending_.clear();
+	completed_.clear();
+	busy_.clear();
+	stopping_ = false;
+}
+
+void LodStreamer::update()
+{
+	stats_.uploads = 0;
+	stats_.upload_bytes = 0;
+	if( nodes_.empty() ) return;
+
+	// Take what can be sent this frame, the rest waits for the next one
+	std::vector<Completed> ready;
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		size_t bytes = 0;
+		size_t taken = 0;
+		while( taken < completed_.size() && bytes < UPLOAD_BYTES_PER_FRAME )
+		{
+			bytes += completed_[taken].points.size() * sizeof( lod::Point );
+			busy_[completed_[taken].node] = 0;
+			ready.push_back( std::move( completed_[taken] ) );
+			taken++;
+		}
+		completed_.erase( completed_.begin(), completed_.begin() + taken );
+	}
+	if( !ready.empty() ) wake_.notify_all();
+
+	for( auto& done : ready )
+	{
+		Node& node = nodes_[done.node];
+		if( !done.ok )
+		{
+			std::cout << "ERROR: could not read node " << done.node << " from '" << directory_ << "/" << lod::BLOCK_FILE << "'" << std::endl;
+			node.failed = true;
+			continue;
+		}
+		if( node.resident || node.upload ) continue;
+
+		if( !make_room( done.points.size() * sizeof( lod::Point ) ) )
+		{
+			stats_.over_budget++;
+			continue;
+		}
+		start_upload( done.node, std::move( done.points ), done.prefetch );
+	}
+
+	// Nodes only become resident once the render thread can see their buffers are complete
+	BufferUploader* uploader = BufferUploader::get();
+	for( size_t i = 0; i < uploading_.size(); )
+	{
+		if( uploader->finished( nodes_[uploading_[i]].upload ) )
+		{
+			finish_upload( uploading_[i] );
+			uploading_[i] = uploading_.back();
+			uploading_.pop_back();
+		}
+		else i++;
+	}
+
+	stats_.resident_nodes = (uint32_t)lru_.size();
+	stats_.uploading = (uint32_t)uploading_.size();
+}
+
+void LodStreamer::submit( RenderQueue& queue, const DrawItem& item, const glm::mat4& model, const View* views, int num_views )
+{
+	frame_++;
+	stats_.drawn_nodes = 0;
+	stats_.drawn_points = 0;
+	stats_.missing_nodes = 0;
+	if( nodes_.empty() ) return;
+
+	float model_scale = glm::length( glm::vec3( model[0] ) );
+	heap_.clear();
+	requests_.clear();
+	stats_.prefetch_requests = 0;
+	visit( 0, model, model_scale, views, num_views );
+
+	// Biggest on screen first, until the point budget runs out
+	while( !heap_.empty() )
+	{
+		std::pop_heap( heap_.begin(), heap_.end() );
+		float priority = heap_.back().first;
+		uint32_t index = heap_.back().second;
+		heap_.pop_back();
+
+		Node& node = nodes_[index];
+		if( !node.resident )
+		{
+			// Its parent is drawn in its place until it arrives
+			if( !node.failed && !node.upload ) requests_.push_back( Request{ index, priority, false } );
+			node.requested_frame = frame_;
+			stats_.missing_nodes++;
+			continue;
+		}
+		if( stats_.drawn_nodes > 0 && stats_.drawn_points + node.record.num_points > point_budget_ ) break;
+
+		const lod::NodeRecord& record = node.record;
+		DrawItem draw = item;
+		draw.vao = node.vao;
+		draw.first = 0;
+		draw.count = (GLsizei)record.num_points;
+		draw.model = model;
+		draw.centre = glm::vec3( record.lower[0], record.lower[1], record.lower[2] ) + record.size * 0.5f;
+		queue.submit( draw );
+
+		node.last_drawn = frame_;
+		lru_.splice( lru_.begin(), lru_, node.lru );
+		if( node.prefetched )
+		{
+			node.prefetched = false;
+			stats_.prefetch_hits++;
+		}
+		stats_.drawn_nodes++;
+		stats_.drawn_points += record.num_points;
+
+		// Only worth going into the children while the node is still big on screen
+		if( priority < min_node_pixels_ ) continue;
+		for( int32_t child : record.children )
+		{
+			if( child != lod::NO_NODE ) visit( (uint32_t)child, model, model_scale, views, num_views );
+		}
+	}
+
+	stats_.frames++;
+	if( stats_.missing_nodes > 0 ) stats_.frames_missing++;
+
+	if( !prefetch_views_.empty() ) prefetch();
+
+	// Replace last frame's requests, anything that left the view since then is forgotten
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		pending_.clear();
+		for( const Request& request : requests_ )
+		{
+			if( !busy_[request.node] ) pending_.push_back( request );
+		}
+		std::sort( pending_.begin(), pending_.end(), []( const Request& a, const Request& b ) {
+			if( a.prefetch != b.prefetch ) return a.prefetch;
+			return a.priority < b.priority;
+		} );
+		stats_.pending_requests = (uint32_t)pending_.size();
+	}
+	if( !requests_.empty() ) wake_.notify_all();
+}
+
+void LodStreamer::setPrefetch( const View* views, int num_views, const glm::mat4& model )
+{
+	prefetch_views_.assign( views, views + num_views );
+	prefetch_model_ = model;
+}
+
+void LodStreamer::prefetch()
+{
+	float model_scale = glm::length( glm::vec3( prefetch_model_[0] ) );
+	heap_.clear();
+	visit( 0, prefetch_model_, model_scale, prefetch_views_.data(), (int)prefetch_views_.size() );
+
+	// The same walk as submit(), except it carries on below nodes that aren't resident
+	uint64_t points = 0;
+	while( !heap_.empty() )
+	{
+		std::pop_heap( heap_.begin(), heap_.end() );
+		float priority = heap_.back().first;
+		uint32_t index = heap_.back().second;
+		heap_.pop_back();
+
+		Node& node = nodes_[index];
+		if( node.failed ) continue;
+		if( points > 0 && points + node.record.num_points > point_budget_ ) break;
+		points += node.record.num_points;
+
+		if( node.resident )
+		{
+			// About to be needed, so it is as useful as anything drawn this frame
+			node.last_drawn = frame_;
+			lru_.splice( lru_.begin(), lru_, node.lru );
+		}
+		else if( node.requested_frame != frame_ && !node.upload )
+		{
+			requests_.push_back( Request{ index, priority, true } );
+			node.requested_frame = frame_;
+			stats_.prefetch_requests++;
+		}
+
+		if( priority < min_node_pixels_ ) continue;
+		for( int32_t child : node.record.children )
+		{
+			if( child != lod::NO_NODE ) visit( (uint32_t)child, prefetch_model_, model_scale, prefetch_views_.data(), (int)prefetch_views_.size() );
+		}
+	}
+}
+
+void LodStreamer::visit( uint32_t index, const glm::mat4& model, float model_scale, const View* views, int num_views )
+{
+	float priority = node_priority( nodes_[index], model, model_scale, views, num_views );
+	if( priority <= 0.0f ) return;
+	heap_.push_back( std::make_pair( priority, index ) );
+	std::push_heap( heap_.begin(), heap_.end() );
+}
+
+float LodStreamer::node_priority( const Node& node, const glm::mat4& model, float model_scale, const View* views, int num_views ) const
+{
+	const lod::NodeRecord& record = node.record;
+	glm::vec3 local_centre = glm::vec3( record.lower[0], record.lower[1], record.lower[2] ) + record.size * 0.5f;
+	glm::vec3 centre = glm::vec3( model * glm::vec4( local_centre, 1.0f ) );
+	float radius = record.size * 0.8660254f * model_scale;
+
+	float best = 0.0f;
+	for( int v = 0; v < num_views; v++ )
+	{
+		// Test the bounding sphere against each clip plane, taken from the rows of the view projection
+		const glm::mat4& m = views[v].view_projection;
+		glm::vec4 w_row( m[0][3], m[1][3], m[2][3], m[3][3] );
+		bool inside = true;
+		for( int plane = 0; plane < 6 && inside; plane++ )
+		{
+			int axis = plane / 2;
+			float sign = (plane & 1) ? -1.0f : 1.0f;
+			glm::vec4 p = w_row + sign * glm::vec4( m[0][axis], m[1][axis], m[2][axis], m[3][axis] );
+			float length = glm::length( glm::vec3( p ) );
+			inside = length <= 0.0f || (glm::dot( glm::vec3( p ), centre ) + p.w) / length >= -radius;
+		}
+		if( !inside ) continue;
+
+		// Inside the node this is always more than the pixel scale, so the children get visited
+		float distance = glm::length( centre - views[v].eye );
+		best = std::max( best, views[v].pixel_scale * radius / std::max( distance, 1e-4f ) );
+	}
+	return best;
+}
+
+void LodStreamer::start_upload( uint32_t index, std::vector<lod::Point>&& points, bool prefetch )
+{
+	Node& node = nodes_[index];
+	size_t bytes = points.size() * sizeof( lod::Point );
+
+	// The points move into the job, so nothing here has to outlive it
+	node.upload = BufferUploader::get()->upload( (GLsizeiptr)bytes, [points = std::move( points )]( void* destination ) {
+		std::memcpy( destination, points.data(), points.size() * sizeof( lod::Point ) );
+	} );
+	node.prefetched = prefetch;
+	uploading_.push_back( index );
+
+	stats_.resident_bytes += bytes;
+	stats_.uploads++;
+	stats_.upload_bytes += bytes;
+}
+
+void LodStreamer::finish_upload( uint32_t index )
+{
+	Node& node = nodes_[index];
+	BufferUploader::Handle upload = node.upload;
+	node.upload = nullptr;
+
+	if( upload->failed )
+	{
+		std::cout << "ERROR: could not upload node " << index << std::endl;
+		GLState::deleteBuffers( 1, &upload->buffer );
+		stats_.resident_bytes -= (size_t)upload->size;
+		node.prefetched = false;
+		node.failed = true;
+		return;
+	}
+
+	node.vbo = upload->buffer;
+	glGenVertexArrays( 1, &node.vao );
+	GLState::bindVertexArray( node.vao );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, node.vbo );
+
+	// Same attributes as a loaded file, colour comes in as normalised bytes. Selection and normals are
+	// left disabled so the shaders see an unselected point
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( lod::Point ), (const void *)offsetof( lod::Point, x ) );
+	glEnableVertexAttribArray( 1 );
+	glVertexAttribPointer( 1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( lod::Point ), (const void *)offsetof( lod::Point, r ) );
+	GLState::bindVertexArray( 0 );
+
+	// Counts as drawn last frame, so it can't be evicted by the uploads that follow it
+	node.resident = true;
+	node.last_drawn = frame_;
+	lru_.push_front( index );
+	node.lru = lru_.begin();
+
+	stats_.total_loads++;
+	if( node.prefetched ) stats_.prefetch_loads++;
+}
+
+void LodStreamer::evict( uint32_t index )
+{
+	Node& node = nodes_[index];
+	GLState::deleteVertexArrays( 1, &node.vao );
+	GLState::deleteBuffers( 1, &node.vbo );
+	node.vao = 0;
+	node.vbo = 0;
+	node.resident = false;
+	lru_.erase( node.lru );
+	if( node.prefetched ) stats_.prefetch_wasted++;
+	node.prefetched = false;
+
+	stats_.resident_bytes -= node.record.num_points * sizeof( lod::Point );
+	stats_.total_evictions++;
+}
+
+bool LodStreamer::make_room( size_t bytes )
+{
+	while( stats_.resident_bytes + bytes > gpu_budget_ )
+	{
+		if( lru_.empty() ) return false;
+
+		// Everything past here was drawn last frame too
+		uint32_t oldest = lru_.back();
+		if( nodes_[oldest].last_drawn >= frame_ ) return false;
+		evict( oldest );
+	}
+	return true;
+}
+
+void LodStreamer::io_thread()
+{
+	// Each thread has its own handle so reads never wait on each other's seeks
+	std::ifstream blocks( directory_ + "/" + lod::BLOCK_FILE, std::ios::binary );
+
+	while( true )
+	{
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+			wake_.wait( lock, [this]() { return stopping_ || (!pending_.empty() && completed_.size() < MAX_COMPLETED); } );
+			if( stopping_ ) return;
+
+			request = pending_.back();
+			pending_.pop_back();
+			busy_[request.node] = 1;
+		}
+
+		// Records never change while the threads are running
+		const lod::NodeRecord& record = nodes_[request.node].record;
+		Completed done;
+		done.node = request.node;
+		done.prefetch = request.prefetch;
+		done.points.resize( record.num_points );
+
+		std::streamsize bytes = (std::streamsize)(record.num_points * sizeof( lod::Point ));
+		blocks.clear();
+		blocks.seekg( (std::streamoff)record.offset );
+		blocks.read( (char*)done.points.data(), bytes );
+		done.ok = blocks.gcount() == bytes;
+
+		std::lock_guard<std::mutex> lock( mutex_ );
+		completed_.push_back( std::move( done ) );
+	}
+}
\ No newline at end of file
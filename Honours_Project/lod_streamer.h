@@ -0,0 +1,172 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <string>
+#include <vector>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include "lod_format.h"
+#include "render_queue.h"
+#include "buffer_uploader.h"
+
+// Draws a LOD hierarchy made by Octree_Converter, which can be far bigger than memory. Only the node
+// index is read up front. Each frame the nodes in view are visited biggest on screen first, and any
+// that aren't resident are requested from IO threads that read their blocks off the disk. Finished
+// blocks are handed a few per frame to the BufferUploader, whose thread fills their buffers, and join
+// a cache that evicts the least recently drawn nodes to stay inside a memory budget. Nothing here
+// waits on the disk: a node that isn't resident or is still uploading just isn't drawn, and its
+// parent, which must be resident for it to be visited at all, covers the same space at a lower density.
+// To hide popping when the head turns quickly, nodes for views predicted a little way ahead are
+// requested too. They always come after everything that is in view now.
+
+class LodStreamer
+{
+public:
+	LodStreamer();
+	~LodStreamer();
+
+	// Where the hierarchy is drawn from this frame, see makeView()
+	struct View {
+		glm::mat4 view_projection;
+		glm::vec3 eye;               // World space
+		float pixel_scale = 1.0f;    // Pixels on screen for a size of one at a distance of one
+	};
+	static View makeView( const glm::mat4& view, const glm::mat4& projection, float viewport_height );
+
+	// Reads the index and starts the IO threads, returns false if the hierarchy can't be read
+	bool open( const std::string& directory );
+	// Stops the IO threads and frees every resident node
+	void close();
+	bool isOpen() const { return !nodes_.empty(); }
+
+	// Starts uploading blocks that have finished loading, evicting nodes that weren't drawn last frame to make
+	// room, and makes nodes whose uploads have finished resident
+	void update();
+
+	// Submits the nodes to draw from these views and requests the missing ones, nearest and biggest first.
+	// 'item' is copied for every node with the vao, count and centre filled in, 'model' takes the hierarchy to world space
+	void submit( RenderQueue& queue, const DrawItem& item, const glm::mat4& model, const View* views, int num_views );
+	// Views and model matrix predicted prefetchTime() ahead, used by the following submit(). Pass no views to stop prefetching
+	void setPrefetch( const View* views, int num_views, const glm::mat4& model );
+
+	// Counts are for the last frame unless they say otherwise
+	struct Stats {
+		uint32_t drawn_nodes = 0;
+		uint64_t drawn_points = 0;
+		uint32_t missing_nodes = 0;      // Should have been drawn but weren't resident
+		uint32_t resident_nodes = 0;
+		size_t resident_bytes = 0;       // Including uploads that haven't finished
+		uint32_t pending_requests = 0;
+		uint32_t uploads = 0;            // Handed to the upload thread
+		size_t upload_bytes = 0;
+		uint32_t uploading = 0;          // Still being filled by the upload thread
+		uint64_t total_loads = 0;        // Since the hierarchy was opened
+		uint64_t total_evictions = 0;
+		uint64_t over_budget = 0;        // Loaded blocks thrown away because everything resident was in use
+		uint32_t prefetch_requests = 0;  // Only needed by the predicted views
+		uint64_t prefetch_loads = 0;     // Totals from here on
+		uint64_t prefetch_hits = 0;      // Prefetched nodes that were drawn before being evicted
+		uint64_t prefetch_wasted = 0;    // Prefetched nodes evicted without ever being drawn
+		uint64_t frames = 0;
+		uint64_t frames_missing = 0;     // Frames where any node that should have been drawn wasn't resident
+	};
+	const Stats& stats() const { return stats_; }
+
+	// Setters
+	void setGpuBudget( size_t bytes ) { gpu_budget_ = bytes; }
+	void setPointBudget( size_t points ) { point_budget_ = points; }
+	void setMinNodePixels( float pixels ) { min_node_pixels_ = pixels; }
+	void setPrefetchTime( float seconds ) { prefetch_time_ = seconds; }
+
+	// Getters
+	const lod::IndexHeader& header() const { return header_; }
+	size_t gpuBudget() const { return gpu_budget_; }
+	size_t pointBudget() const { return point_budget_; }
+	float minNodePixels() const { return min_node_pixels_; }
+	float prefetchTime() const { return prefetch_time_; }
+
+	static const int IO_THREADS = 2;
+	// Blocks that can sit loaded in memory waiting for upload, the IO threads wait when there are this many
+	static const size_t MAX_COMPLETED = 64;
+	// Most bytes handed to the upload thread in a single frame
+	static const size_t UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+protected:
+	struct Node {
+		lod::NodeRecord record;
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		BufferUploader::Handle upload;   // Set while the upload thread is filling the buffer
+		bool resident = false;
+		bool failed = false;
+		bool prefetched = false;         // Loaded for a predicted view and not drawn yet
+		uint64_t last_drawn = 0;
+		uint64_t requested_frame = 0;
+		std::list<uint32_t>::iterator lru;
+	};
+
+	struct Request {
+		uint32_t node;
+		float priority;
+		bool prefetch;
+	};
+
+	struct Completed {
+		uint32_t node;
+		bool ok;
+		bool prefetch;
+		std::vector<lod::Point> points;
+	};
+
+	void io_thread();
+	// Hands the points to the upload thread, their bytes count against the budget from here on
+	void start_upload( uint32_t index, std::vector<lod::Point>&& points, bool prefetch );
+	// Makes the vertex array for the finished buffer and adds the node to the cache
+	void finish_upload( uint32_t index );
+	void evict( uint32_t index );
+	// Evicts until 'bytes' more fit in the budget, false if that would mean evicting something drawn last frame
+	bool make_room( size_t bytes );
+
+	// Requests what the predicted views would draw that isn't resident, and keeps what is from being evicted
+	void prefetch();
+	// Pushes the node onto the traversal heap if any of the views can see it
+	void visit( uint32_t index, const glm::mat4& model, float model_scale, const View* views, int num_views );
+	// Largest size on screen of the node in pixels over the views it is in, 0 if it isn't in any
+	float node_priority( const Node& node, const glm::mat4& model, float model_scale, const View* views, int num_views ) const;
+
+	std::string directory_;
+	lod::IndexHeader header_;
+	std::vector<Node> nodes_;
+
+	// Front is the most recently drawn
+	std::list<uint32_t> lru_;
+	std::vector<uint32_t> uploading_;
+	uint64_t frame_ = 0;
+	size_t gpu_budget_ = (size_t)512 * 1024 * 1024;
+	size_t point_budget_ = 10000000;
+	float min_node_pixels_ = 150.0f;
+	float prefetch_time_ = 0.3f;
+	Stats stats_;
+
+	std::vector<View> prefetch_views_;
+	glm::mat4 prefetch_model_;
+
+	// Scratch space reused every frame
+	std::vector<std::pair<float, uint32_t>> heap_;
+	std::vector<Request> requests_;
+
+	// Shared with the IO threads. 'pending_' is sorted lowest priority first with prefetches below everything else, 'busy_' marks
+	// nodes being read or waiting in 'completed_' so they aren't asked for again
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::vector<Request> pending_;
+	std::vector<Completed> completed_;
+	std::vector<uint8_t> busy_;
+	bool stopping_ = false;
+};
\ No newline at end of file
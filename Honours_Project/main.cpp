@@ -14,6 +14,16 @@
 #include "vr_system.h"
 #include "scene.h"
 #include "point_cloud.h"
+#include "camera_uniforms.h"
+#include "render_queue.h"
+#include "gl_state.h"
+#include "frame_pipeline.h"
+#include "stream_buffer.h"
+#include "buffer_uploader.h"
+#include "debug_draw.h"
+#include "benchmarks.h"
+#include "id_picker.h"
+#include "proximity_service.h"
 #include "imgui/imgui.h"
 
 // TODO:
@@ -28,7 +38,7 @@
 enum class RenderMode { VR, Standard };
 
 void set_gl_attribs();
-void draw_gui();
+void draw_gui( RenderQueue& render_queue, Scene& scene, IdPicker& id_picker );
 
 struct AudioData
 {
@@ -92,17 +102,37 @@ int main(int argc, char** argv)
 {
 	// Setup
 	Window* window;
+	FramePipeline* frame_pipeline;
+	StreamBuffer* stream_buffer;
+	BufferUploader* buffer_uploader;
 	Camera standard_camera;
 	VRSystem* vr_system;
 	Scene scene;
 	ShaderProgram standard_shader;
 	ShaderProgram point_light_shader;
+	CameraUniforms camera_uniforms;
+	RenderQueue render_queue;
+	IdPicker id_picker;
+	ProximityService proximity;
 	RenderMode render_mode = RenderMode::VR;
 
+	// Lasso selection with the right mouse button in the standard view, hold shift to deselect
+	std::vector<glm::vec2> lasso;
+	bool lasso_active = false;
+	bool lasso_deselect = false;
+	glm::mat4 standard_view_projection;
+
 	// First stage initialisation
 	bool running = true;
 	window = Window::get();
 	if( !window ) running = false;
+	frame_pipeline = FramePipeline::get();
+	if( !frame_pipeline ) running = false;
+	stream_buffer = StreamBuffer::get();
+	if( !stream_buffer ) running = false;
+	// Needs the window's context current to share with it
+	buffer_uploader = BufferUploader::get();
+	if( !buffer_uploader ) running = false;
 	vr_system = VRSystem::get();
 	if( !vr_system ) running = false;
 	ImGui::Init( window->SDLWindow() );
@@ -112,6 +142,15 @@ int main(int argc, char** argv)
 	{
 		//test_audio();
 
+		// Shared view and projection for every shader
+		camera_uniforms.init();
+
+		// Lines from anywhere in the frame are batched into one draw
+		DebugDraw::init();
+
+		// Picking by point index, for the cursor in the standard view and the controller in VR
+		id_picker.init();
+
 		// Shaders
 		standard_shader.init( "colour_shader_vs.glsl", "colour_shader_fs.glsl" );
 		point_light_shader.init( "point_light_shader_vs.glsl", "point_light_shader_fs.glsl" );
@@ -122,9 +161,12 @@ int main(int argc, char** argv)
 		//vr_system->pointLightTool()->setActivateShader( &point_light_shader );
 		vr_system->pointerTool()->setShader( &standard_shader );
 		vr_system->setPointCloud( scene.pointCloud() );
-		Sphere::setShader( &standard_shader );
 
 		scene.init();
+
+		// Buzz the pointer's controller near the scan
+		vr_system->pointerTool()->setProximityService( &proximity );
+		proximity.start( scene.pointCloud() );
 	}
 
 	float dt = 0.0;
@@ -133,6 +175,13 @@ int main(int argc, char** argv)
 
 	while( running )
 	{
+		// Waits here if the GPU has fallen too far behind, everything after overlaps with it drawing the last frames
+		GLState::beginFrame();
+		frame_pipeline->beginFrame();
+		frame_pipeline->beginSection( "Update" );
+		stream_buffer->beginFrame();
+		id_picker.poll();
+
 		SDL_Event sdl_event;
 		while( SDL_PollEvent( &sdl_event ) )
 		{
@@ -158,6 +207,83 @@ int main(int argc, char** argv)
 				{
 					scene.toggle_spheres();
 				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_F1 )
+				{
+					benchmark_spatial_hash();
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_F2 )
+				{
+					benchmark_kd_tree();
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_F3 )
+				{
+					benchmark_raycast( *scene.pointCloud() );
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_F4 )
+				{
+					// Record the pointer for replay_proximity()
+					if( proximity.isRecording() )
+					{
+						proximity.stopRecording();
+						ProximityService::saveRecording( "poses.txt", proximity.recording() );
+					}
+					else
+					{
+						proximity.startRecording();
+						std::cout << "Recording pointer poses" << std::endl;
+					}
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_F5 )
+				{
+					// Like the other benchmarks this holds up the frame, for the whole length of the recording
+					replay_proximity( *scene.pointCloud(), "poses.txt" );
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_F6 )
+				{
+					benchmark_backface_culling( *scene.pointCloud() );
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_DELETE )
+				{
+					scene.pointCloud()->deleteSelection();
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_Z && (SDL_GetModState() & KMOD_CTRL) )
+				{
+					scene.pointCloud()->undo();
+				}
+				else if( sdl_event.key.keysym.scancode == SDL_SCANCODE_Y && (SDL_GetModState() & KMOD_CTRL) )
+				{
+					scene.pointCloud()->redo();
+				}
+			}
+
+			else if( render_mode == RenderMode::Standard )
+			{
+				// Click to select the picked point, hold shift to deselect
+				if( sdl_event.type == SDL_MOUSEBUTTONDOWN && sdl_event.button.button == SDL_BUTTON_LEFT && id_picker.enabled() && !ImGui::GetIO().WantCaptureMouse )
+				{
+					int picked = id_picker.result().index;
+					if( picked >= 0 && (size_t)picked < scene.pointCloud()->numPoints() )
+					{
+						scene.pointCloud()->selectPoint( picked, (SDL_GetModState() & KMOD_SHIFT) == 0 );
+					}
+				}
+				else if( sdl_event.type == SDL_MOUSEBUTTONDOWN && sdl_event.button.button == SDL_BUTTON_RIGHT && !ImGui::GetIO().WantCaptureMouse )
+				{
+					lasso.clear();
+					lasso_active = true;
+					lasso_deselect = (SDL_GetModState() & KMOD_SHIFT) != 0;
+				}
+				else if( sdl_event.type == SDL_MOUSEMOTION && lasso_active )
+				{
+					// Store the lasso in normalised device coordinates
+					lasso.push_back( glm::vec2( 2.0f * sdl_event.motion.x / window->width() - 1.0f, 1.0f - 2.0f * sdl_event.motion.y / window->height() ) );
+				}
+				else if( sdl_event.type == SDL_MOUSEBUTTONUP && sdl_event.button.button == SDL_BUTTON_RIGHT && lasso_active )
+				{
+					scene.pointCloud()->selectLasso( lasso, standard_view_projection, !lasso_deselect );
+					lasso_active = false;
+					lasso.clear();
+				}
 			}
 
 			ImGui::ProcessEvent( &sdl_event );
@@ -172,11 +298,70 @@ int main(int argc, char** argv)
 
 		scene.update( dt );
 
+		// Where the frame will be seen from, so the point cloud can skip chunks that face away from every eye
+		// and a streamed hierarchy knows which nodes are in view
+		glm::vec3 eyes[2];
+		LodStreamer::View views[2];
+		int num_eyes = 0;
 		if( render_mode == RenderMode::VR )
 		{
-			// Grab matricies from the HMD
-			glm::mat4 hmd_view_left = vr_system->viewMatrix( vr::Eye_Left );
-			glm::mat4 hmd_view_right = vr_system->viewMatrix( vr::Eye_Right );
+			float eye_height = (float)vr_system->renderTargetHeight();
+			views[num_eyes++] = LodStreamer::makeView( vr_system->viewMatrix( vr::Eye_Left ), vr_system->projectionMartix( vr::Eye_Left ), eye_height );
+			views[num_eyes++] = LodStreamer::makeView( vr_system->viewMatrix( vr::Eye_Right ), vr_system->projectionMartix( vr::Eye_Right ), eye_height );
+		}
+		else
+		{
+			standard_camera.update( dt );
+			views[num_eyes++] = LodStreamer::makeView( standard_camera.view(), standard_camera.projection( window->width(), window->height() ), (float)window->height() );
+		}
+		for( int e = 0; e < num_eyes; e++ ) eyes[e] = views[e].eye;
+		scene.pointCloud()->setViewpoints( eyes, num_eyes );
+		scene.pointCloud()->setViews( views, num_eyes );
+
+		// Streamed nodes are fetched early for where the head is heading, the standard camera has no velocity to go on
+		LodStreamer::View predicted_views[2];
+		int num_predicted = 0;
+		float prefetch_time = scene.pointCloud()->streamer().prefetchTime();
+		if( render_mode == RenderMode::VR && prefetch_time > 0.0f )
+		{
+			float eye_height = (float)vr_system->renderTargetHeight();
+			predicted_views[num_predicted++] = LodStreamer::makeView( vr_system->predictedViewMatrix( vr::Eye_Left, prefetch_time ), vr_system->projectionMartix( vr::Eye_Left ), eye_height );
+			predicted_views[num_predicted++] = LodStreamer::makeView( vr_system->predictedViewMatrix( vr::Eye_Right, prefetch_time ), vr_system->projectionMartix( vr::Eye_Right ), eye_height );
+		}
+		scene.pointCloud()->setPrefetchViews( predicted_views, num_predicted );
+
+		// Collect everything to draw this frame, each eye sorts and draws the same list
+		render_queue.clear();
+		scene.submit( render_queue );
+		vr_system->submit( render_queue );
+
+		// Show the lasso just in front of the near plane
+		if( lasso_active && lasso.size() > 1 )
+		{
+			glm::mat4 inverse_view_projection = glm::inverse( standard_view_projection );
+			for( size_t i = 1; i < lasso.size(); i++ )
+			{
+				glm::vec4 a = inverse_view_projection * glm::vec4( lasso[i - 1], -0.99f, 1.0f );
+				glm::vec4 b = inverse_view_projection * glm::vec4( lasso[i], -0.99f, 1.0f );
+				DebugDraw::line( glm::vec3( a ) / a.w, glm::vec3( b ) / b.w, glm::vec3( 1.0f, 0.8f, 0.0f ) );
+			}
+		}
+
+		// Mark the picked point, it may be from before the last edit
+		int picked = id_picker.result().index;
+		if( id_picker.enabled() && picked >= 0 && (size_t)picked < scene.pointCloud()->numPoints() )
+		{
+			DebugDraw::sphere( scene.pointCloud()->worldPosition( picked ), 0.005f, glm::vec3( 0.0f, 1.0f, 1.0f ) );
+		}
+
+		DebugDraw::submit( render_queue );
+
+		// Everything written into the stream buffer this frame must be visible before drawing
+		stream_buffer->flush();
+
+		if( render_mode == RenderMode::VR )
+		{
+			// Grab matricies from the HMD, the views are taken just before each eye is drawn
 			glm::mat4 hmd_projection_left = vr_system->projectionMartix( vr::Eye_Left );
 			glm::mat4 hmd_projection_right = vr_system->projectionMartix( vr::Eye_Right );
 
@@ -184,6 +369,7 @@ int main(int argc, char** argv)
 			// - render texture is not multisampled
 			// - But blitting to the resolve buffer is not working
 
+			frame_pipeline->beginSection( "Render" );
 			vr_system->bindEyeTexture( vr::Eye_Left );
 			//glBindFramebuffer( GL_FRAMEBUFFER, vr_system->resolveEyeTexture( vr::Eye_Left ) );
 			//glViewport( 0, 0, vr_system->renderTargetWidth(), vr_system->renderTargetHeight() );
@@ -191,12 +377,17 @@ int main(int argc, char** argv)
 			set_gl_attribs();
 			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-			scene.render( hmd_view_left, hmd_projection_left );
-			vr_system->render( hmd_view_left, hmd_projection_left );
+			// The pose from the start of the frame is stale by now, so ask again with the least time left to predict
+			vr_system->lateUpdateHmdPose( vr::Eye_Left );
+			glm::mat4 hmd_view_left = vr_system->viewMatrix( vr::Eye_Left );
+			camera_uniforms.update( vr::Eye_Left, hmd_view_left, hmd_projection_left );
+			render_queue.execute( hmd_view_left );
 
-			draw_gui();
+			frame_pipeline->beginSection( "GUI" );
+			draw_gui( render_queue, scene, id_picker );
 			ImGui::Render();
 
+			frame_pipeline->beginSection( "Render" );
 			vr_system->bindEyeTexture( vr::Eye_Right );
 			//glBindFramebuffer( GL_FRAMEBUFFER, vr_system->resolveEyeTexture( vr::Eye_Right ) );
 			//glViewport( 0, 0, vr_system->renderTargetWidth(), vr_system->renderTargetHeight() );
@@ -204,33 +395,62 @@ int main(int argc, char** argv)
 			set_gl_attribs();
 			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-			scene.render( hmd_view_right, hmd_projection_right );
-			vr_system->render( hmd_view_right, hmd_projection_right );
+			vr_system->lateUpdateHmdPose( vr::Eye_Right );
+			glm::mat4 hmd_view_right = vr_system->viewMatrix( vr::Eye_Right );
+			camera_uniforms.update( vr::Eye_Right, hmd_view_right, hmd_projection_right );
+			render_queue.execute( hmd_view_right );
 
+			frame_pipeline->beginSection( "Submit" );
 			vr_system->blitEyeTextures();
 			vr_system->submitEyeTextures();
 
+			frame_pipeline->beginSection( "Window" );
 			window->render( vr_system->resolveEyeTexture( vr::Eye_Left ), vr_system->resolveEyeTexture( vr::Eye_Right ) );
 		}
 		else if( render_mode == RenderMode::Standard )
 		{
-			// Get matricies from the 'traditional' camera
-			standard_camera.update( dt );
+			// Get matricies from the 'traditional' camera, it was moved before anything was submitted
 			glm::mat4 view = standard_camera.view();
 			glm::mat4 projection = standard_camera.projection( window->width(), window->height() );
+			standard_view_projection = projection * view;
 
-			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+			frame_pipeline->beginSection( "Render" );
+			GLState::bindFramebuffer( GL_FRAMEBUFFER, 0 );
 			set_gl_attribs();
-			glViewport( 0, 0, window->width(), window->height() );
+			GLState::viewport( 0, 0, window->width(), window->height() );
 			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 			
-			scene.render( view, projection );
-			vr_system->render( view, projection );
+			camera_uniforms.update( CAMERA_EYE_STANDARD, view, projection );
+			render_queue.execute( view );
 
-			draw_gui();
+			frame_pipeline->beginSection( "GUI" );
+			draw_gui( render_queue, scene, id_picker );
 			ImGui::Render();
 		}
-		
+
+		// Picks are drawn last so they never hold up the frame, the results are collected in a later frame by poll()
+		if( id_picker.enabled() )
+		{
+			frame_pipeline->beginSection( "Pick" );
+			if( render_mode == RenderMode::Standard )
+			{
+				int mouse_x, mouse_y;
+				SDL_GetMouseState( &mouse_x, &mouse_y );
+				glm::vec2 cursor( 2.0f * mouse_x / window->width() - 1.0f, 1.0f - 2.0f * mouse_y / window->height() );
+				glm::vec2 region( 2.0f * IdPicker::PICK_SIZE / window->width(), 2.0f * IdPicker::PICK_SIZE / window->height() );
+				id_picker.pick( *scene.pointCloud(), IdPicker::regionMatrix( cursor, region ) * standard_view_projection );
+			}
+			else
+			{
+				// A narrow view straight down the controller
+				glm::mat4 controller_view = glm::inverse( vr_system->pointerTool()->controllerMatrix() );
+				glm::mat4 controller_projection = glm::perspective( glm::radians( 2.0f ), 1.0f, 0.01f, 20.0f );
+				id_picker.pick( *scene.pointCloud(), controller_projection * controller_view );
+			}
+		}
+
+		stream_buffer->endFrame();
+		frame_pipeline->endFrame();
 		window->present();
 
 		// Update dt
@@ -240,8 +460,15 @@ int main(int argc, char** argv)
 	}
 
 	// Cleanup
+	proximity.stop();
 	scene.shutdown();
+	id_picker.shutdown();
+	DebugDraw::shutdown();
+	camera_uniforms.shutdown();
 	if( vr_system ) delete vr_system;
+	if( stream_buffer ) delete stream_buffer;
+	if( frame_pipeline ) delete frame_pipeline;
+	if( buffer_uploader ) delete buffer_uploader;
 	if( window ) delete window;
 
 	return 0;
@@ -249,13 +476,13 @@ int main(int argc, char** argv)
 
 void set_gl_attribs()
 {
-	glEnable( GL_DEPTH_TEST );
-	glDepthFunc( GL_LESS );
-	glClearColor( 0.01f, 0.01f, 0.01f, 1.0f );
-	glClearDepth( 1.0f );
+	GLState::enable( GL_DEPTH_TEST );
+	GLState::depthFunc( GL_LESS );
+	GLState::clearColor( 0.01f, 0.01f, 0.01f, 1.0f );
+	GLState::clearDepth( 1.0f );
 }
 
-void draw_gui()
+void draw_gui( RenderQueue& render_queue, Scene& scene, IdPicker& id_picker )
 {
 	VRSystem* system = VRSystem::get();
 	ImGuiIO& IO = ImGui::GetIO();
@@ -264,7 +491,140 @@ void draw_gui()
 	ImGui::SetWindowFontScale( 3.0f );
 	ImGui::Text( "Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate );
 	ImGui::Separator();
+
+	// Counts are for the whole of the previous frame, both eyes included
+	const RenderQueue::Stats& stats = render_queue.lastFrameStats();
+	ImGui::Text( "Draw calls: %u, program binds: %u, VAO binds: %u", stats.draw_calls, stats.program_binds, stats.vao_binds );
+	ImGui::Text( "Debug line verts: %d", DebugDraw::numVerts() );
+	ImGui::Text( "Target tests: %u of %u targets", scene.targetTests(), (unsigned int)scene.numTargets() );
+	const SceneSimulation& simulation = scene.simulation();
+	const SceneSimulation::Snapshot& snapshot = simulation.snapshot();
+	ImGui::Text( "Simulation: %u ticks/s, %.3fms a tick, snapshot from frame %u%s", simulation.ticksPerSecond(), snapshot.tick_ms, (unsigned int)snapshot.input_frame, snapshot.test_mode ? ", testing" : "" );
+
+	bool snapping = system->pointerTool()->snapping();
+	if( ImGui::Checkbox( "Snap pointer to points", &snapping ) ) system->pointerTool()->setSnapping( snapping );
+	bool ray_casting = system->pointerTool()->rayCasting();
+	if( ImGui::Checkbox( "Ray cast pointer", &ray_casting ) ) system->pointerTool()->setRayCasting( ray_casting );
+
+	bool late_pose = system->latePoseUpdate();
+	if( ImGui::Checkbox( "Late HMD pose", &late_pose ) ) system->setLatePoseUpdate( late_pose );
+	ImGui::SameLine();
+	bool logging = system->isLoggingLatePoses();
+	if( ImGui::Checkbox( "Log to late_poses.csv", &logging ) ) system->setLatePoseLog( logging ? "late_poses.csv" : "" );
+	for( vr::Hmd_Eye eye : { vr::Eye_Left, vr::Eye_Right } )
+	{
+		const VRSystem::LatePose& late = system->latePose( eye );
+		if( !late.valid ) continue;
+		ImGui::Text( "%s eye: predicted %.1fms ahead, %.2fmm and %.3f degrees from the update pose", eye == vr::Eye_Left ? "Left" : "Right", late.predicted_seconds * 1000.0f, late.position_delta * 1000.0f, late.angle_delta );
+	}
+	ImGui::Text( "Snapped point: %d", system->pointerTool()->snappedPoint() );
+
+	PointCloud* point_cloud = scene.pointCloud();
+	ImGui::Text( "Selected: %u of %u points, %u bytes uploaded", (unsigned int)point_cloud->selection().count(), (unsigned int)point_cloud->selection().size(), (unsigned int)point_cloud->selectionUploadBytes() );
+	if( ImGui::Button( "Clear selection" ) ) point_cloud->clearSelection();
+	ImGui::SameLine();
+	if( ImGui::Button( "Delete selected" ) ) point_cloud->deleteSelection();
+	ImGui::SameLine();
+	if( ImGui::Button( "Crop to selection" ) ) point_cloud->cropToSelection();
+	if( ImGui::Button( "Undo" ) ) point_cloud->undo();
+	ImGui::SameLine();
+	if( ImGui::Button( "Redo" ) ) point_cloud->redo();
+	ImGui::Text( "Last edit: %.2fms, %u bytes uploaded", point_cloud->lastEditTime(), (unsigned int)point_cloud->lastEditUploadBytes() );
+	bool culling = point_cloud->backfaceCulling();
+	if( ImGui::Checkbox( "Backface cull chunks", &culling ) ) point_cloud->setBackfaceCulling( culling );
+	ImGui::SameLine();
+	ImGui::Text( "%.1f%% of points culled", point_cloud->numPoints() ? 100.0f * point_cloud->culledPoints() / point_cloud->numPoints() : 0.0f );
+
+	static char hierarchy_path[256] = "models/hierarchy";
+	ImGui::InputText( "Hierarchy", hierarchy_path, sizeof( hierarchy_path ) );
+	if( ImGui::Button( "Stream hierarchy" ) ) point_cloud->loadHierarchy( hierarchy_path );
+	if( point_cloud->streaming() )
+	{
+		LodStreamer& streamer = point_cloud->streamer();
+		const LodStreamer::Stats& lod = streamer.stats();
+		ImGui::Text( "Drawn: %u nodes, %u points, %u missing", lod.drawn_nodes, (unsigned int)lod.drawn_points, lod.missing_nodes );
+		ImGui::Text( "Resident: %u nodes, %.1f / %.1f MB, %u requested", lod.resident_nodes, lod.resident_bytes / (1024.0f * 1024.0f), streamer.gpuBudget() / (1024.0f * 1024.0f), lod.pending_requests );
+		ImGui::Text( "Uploaded: %u nodes, %.1f KB, %u in flight, %u loads, %u evictions, %u over budget", lod.uploads, lod.upload_bytes / 1024.0f, lod.uploading, (unsigned int)lod.total_loads, (unsigned int)lod.total_evictions, (unsigned int)lod.over_budget );
+
+		int budget_mb = (int)(streamer.gpuBudget() / (1024 * 1024));
+		if( ImGui::SliderInt( "GPU budget (MB)", &budget_mb, 64, 4096 ) ) streamer.setGpuBudget( (size_t)budget_mb * 1024 * 1024 );
+		int point_budget = (int)(streamer.pointBudget() / 1000000);
+		if( ImGui::SliderInt( "Point budget (M)", &point_budget, 1, 50 ) ) streamer.setPointBudget( (size_t)point_budget * 1000000 );
+		float min_pixels = streamer.minNodePixels();
+		if( ImGui::SliderFloat( "Min node pixels", &min_pixels, 20.0f, 1000.0f ) ) streamer.setMinNodePixels( min_pixels );
+
+		float prefetch_ms = streamer.prefetchTime() * 1000.0f;
+		if( ImGui::SliderFloat( "Prefetch ahead (ms)", &prefetch_ms, 0.0f, 1000.0f ) ) streamer.setPrefetchTime( prefetch_ms / 1000.0f );
+		uint64_t resolved = lod.prefetch_hits + lod.prefetch_wasted;
+		ImGui::Text( "Prefetch: %u requested, %u loaded, %.1f%% hit rate", lod.prefetch_requests, (unsigned int)lod.prefetch_loads, resolved ? 100.0f * lod.prefetch_hits / resolved : 0.0f );
+		ImGui::Text( "Frames missing visible nodes: %u of %u", (unsigned int)lod.frames_missing, (unsigned int)lod.frames );
+	}
+
+	bool gpu_picking = id_picker.enabled();
+	if( ImGui::Checkbox( "GPU picking", &gpu_picking ) ) id_picker.setEnabled( gpu_picking );
+
+	ProximityService* proximity = system->pointerTool()->proximityService();
+	if( proximity )
+	{
+		ImGui::Text( "Proximity: %.3fm, %u queries/s, %u pulses%s", proximity->lastDistance(), proximity->queriesPerSecond(), proximity->pulsesQueued(), proximity->isRecording() ? ", recording" : "" );
+	}
+	if( gpu_picking )
+	{
+		const IdPicker::Result& pick = id_picker.result();
+		ImGui::Text( "Picked point: %d, %u frames late, %d in flight, %u dropped", pick.index, pick.latency, id_picker.inFlight(), id_picker.droppedPicks() );
+	}
+
+	static char export_path[256] = "models/export.ply";
+	static bool export_ascii = false;
+	ImGui::InputText( "Export path", export_path, sizeof( export_path ) );
+	ImGui::Checkbox( "ASCII", &export_ascii );
+	PlyWriter::Format export_format = export_ascii ? PlyWriter::Format::ASCII : PlyWriter::Format::Binary;
+	if( ImGui::Button( "Export all" ) ) point_cloud->exportFile( export_path, export_format );
+	ImGui::SameLine();
+	if( ImGui::Button( "Export selected" ) ) point_cloud->exportFile( export_path, export_format, true );
+	const PlyWriter& writer = point_cloud->plyWriter();
+	if( writer.isBusy() )
+	{
+		ImGui::Text( "Exporting: %u / %u points", (unsigned int)writer.pointsWritten(), (unsigned int)writer.pointsToWrite() );
+	}
+	else if( writer.pointsToWrite() > 0 )
+	{
+		ImGui::Text( "Last export: %s, %u points in %.1fms", writer.lastSucceeded() ? "done" : "failed", (unsigned int)writer.pointsWritten(), writer.lastWriteTime() );
+	}
+	bool sorting = render_queue.sorting();
+	if( ImGui::Checkbox( "Sort render queue", &sorting ) ) render_queue.setSorting( sorting );
+
+	GLState::SectionStats gl_totals = GLState::lastFrameTotals();
+	StreamBuffer* stream_buffer = StreamBuffer::get();
+	ImGui::Text( "Stream buffer: %.1f / %.1f KB", stream_buffer->lastFrameBytes() / 1024.0f, stream_buffer->regionSize() / 1024.0f );
+	BufferUploader* uploader = BufferUploader::get();
+	ImGui::Text( "Upload thread: %s, %u queued, %.1f MB sent, longest %.1fms", uploader->isThreaded() ? "on" : "off", uploader->queuedUploads(), uploader->uploadedBytes() / (1024.0f * 1024.0f), uploader->longestUploadTime() );
+
+	ImGui::Text( "GL state calls: %u issued, %u skipped", gl_totals.issued, gl_totals.skipped );
+	for( int i = 0; i < GLState::numSections(); i++ )
+	{
+		const GLState::SectionStats& section = GLState::sectionStats( i );
+		ImGui::Text( "    %s: %u issued, %u skipped", section.name, section.issued, section.skipped );
+	}
+	ImGui::Separator();
+
+	// Frame pipelining, times are from the last frame the GPU finished
+	FramePipeline* pipeline = FramePipeline::get();
+	const FramePipeline::FrameTimes& times = pipeline->lastFrameTimes();
+	int frames_ahead = pipeline->framesAhead();
+	if( ImGui::SliderInt( "Frames ahead of GPU", &frames_ahead, 1, FramePipeline::FRAMES_IN_FLIGHT ) ) pipeline->setFramesAhead( frames_ahead );
+	ImGui::Text( "Frame %u: CPU %.2fms, GPU %.2fms, %.2fms overlapped with the next frame", (unsigned int)times.frame, times.cpu_ms, times.gpu_ms, times.overlap_ms );
+	ImGui::Text( "Waited %.2fms on fences, %u waits in total, GPU finished %.2fms after submit", times.fence_wait_ms, pipeline->fenceWaits(), times.latency_ms );
+	for( int i = 0; i < times.num_sections; i++ )
+	{
+		const FramePipeline::SectionTimes& section = times.sections[i];
+		if( pipeline->isTimed() ) ImGui::Text( "    %s: CPU %.2fms, GPU %.2fms", section.name, section.cpu_ms, section.gpu_ms );
+		else ImGui::Text( "    %s: CPU %.2fms", section.name, section.cpu_ms );
+	}
+	ImGui::Separator();
 	
+	ImGui::Text( "Render models: %u ready, %u loading", system->renderModels()->numReady(), system->renderModels()->numLoading() );
+
 	Controller* controller = VRSystem::get()->leftControler();
 	if( controller )
 	{
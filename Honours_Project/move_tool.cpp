@@ -42,4 +42,19 @@ void MoveTool::update( float dt )
 		translation_ += controller_->velocity() * dt;
 		rotation_ += controller_->angularVelocity() * dt;
 	}
+}
+
+glm::mat4 MoveTool::predictedOffsetMatrix( float seconds ) const
+{
+	Controller* trigger_controller = vr_system_ ? vr_system_->leftControler() : nullptr;
+	if( !controller_ || !trigger_controller || !trigger_controller->isButtonDown( vr::k_EButton_SteamVR_Trigger ) )
+	{
+		return translationMatrix() * rotationMatrix();
+	}
+
+	// Same integration as update(), carried on for the whole time
+	glm::vec3 translation = translation_ + controller_->velocity() * seconds;
+	glm::vec3 rotation = rotation_ + controller_->angularVelocity() * seconds;
+	glm::mat4 rotation_matrix = rotation == glm::vec3( 0 ) ? glm::mat4() : glm::rotate( glm::mat4(), glm::length( rotation ), rotation );
+	return glm::translate( glm::mat4(), translation ) * rotation_matrix;
 }
\ No newline at end of file
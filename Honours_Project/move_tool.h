@@ -16,13 +16,15 @@ public:
 	void activate() override;
 	void deactivate() override;
 	void update( float dt ) override;
-	void render( const glm::mat4& view, const glm::mat4& projection ) override {}
+	void submit( RenderQueue& queue ) override {}
 
 	// Getters
 	glm::mat4 translationMatrix() const { return glm::translate( glm::mat4(), translation_ ); }
 	glm::mat4 rotationMatrix() const { return rotation_ == glm::vec3(0) ? glm::mat4() : glm::rotate( glm::mat4(), glm::length( rotation_ ), rotation_ ); }
 	glm::vec3 translation() const { return translation_; }
 	glm::vec3 rotation() const { return rotation_; }
+	// The translation and rotation 'seconds' from now if the controller keeps moving the point cloud as it is
+	glm::mat4 predictedOffsetMatrix( float seconds ) const;
 
 	// Setters
 	void resetTransform() { translation_ = glm::vec3(); rotation_ = glm::vec3(); }
@@ -0,0 +1,236 @@
+#include "normals.h"
+#include "kd_tree.h"
+#include "parallel.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+	const uint32_t CACHE_MAGIC = 0x314D524E; // "NRM1"
+
+	// Eigenvector of the smallest eigenvalue of a symmetric 3x3 matrix, by Jacobi rotations
+	glm::vec3 smallest_eigenvector( double a[3][3] )
+	{
+		double v[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+
+		for( int sweep = 0; sweep < 16; sweep++ )
+		{
+			double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+			if( off < 1e-30 ) break;
+
+			for( int p = 0; p < 2; p++ )
+			{
+				for( int q = p + 1; q < 3; q++ )
+				{
+					if( std::abs( a[p][q] ) < 1e-30 ) continue;
+
+					// Rotate in the pq plane to zero a[p][q]
+					double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs( theta ) + std::sqrt( theta * theta + 1.0 ));
+					double c = 1.0 / std::sqrt( t * t + 1.0 );
+					double s = t * c;
+
+					for( int r = 0; r < 3; r++ )
+					{
+						double arp = a[r][p];
+						double arq = a[r][q];
+						a[r][p] = c * arp - s * arq;
+						a[r][q] = s * arp + c * arq;
+					}
+					for( int r = 0; r < 3; r++ )
+					{
+						double apr = a[p][r];
+						double aqr = a[q][r];
+						a[p][r] = c * apr - s * aqr;
+						a[q][r] = s * apr + c * aqr;
+					}
+					for( int r = 0; r < 3; r++ )
+					{
+						double vrp = v[r][p];
+						double vrq = v[r][q];
+						v[r][p] = c * vrp - s * vrq;
+						v[r][q] = s * vrp + c * vrq;
+					}
+				}
+			}
+		}
+
+		int smallest = 0;
+		if( a[1][1] < a[smallest][smallest] ) smallest = 1;
+		if( a[2][2] < a[smallest][smallest] ) smallest = 2;
+		return glm::vec3( (float)v[0][smallest], (float)v[1][smallest], (float)v[2][smallest] );
+	}
+
+	// Cheap fingerprint of the positions, so a cache made from different points is never used
+	uint64_t hash_positions( const std::vector<GLfloat>& data, size_t stride )
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const uint32_t* words = (const uint32_t*)data.data();
+		for( size_t i = 0; i + 2 < data.size(); i += stride )
+		{
+			for( size_t j = 0; j < 3; j++ )
+			{
+				hash = (hash ^ words[i + j]) * 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	int16_t to_snorm16( float value )
+	{
+		return (int16_t)std::round( glm::clamp( value, -1.0f, 1.0f ) * 32767.0f );
+	}
+}
+
+uint32_t encode_normal( const glm::vec3& normal )
+{
+	// Project onto the octahedron, then fold the lower half out over the corners
+	float length = std::abs( normal.x ) + std::abs( normal.y ) + std::abs( normal.z );
+	if( length <= 0.0f ) return 0;
+	glm::vec3 n = normal / length;
+
+	glm::vec2 e( n.x, n.y );
+	if( n.z < 0.0f )
+	{
+		e.x = (1.0f - std::abs( n.y )) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - std::abs( n.x )) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return (uint32_t)(uint16_t)to_snorm16( e.x ) | ((uint32_t)(uint16_t)to_snorm16( e.y ) << 16);
+}
+
+glm::vec3 decode_normal( uint32_t encoded )
+{
+	glm::vec2 e( (int16_t)(encoded & 0xFFFF) / 32767.0f, (int16_t)(encoded >> 16) / 32767.0f );
+
+	glm::vec3 n( e.x, e.y, 1.0f - std::abs( e.x ) - std::abs( e.y ) );
+	float t = std::max( -n.z, 0.0f );
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize( n );
+}
+
+void estimate_normals( const KdTree& tree, const std::vector<GLfloat>& data, size_t stride, size_t k, std::vector<uint32_t>& normals )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t count = data.size() / stride;
+	normals.assign( count, 0 );
+	if( count == 0 ) return;
+
+	double centroid[3] = { 0.0, 0.0, 0.0 };
+	for( size_t i = 0; i < count; i++ )
+	{
+		for( int j = 0; j < 3; j++ ) centroid[j] += data[i * stride + j];
+	}
+	glm::vec3 middle( (float)(centroid[0] / count), (float)(centroid[1] / count), (float)(centroid[2] / count) );
+
+	std::cout << "Estimating normals for " << count << " points" << std::endl;
+
+	// Whichever thread finishes a block that crosses the next tenth reports it
+	std::atomic<size_t> done( 0 );
+	std::atomic<int> reported( 0 );
+
+	parallel_for( count, [&]( size_t first, size_t last ) {
+		std::vector<int> neighbours;
+		neighbours.reserve( k );
+
+		for( size_t block = first; block < last; block += 4096 )
+		{
+			size_t block_end = std::min( last, block + 4096 );
+			for( size_t i = block; i < block_end; i++ )
+			{
+				glm::vec3 p( data[i * stride + 0], data[i * stride + 1], data[i * stride + 2] );
+				tree.nearest( p, k, neighbours );
+				if( neighbours.size() < 3 ) continue;
+
+				// Covariance of the neighbourhood, the normal is the direction it varies least in
+				double mean[3] = { 0.0, 0.0, 0.0 };
+				for( int n : neighbours )
+				{
+					for( int j = 0; j < 3; j++ ) mean[j] += data[n * stride + j];
+				}
+				for( int j = 0; j < 3; j++ ) mean[j] /= (double)neighbours.size();
+
+				double covariance[3][3] = { { 0 } };
+				for( int n : neighbours )
+				{
+					double d[3];
+					for( int j = 0; j < 3; j++ ) d[j] = data[n * stride + j] - mean[j];
+					for( int r = 0; r < 3; r++ )
+					{
+						for( int c = 0; c < 3; c++ ) covariance[r][c] += d[r] * d[c];
+					}
+				}
+
+				glm::vec3 normal = smallest_eigenvector( covariance );
+				if( glm::dot( normal, p - middle ) < 0.0f ) normal = -normal;
+				normals[i] = encode_normal( normal );
+			}
+
+			size_t total = done += block_end - block;
+			int tenth = (int)(total * 10 / count);
+			int previous = reported.load();
+			while( tenth > previous && !reported.compare_exchange_weak( previous, tenth ) ) {}
+			if( tenth > previous ) std::cout << "\t" << tenth * 10 << "%" << std::endl;
+		}
+	}, 10000 );
+
+	double ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	std::cout << "Estimated normals in " << ms << "ms" << std::endl;
+}
+
+bool load_normal_cache( const std::string& filepath, const std::vector<GLfloat>& data, size_t stride, std::vector<uint32_t>& normals )
+{
+	std::ifstream file( filepath, std::ios::binary );
+	if( !file.good() ) return false;
+
+	uint32_t magic = 0;
+	uint64_t count = 0;
+	uint64_t hash = 0;
+	file.read( (char*)&magic, sizeof( magic ) );
+	file.read( (char*)&count, sizeof( count ) );
+	file.read( (char*)&hash, sizeof( hash ) );
+
+	if( !file.good() || magic != CACHE_MAGIC || count != data.size() / stride || hash != hash_positions( data, stride ) )
+	{
+		std::cout << "Normal cache '" << filepath << "' is out of date" << std::endl;
+		return false;
+	}
+
+	normals.resize( (size_t)count );
+	file.read( (char*)normals.data(), sizeof( uint32_t ) * normals.size() );
+	if( !file.good() )
+	{
+		std::cout << "ERROR: normal cache '" << filepath << "' is truncated" << std::endl;
+		normals.clear();
+		return false;
+	}
+
+	std::cout << "Read " << count << " normals from '" << filepath << "'" << std::endl;
+	return true;
+}
+
+bool save_normal_cache( const std::string& filepath, const std::vector<GLfloat>& data, size_t stride, const std::vector<uint32_t>& normals )
+{
+	std::ofstream file( filepath, std::ios::binary | std::ios::trunc );
+	if( !file.good() )
+	{
+		std::cout << "ERROR: could not open '" << filepath << "' for writing" << std::endl;
+		return false;
+	}
+
+	uint32_t magic = CACHE_MAGIC;
+	uint64_t count = normals.size();
+	uint64_t hash = hash_positions( data, stride );
+	file.write( (const char*)&magic, sizeof( magic ) );
+	file.write( (const char*)&count, sizeof( count ) );
+	file.write( (const char*)&hash, sizeof( hash ) );
+	file.write( (const char*)normals.data(), sizeof( uint32_t ) * normals.size() );
+
+	return file.good();
+}
\ No newline at end of file
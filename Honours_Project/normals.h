@@ -0,0 +1,24 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class KdTree;
+
+// Point normals are stored octahedral encoded, two signed 16 bit values packed into 32 bits.
+// On the GPU they are read as a normalised GL_SHORT pair and decoded in the vertex shader.
+
+uint32_t encode_normal( const glm::vec3& normal );
+glm::vec3 decode_normal( uint32_t encoded );
+
+// Estimates a normal for every point from the plane through its k nearest neighbours, on every core.
+// 'data' is XYZ followed by stride - 3 other floats per point, the same data the tree was built from.
+// Normals are flipped to face away from the middle of the cloud, which suits scans of a single object
+void estimate_normals( const KdTree& tree, const std::vector<GLfloat>& data, size_t stride, size_t k, std::vector<uint32_t>& normals );
+
+// The cache sits next to the point file and is only used if the points still match the ones it was made from
+bool load_normal_cache( const std::string& filepath, const std::vector<GLfloat>& data, size_t stride, std::vector<uint32_t>& normals );
+bool save_normal_cache( const std::string& filepath, const std::vector<GLfloat>& data, size_t stride, const std::vector<uint32_t>& normals );
\ No newline at end of file
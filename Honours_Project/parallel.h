@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Runs 'func( first, last )' over [0, count) split evenly between one thread per core.
+// Small jobs aren't worth starting threads for, anything under 'serial_below' runs on the calling thread.
+template<typename F>
+void parallel_for( size_t count, F func, size_t serial_below = 100000 )
+{
+	unsigned int threads = std::max( 1u, std::thread::hardware_concurrency() );
+	if( count < serial_below || threads == 1 )
+	{
+		func( (size_t)0, count );
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	size_t chunk = (count + threads - 1) / threads;
+	for( unsigned int t = 0; t < threads; t++ )
+	{
+		size_t first = std::min( count, chunk * t );
+		size_t last = std::min( count, first + chunk );
+		if( first < last ) workers.push_back( std::thread( func, first, last ) );
+	}
+	for( auto& worker : workers ) worker.join();
+}
\ No newline at end of file
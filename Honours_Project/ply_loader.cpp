@@ -15,7 +15,7 @@ PlyLoader::~PlyLoader()
 
 }
 
-void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
+void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data, std::vector<GLfloat>* normals )
 {
 	// TODO: find out if we can just leave the file as always binary?
 	//	- doesn't seem to be causing problems when loading text files.
@@ -118,7 +118,10 @@ void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
 				unsigned char size = (type == "float" ? 4 : 1);
 
 				PropertyIdent ident;
-				switch( name[0] )
+				if( name == "nx" ) ident = PropertyIdent::nx;
+				else if( name == "ny" ) ident = PropertyIdent::ny;
+				else if( name == "nz" ) ident = PropertyIdent::nz;
+				else switch( name[0] )
 				{
 				case 'x': ident = PropertyIdent::x; break;
 				case 'y': ident = PropertyIdent::y; break;
@@ -166,15 +169,29 @@ void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
 		}
 	}*/
 
+	// Only keep normals if all three are there
+	int num_normal_properties = 0;
+	for( auto& vd : vertex_desc )
+	{
+		if( vd.type == PropertyIdent::nx || vd.type == PropertyIdent::ny || vd.type == PropertyIdent::nz ) num_normal_properties++;
+	}
+	bool has_normals = normals && num_normal_properties == 3;
+
 	// Prepare the data vector
 	data.clear();
 	data.reserve( num_verts * 6 );
+	if( normals )
+	{
+		normals->clear();
+		if( has_normals ) normals->reserve( num_verts * 3 );
+	}
 
 	// Now we can actually read the data from the file
 	for( size_t i = 0; i < num_verts && file.good(); i++ )
 	{
 		GLfloat x = 0, y = 0, z = 0;
 		GLfloat r = 1, g = 1, b = 1;
+		GLfloat nx = 0, ny = 0, nz = 0;
 		std::string discard;
 
 		for( auto& vd : vertex_desc )
@@ -194,6 +211,7 @@ void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
 					case PropertyIdent::r: r = byte / 255.0f; break;
 					case PropertyIdent::g: g = byte / 255.0f; break;
 					case PropertyIdent::b: b = byte / 255.0f; break;
+					case PropertyIdent::nx: case PropertyIdent::ny: case PropertyIdent::nz: break;
 					case PropertyIdent::discard: break;
 					}
 				}
@@ -217,6 +235,9 @@ void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
 					case PropertyIdent::r: r = *(float*)byte_array; break;
 					case PropertyIdent::g: g = *(float*)byte_array; break;
 					case PropertyIdent::b: b = *(float*)byte_array; break;
+					case PropertyIdent::nx: nx = *(float*)byte_array; break;
+					case PropertyIdent::ny: ny = *(float*)byte_array; break;
+					case PropertyIdent::nz: nz = *(float*)byte_array; break;
 					case PropertyIdent::discard: break;
 					}
 				}
@@ -239,6 +260,9 @@ void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
 				case PropertyIdent::r: file >> r; break;
 				case PropertyIdent::g: file >> g; break;
 				case PropertyIdent::b: file >> b; break;
+				case PropertyIdent::nx: file >> nx; break;
+				case PropertyIdent::ny: file >> ny; break;
+				case PropertyIdent::nz: file >> nz; break;
 				case PropertyIdent::discard: file >> discard; break;
 				}
 			}
@@ -250,6 +274,13 @@ void PlyLoader::load( std::string filepath, std::vector<GLfloat>& data )
 		data.push_back( r );
 		data.push_back( g );
 		data.push_back( b );
+
+		if( has_normals )
+		{
+			normals->push_back( nx );
+			normals->push_back( ny );
+			normals->push_back( nz );
+		}
 	}
 
 	// Check we actually read the correct number of verts
@@ -273,6 +304,9 @@ std::string PlyLoader::toString( PropertyIdent p )
 	case PropertyIdent::r: return "r";
 	case PropertyIdent::g: return "g";
 	case PropertyIdent::b: return "b";
+	case PropertyIdent::nx: return "nx";
+	case PropertyIdent::ny: return "ny";
+	case PropertyIdent::nz: return "nz";
 	case PropertyIdent::discard: return "discard";
 	}
 }
\ No newline at end of file
@@ -10,10 +10,11 @@ public:
 	PlyLoader();
 	~PlyLoader();
 
-	void load( std::string filepath, std::vector<GLfloat>& data );
+	// Fills 'data' with XYZRGB per vertex. If 'normals' is given it gets XYZ per vertex when the file has normals, otherwise it is left empty
+	void load( std::string filepath, std::vector<GLfloat>& data, std::vector<GLfloat>* normals = nullptr );
 
 	enum class Format { None, ASCII, Binary };
-	enum class PropertyIdent { discard, x, y, z, r, g, b };
+	enum class PropertyIdent { discard, x, y, z, r, g, b, nx, ny, nz };
 
 	struct VertexProperty {
 		PropertyIdent type;
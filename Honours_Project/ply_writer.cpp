@@ -0,0 +1,193 @@
+#include "ply_writer.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <SDL.h>
+
+namespace
+{
+	// Points gathered or formatted before each write to the file
+	const size_t BLOCK_POINTS = 1 << 16;
+	const size_t STRIDE = 6;
+
+	// Enough significant digits to get back the exact float
+	const char* ASCII_FORMAT = "%.9g %.9g %.9g %.9g %.9g %.9g\n";
+	const size_t ASCII_MAX_LINE = 6 * 16 + 1;
+}
+
+PlyWriter::PlyWriter()
+{
+
+}
+
+PlyWriter::~PlyWriter()
+{
+	wait();
+}
+
+bool PlyWriter::write( std::string filepath, const std::vector<GLfloat>& data, Format format, const Selection* subset )
+{
+	if( busy_ )
+	{
+		std::cout << "ERROR: already writing a file, can't write '" << filepath << "'" << std::endl;
+		return false;
+	}
+
+	busy_ = true;
+	succeeded_ = write_file( filepath, data, format, subset );
+	busy_ = false;
+	return succeeded_;
+}
+
+bool PlyWriter::writeAsync( std::string filepath, const std::vector<GLfloat>& data, Format format, const Selection* subset )
+{
+	if( busy_ )
+	{
+		std::cout << "ERROR: already writing a file, can't write '" << filepath << "'" << std::endl;
+		return false;
+	}
+
+	// Collect the last thread, it has already finished
+	if( thread_.joinable() ) thread_.join();
+
+	if( subset ) subset_ = *subset;
+	bool has_subset = subset != nullptr;
+
+	busy_ = true;
+	thread_ = std::thread( [this, filepath, &data, format, has_subset]() {
+		succeeded_ = write_file( filepath, data, format, has_subset ? &subset_ : nullptr );
+		busy_ = false;
+	} );
+
+	return true;
+}
+
+bool PlyWriter::wait()
+{
+	if( thread_.joinable() ) thread_.join();
+	return succeeded_;
+}
+
+bool PlyWriter::write_file( const std::string& filepath, const std::vector<GLfloat>& data, Format format, const Selection* subset )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t num_points = data.size() / STRIDE;
+	if( subset && subset->size() != num_points )
+	{
+		std::cout << "ERROR: selection is for " << subset->size() << " points but there are " << num_points << std::endl;
+		return false;
+	}
+
+	points_written_ = 0;
+	points_to_write_ = subset ? subset->count() : num_points;
+
+	// Binary mode for both formats, so lines always end with '\n' like the loader expects
+	std::ofstream file( filepath, std::ios::binary | std::ios::trunc );
+	if( !file.good() )
+	{
+		std::cout << "ERROR: could not open '" << filepath << "' for writing" << std::endl;
+		return false;
+	}
+
+	// The binary data is written straight from memory, so declare the machine's byte order
+	const char* format_name = "ascii";
+	if( format == Format::Binary )
+	{
+		format_name = (SDL_BYTEORDER == SDL_BIG_ENDIAN) ? "binary_big_endian" : "binary_little_endian";
+	}
+
+	file << "ply\n"
+		<< "format " << format_name << " 1.0\n"
+		<< "element vertex " << points_to_write_ << "\n"
+		<< "property float x\n"
+		<< "property float y\n"
+		<< "property float z\n"
+		<< "property float red\n"
+		<< "property float green\n"
+		<< "property float blue\n"
+		<< "end_header\n";
+
+	std::vector<char> block;
+	if( format == Format::Binary )
+	{
+		if( !subset )
+		{
+			// Already laid out exactly as the file wants it, write it in large blocks so progress still updates
+			for( size_t first = 0; first < num_points && file.good(); first += BLOCK_POINTS * 16 )
+			{
+				size_t count = std::min( num_points - first, BLOCK_POINTS * 16 );
+				file.write( (const char*)&data[first * STRIDE], sizeof( GLfloat ) * STRIDE * count );
+				points_written_ += count;
+			}
+		}
+		else
+		{
+			// Gather the selected points into a block, skipping 64 at a time where nothing is selected
+			block.resize( sizeof( GLfloat ) * STRIDE * BLOCK_POINTS );
+			size_t in_block = 0;
+			const std::vector<uint64_t>& words = subset->words();
+
+			for( size_t w = 0; w < words.size() && file.good(); w++ )
+			{
+				uint64_t word = words[w];
+				while( word )
+				{
+					size_t bit = 0;
+					while( ((word >> bit) & 1) == 0 ) bit++;
+					word &= word - 1;
+
+					size_t index = (w << 6) + bit;
+					std::memcpy( &block[sizeof( GLfloat ) * STRIDE * in_block], &data[index * STRIDE], sizeof( GLfloat ) * STRIDE );
+
+					if( ++in_block == BLOCK_POINTS )
+					{
+						file.write( block.data(), sizeof( GLfloat ) * STRIDE * in_block );
+						points_written_ += in_block;
+						in_block = 0;
+					}
+				}
+			}
+			file.write( block.data(), sizeof( GLfloat ) * STRIDE * in_block );
+			points_written_ += in_block;
+		}
+	}
+	else
+	{
+		block.resize( ASCII_MAX_LINE * BLOCK_POINTS );
+		size_t used = 0;
+		size_t in_block = 0;
+
+		for( size_t i = 0; i < num_points && file.good(); i++ )
+		{
+			if( subset && !subset->test( i ) ) continue;
+
+			const GLfloat* p = &data[i * STRIDE];
+			used += std::snprintf( &block[used], ASCII_MAX_LINE, ASCII_FORMAT, p[0], p[1], p[2], p[3], p[4], p[5] );
+
+			if( ++in_block == BLOCK_POINTS )
+			{
+				file.write( block.data(), used );
+				points_written_ += in_block;
+				used = 0;
+				in_block = 0;
+			}
+		}
+		file.write( block.data(), used );
+		points_written_ += in_block;
+	}
+
+	file.flush();
+	if( !file.good() )
+	{
+		std::cout << "ERROR: failed writing '" << filepath << "'" << std::endl;
+		return false;
+	}
+
+	write_ms_ = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	std::cout << "Wrote " << points_written_ << " points to '" << filepath << "' in " << write_ms_ << "ms" << std::endl;
+	return true;
+}
\ No newline at end of file
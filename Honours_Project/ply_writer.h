@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <GL/glew.h>
+#include "selection.h"
+
+// Writes XYZRGB point data as a .ply file that PlyLoader reads back exactly. Every property is
+// written as a float, binary files hold the values bit for bit and ASCII files use enough digits
+// that each one parses back to the same float.
+
+class PlyWriter
+{
+public:
+	PlyWriter();
+	~PlyWriter();
+
+	enum class Format { ASCII, Binary };
+
+	// Only the points set in 'subset' are written if one is given. Returns false if the file could not be written
+	bool write( std::string filepath, const std::vector<GLfloat>& data, Format format, const Selection* subset = nullptr );
+
+	// Same as write() but on a background thread, returns false if a write is already in progress.
+	// The subset is copied, but the data is read in place and must not change until isBusy() is false
+	bool writeAsync( std::string filepath, const std::vector<GLfloat>& data, Format format, const Selection* subset = nullptr );
+	// Blocks until the background write has finished, returns whether it succeeded
+	bool wait();
+
+	// Getters
+	bool isBusy() const { return busy_; }
+	bool lastSucceeded() const { return succeeded_; }
+	size_t pointsWritten() const { return points_written_; }
+	size_t pointsToWrite() const { return points_to_write_; }
+	double lastWriteTime() const { return write_ms_; }
+
+protected:
+	bool write_file( const std::string& filepath, const std::vector<GLfloat>& data, Format format, const Selection* subset );
+
+	std::thread thread_;
+	Selection subset_;
+	std::atomic<bool> busy_{ false };
+	std::atomic<bool> succeeded_{ false };
+	std::atomic<size_t> points_written_{ 0 };
+	std::atomic<size_t> points_to_write_{ 0 };
+	std::atomic<double> write_ms_{ 0.0 };
+};
\ No newline at end of file
@@ -5,8 +5,15 @@
 #include <gtc/matrix_transform.hpp>
 #include <gtx/quaternion.hpp>
 #include <gtx/matrix_decompose.hpp>
+#include <chrono>
+#include <cstring>
 #include "vr_system.h"
 #include "move_tool.h"
+#include "gl_state.h"
+#include "debug_draw.h"
+#include "parallel.h"
+#include "normals.h"
+#include "chunk_bounds.h"
 
 PointCloud::PointCloud() :
 	active_shader_(nullptr),
@@ -14,7 +21,6 @@ PointCloud::PointCloud() :
 	vao_(0),
 	vbo_(0),
 	num_verts_(0),
-	aabb_vao_(0),
 	model_mat_(),
 	offset_mat_()
 {
@@ -28,61 +34,169 @@ PointCloud::~PointCloud()
 bool PointCloud::init()
 {
 	modl_matrix_location_ = active_shader_->getUniformLocation( "model" );
-	view_matrix_location_ = active_shader_->getUniformLocation( "view" );
-	proj_matrix_location_ = active_shader_->getUniformLocation( "projection" );
+	located_shader_ = active_shader_;
 
 	glGenVertexArrays( 1, &vao_ );
 	glGenBuffers( 1, &vbo_ );
-	glBindVertexArray( vao_ );
-	glBindBuffer( GL_ARRAY_BUFFER, vbo_ );
+	glGenBuffers( 1, &normal_vbo_ );
+	bind_attributes();
 
-	GLuint stride = 2 * 3 * sizeof( GLfloat );
-	GLuint offset = 0;
+	// Selection flags live in their own buffer so they can be updated without touching the points
+	GLState::bindVertexArray( vao_ );
+	glGenBuffers( 1, &flag_vbo_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, flag_vbo_ );
+	glEnableVertexAttribArray( 2 );
+	glVertexAttribPointer( 2, 1, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( GLubyte ), (const void *)0 );
 
-	glEnableVertexAttribArray( 0 );
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
+	GLState::bindVertexArray( 0 );
 
-	offset += sizeof( GLfloat ) * 3;
-	glEnableVertexAttribArray( 1 );
-	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
-
-	glBindVertexArray( 0 );
+	flag_chunk_.resize( Selection::CHUNK_SIZE );
 	
 	return true;
 }
 
 void PointCloud::shutdown()
 {
+	// The export reads data_ in place
+	ply_writer_.wait();
+	streamer_.close();
+	swap_in_buffers( true );
+
 	if( vao_ ) {
-		glDeleteVertexArrays( 1, &vao_ );
+		GLState::deleteVertexArrays( 1, &vao_ );
 		vao_ = 0;
 	}
 	if( vbo_ ) {
-		glDeleteBuffers( 1, &vbo_ );
+		GLState::deleteBuffers( 1, &vbo_ );
 		vbo_ = 0;
 	}
+	if( flag_vbo_ ) {
+		GLState::deleteBuffers( 1, &flag_vbo_ );
+		flag_vbo_ = 0;
+	}
+	if( normal_vbo_ ) {
+		GLState::deleteBuffers( 1, &normal_vbo_ );
+		normal_vbo_ = 0;
+	}
 }
 
 void PointCloud::update( float dt )
 {
+	if( move_tool_ )
+	{
+		glm::mat4 offset = move_tool_->translationMatrix() * move_tool_->rotationMatrix();
+		if( offset != offset_mat_ )
+		{
+			setOffsetMatrix( offset );
+		}
+	}
+
+	// Finished node blocks are sent before anything is drawn
+	streamer_.update();
+	if( pending_vbo_ ) swap_in_buffers( false );
+
+	selection_upload_bytes_ = 0;
+	if( selection_.isDirty() )
+	{
+		uploadSelection();
+	}
 }
 
-void PointCloud::render( const glm::mat4& view, const glm::mat4& projection )
+void PointCloud::uploadSelection()
 {
-	VRSystem* system = VRSystem::get();
+	GLState::bindBuffer( GL_ARRAY_BUFFER, flag_vbo_ );
 
-	active_shader_->bind();
-	offset_mat_ = move_tool_->translationMatrix() * move_tool_->rotationMatrix();
-	glUniformMatrix4fv( modl_matrix_location_, 1, GL_FALSE, glm::value_ptr( model_mat_ * offset_mat_ ) );
-	glUniformMatrix4fv( view_matrix_location_, 1, GL_FALSE, glm::value_ptr( view ) );
-	glUniformMatrix4fv( proj_matrix_location_, 1, GL_FALSE, glm::value_ptr( projection ) );
+	for( size_t chunk = 0; chunk < selection_.numChunks(); chunk++ )
+	{
+		if( !selection_.isChunkDirty( chunk ) ) continue;
 
-	glBindVertexArray( vao_ );
-	glDrawArrays( GL_POINTS, 0, num_verts_ );
+		size_t count = selection_.expandChunk( chunk, flag_chunk_.data() );
+		glBufferSubData( GL_ARRAY_BUFFER, chunk * Selection::CHUNK_SIZE, count, flag_chunk_.data() );
+		selection_upload_bytes_ += count;
+	}
 
-	// Draw the aabb vao;
-	glBindVertexArray( aabb_vao_ );
-	glDrawArrays( GL_LINES, 0, 24 );
+	selection_.clearDirty();
+}
+
+void PointCloud::submit( RenderQueue& queue )
+{
+	// The tools can swap the shader, which may keep the model matrix somewhere else
+	if( active_shader_ != located_shader_ )
+	{
+		modl_matrix_location_ = active_shader_->getUniformLocation( "model" );
+		located_shader_ = active_shader_;
+	}
+
+	DrawItem item;
+	item.program = active_shader_->getProgram();
+	item.vao = vao_;
+	item.primitive = GL_POINTS;
+	item.count = num_verts_;
+	item.model_location = modl_matrix_location_;
+	item.model = world_mat_;
+	item.centre = lower_bound_ + (upper_bound_ - lower_bound_) * 0.5f;
+
+	if( streamer_.isOpen() )
+	{
+		// While the move tool is dragging the point cloud it keeps going the same way too
+		glm::mat4 predicted_offset = move_tool_ ? move_tool_->predictedOffsetMatrix( streamer_.prefetchTime() ) : offset_mat_;
+		streamer_.setPrefetch( prefetch_views_, num_prefetch_views_, model_mat_ * predicted_offset );
+		streamer_.submit( queue, item, world_mat_, views_, num_views_ );
+		DebugDraw::box( lower_bound_, upper_bound_, glm::vec3( 1.0f ), item.model );
+		return;
+	}
+
+	// Still uploading, the points drawn so far would be the wrong ones
+	if( pending_vbo_ )
+	{
+		DebugDraw::box( lower_bound_, upper_bound_, glm::vec3( 1.0f ), item.model );
+		return;
+	}
+
+	// Only draw the chunks that face at least one eye, neighbouring chunks are merged into one range
+	culled_points_ = 0;
+	if( backface_culling_ && num_eyes_ > 0 && !chunk_bounds_.empty() )
+	{
+		glm::vec3 local_eyes[MAX_EYES];
+		for( int e = 0; e < num_eyes_; e++ ) local_eyes[e] = toLocal( eyes_[e] );
+
+		draw_firsts_.clear();
+		draw_counts_.clear();
+		GLsizei drawn = 0;
+		for( size_t c = 0; c < chunk_bounds_.size(); c++ )
+		{
+			GLint first = (GLint)(c * ChunkBounds::CHUNK_POINTS);
+			GLsizei count = (GLsizei)std::min( ChunkBounds::CHUNK_POINTS, (size_t)(num_verts_ - first) );
+
+			bool hidden = true;
+			for( int e = 0; e < num_eyes_ && hidden; e++ ) hidden = chunk_bounds_[c].facesAway( local_eyes[e] );
+			if( hidden )
+			{
+				culled_points_ += count;
+				continue;
+			}
+
+			if( !draw_counts_.empty() && draw_firsts_.back() + draw_counts_.back() == first )
+			{
+				draw_counts_.back() += count;
+			}
+			else
+			{
+				draw_firsts_.push_back( first );
+				draw_counts_.push_back( count );
+			}
+			drawn += count;
+		}
+
+		item.firsts = draw_firsts_.data();
+		item.counts = draw_counts_.data();
+		item.draw_count = (GLsizei)draw_counts_.size();
+		item.count = drawn;
+	}
+	queue.submit( item );
+
+	// Box around the point cloud
+	DebugDraw::box( lower_bound_, upper_bound_, glm::vec3( 1.0f ), item.model );
 }
 
 void PointCloud::calculateAABB()
@@ -102,83 +216,158 @@ void PointCloud::calculateAABB()
 		if( upper_bound_.y > data_[i + 1] ) upper_bound_.y = data_[i + 1];
 		if( upper_bound_.z > data_[i + 2] ) upper_bound_.z = data_[i + 2];
 	}
+}
 
-	GLuint vbo;
+void PointCloud::loadFile( std::string filepath )
+{
+	// An export or the previous upload could still be reading the old points
+	ply_writer_.wait();
+	swap_in_buffers( true );
+	streamer_.close();
 
-	glGenVertexArrays( 1, &aabb_vao_ );
-	glBindVertexArray( aabb_vao_ );
-	glGenBuffers( 1, &vbo );
-	glBindBuffer( GL_ARRAY_BUFFER, vbo );
+	std::unique_lock<std::mutex> index_lock( index_mutex_ );
 
-	GLuint stride = 2 * 3 * sizeof( GLfloat );
-	GLuint offset = 0;
-
-	glEnableVertexAttribArray( 0 );
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
+	// Load the data
+	std::vector<GLfloat> file_normals;
+	ply_loader_.load( filepath, data_, &file_normals );
 
-	offset += sizeof( GLfloat ) * 3;
-	glEnableVertexAttribArray( 1 );
-	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
+	// Sorts the points into tree order, so must happen before they are sent
+	std::vector<unsigned int> reordered;
+	kd_tree_.build( data_, 6, true, &reordered );
 
-	// Construct a box around the point cloud
-	GLfloat verts[] = {
-		// lines traveling on the y axis (vertical)
-		lower_bound_.x, lower_bound_.y, lower_bound_.z, 1, 1, 1,
-		lower_bound_.x, upper_bound_.y, lower_bound_.z, 1, 1, 1,
+	// Normals from the file follow their points into tree order, otherwise they are worked out from the points once and cached
+	std::string cache_path = filepath + ".normals";
+	if( !file_normals.empty() )
+	{
+		normals_.resize( data_.size() / 6 );
+		parallel_for( normals_.size(), [&]( size_t first, size_t last ) {
+			for( size_t i = first; i < last; i++ )
+			{
+				size_t from = reordered.empty() ? i : reordered[i];
+				normals_[i] = encode_normal( glm::vec3( file_normals[from * 3 + 0], file_normals[from * 3 + 1], file_normals[from * 3 + 2] ) );
+			}
+		} );
+	}
+	else if( !load_normal_cache( cache_path, data_, 6, normals_ ) )
+	{
+		estimate_normals( kd_tree_, data_, 6, NORMAL_NEIGHBOURS, normals_ );
+		save_normal_cache( cache_path, data_, 6, normals_ );
+	}
+	index_lock.unlock();
+
+	// Send the verticies from the upload thread, they replace the old buffers once they are finished
+	BufferUploader* uploader = BufferUploader::get();
+	const GLfloat* points = data_.data();
+	size_t point_bytes = sizeof( data_[0] ) * data_.size();
+	pending_vbo_ = uploader->upload( (GLsizeiptr)point_bytes, [points, point_bytes]( void* destination ) {
+		std::memcpy( destination, points, point_bytes );
+	} );
+	const uint32_t* normals = normals_.data();
+	size_t normal_bytes = sizeof( normals_[0] ) * normals_.size();
+	pending_normal_vbo_ = uploader->upload( (GLsizeiptr)normal_bytes, [normals, normal_bytes]( void* destination ) {
+		std::memcpy( destination, normals, normal_bytes );
+	} );
+	num_verts_ = (GLsizei)(data_.size() / 6);
+	vbo_capacity_ = num_verts_;
 
-		upper_bound_.x, lower_bound_.y, lower_bound_.z, 1, 1, 1,
-		upper_bound_.x, upper_bound_.y, lower_bound_.z, 1, 1, 1,
+	compute_chunk_bounds( data_, 6, normals_, 0, chunk_bounds_ );
 
-		lower_bound_.x, lower_bound_.y, upper_bound_.z, 1, 1, 1,
-		lower_bound_.x, upper_bound_.y, upper_bound_.z, 1, 1, 1,
+	// Edits to the previous file can't be undone
+	undo_stack_.clear();
+	redo_stack_.clear();
 
-		upper_bound_.x, lower_bound_.y, upper_bound_.z, 1, 1, 1,
-		upper_bound_.x, upper_bound_.y, upper_bound_.z, 1, 1, 1,
-		
-		// lines traveling on the x axis
-		lower_bound_.x, lower_bound_.y, lower_bound_.z, 1, 1, 1,
-		upper_bound_.x, lower_bound_.y, lower_bound_.z, 1, 1, 1,
+	// Nothing is selected in a new file, every chunk is dirty so the flags get cleared on the next update
+	selection_.resize( num_verts_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, flag_vbo_ );
+	glBufferData( GL_ARRAY_BUFFER, num_verts_, nullptr, GL_DYNAMIC_DRAW );
 
-		lower_bound_.x, upper_bound_.y, lower_bound_.z, 1, 1, 1,
-		upper_bound_.x, upper_bound_.y, lower_bound_.z, 1, 1, 1,
+	calculateAABB();
+	resetPosition();
+}
 
-		lower_bound_.x, lower_bound_.y, upper_bound_.z, 1, 1, 1,
-		upper_bound_.x, lower_bound_.y, upper_bound_.z, 1, 1, 1,
+bool PointCloud::loadHierarchy( std::string directory )
+{
+	ply_writer_.wait();
+	swap_in_buffers( true );
+	if( !streamer_.open( directory ) ) return false;
 
-		lower_bound_.x, upper_bound_.y, upper_bound_.z, 1, 1, 1,
-		upper_bound_.x, upper_bound_.y, upper_bound_.z, 1, 1, 1,
+	// Nothing uses the loaded points while streaming
+	{
+		std::lock_guard<std::mutex> index_lock( index_mutex_ );
+		data_.clear();
+		normals_.clear();
+		kd_tree_.clear();
+	}
+	num_verts_ = 0;
+	vbo_capacity_ = 0;
+	chunk_bounds_.clear();
+	undo_stack_.clear();
+	redo_stack_.clear();
+	selection_.resize( 0 );
+
+	// Points are relative to the root's lower corner, lower_bound_ holds the largest corner like calculateAABB()
+	lower_bound_ = glm::vec3( streamer_.header().size );
+	upper_bound_ = glm::vec3( 0.0f );
+	resetPosition();
+	return true;
+}
 
-		// lines traveling on the z axis
-		lower_bound_.x, lower_bound_.y, lower_bound_.z, 1, 1, 1,
-		lower_bound_.x, lower_bound_.y, upper_bound_.z, 1, 1, 1,
+void PointCloud::swap_in_buffers( bool wait )
+{
+	if( !pending_vbo_ ) return;
 
-		lower_bound_.x, upper_bound_.y, lower_bound_.z, 1, 1, 1,
-		lower_bound_.x, upper_bound_.y, upper_bound_.z, 1, 1, 1,
+	BufferUploader* uploader = BufferUploader::get();
+	if( wait )
+	{
+		uploader->wait( pending_vbo_ );
+		uploader->wait( pending_normal_vbo_ );
+	}
+	else if( !uploader->finished( pending_vbo_ ) || !uploader->finished( pending_normal_vbo_ ) )
+	{
+		return;
+	}
 
-		upper_bound_.x, lower_bound_.y, lower_bound_.z, 1, 1, 1,
-		upper_bound_.x, lower_bound_.y, upper_bound_.z, 1, 1, 1,
+	GLState::deleteBuffers( 1, &vbo_ );
+	GLState::deleteBuffers( 1, &normal_vbo_ );
+	vbo_ = pending_vbo_->buffer;
+	normal_vbo_ = pending_normal_vbo_->buffer;
 
-		upper_bound_.x, upper_bound_.y, lower_bound_.z, 1, 1, 1,
-		upper_bound_.x, upper_bound_.y, upper_bound_.z, 1, 1, 1,
-	};
+	// Very unlikely, but if the contents were lost they can still be sent from here
+	if( pending_vbo_->failed || pending_normal_vbo_->failed )
+	{
+		std::cout << "ERROR: the upload thread lost the point buffers, sending them again" << std::endl;
+		GLState::bindBuffer( GL_ARRAY_BUFFER, vbo_ );
+		glBufferData( GL_ARRAY_BUFFER, sizeof( data_[0] ) * data_.size(), data_.data(), GL_STATIC_DRAW );
+		GLState::bindBuffer( GL_ARRAY_BUFFER, normal_vbo_ );
+		glBufferData( GL_ARRAY_BUFFER, sizeof( normals_[0] ) * normals_.size(), normals_.data(), GL_STATIC_DRAW );
+	}
 
-	glBufferData( GL_ARRAY_BUFFER, sizeof( verts ), verts, GL_STATIC_DRAW );
+	pending_vbo_ = nullptr;
+	pending_normal_vbo_ = nullptr;
+	bind_attributes();
 }
 
-void PointCloud::loadFile( std::string filepath )
+void PointCloud::bind_attributes()
 {
-	glBindVertexArray( vao_ );
-	glBindBuffer( GL_ARRAY_BUFFER, vbo_ );
+	GLState::bindVertexArray( vao_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, vbo_ );
 
-	// Load the data
-	ply_loader_.load( filepath, data_ );
+	GLuint stride = 2 * 3 * sizeof( GLfloat );
+	GLuint offset = 0;
 
-	// Send the verticies
-	glBufferData( GL_ARRAY_BUFFER, sizeof( data_[0] ) * data_.size(), data_.data(), GL_STATIC_DRAW );
-	num_verts_ = (GLsizei)(data_.size() / 6);
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
 
-	calculateAABB();
-	resetPosition();
+	offset += sizeof( GLfloat ) * 3;
+	glEnableVertexAttribArray( 1 );
+	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
+
+	// Octahedral normals, two normalised shorts per point
+	GLState::bindBuffer( GL_ARRAY_BUFFER, normal_vbo_ );
+	glEnableVertexAttribArray( 3 );
+	glVertexAttribPointer( 3, 2, GL_SHORT, GL_TRUE, sizeof( uint32_t ), (const void *)0 );
+
+	GLState::bindVertexArray( 0 );
 }
 
 void PointCloud::resetPosition()
@@ -192,6 +381,32 @@ void PointCloud::resetPosition()
 	model_mat_ = glm::scale( model_mat_, glm::vec3( scale, scale, scale ) );
 	model_mat_ = glm::translate( model_mat_, -center );
 	offset_mat_ = glm::mat4();
+	updateNode();
+}
+
+void PointCloud::updateNode()
+{
+	node_.setLocal( combinedOffsetMatrix() );
+
+	// The points are drawn with this, queries need to go the other way
+	world_mat_ = model_mat_ * offset_mat_;
+	inverse_world_mat_ = glm::inverse( world_mat_ );
+	world_scale_ = glm::length( glm::vec3( world_mat_[0] ) );
+}
+
+int PointCloud::nearestPoint( const glm::vec3& world_position, float max_distance, glm::vec3* world_point ) const
+{
+	if( kd_tree_.empty() || world_scale_ <= 0.0f ) return -1;
+
+	// The model matrix scales uniformly, so distances just need dividing by the scale
+	glm::vec3 local = glm::vec3( inverse_world_mat_ * glm::vec4( world_position, 1.0f ) );
+	int index = kd_tree_.nearest( local, max_distance / world_scale_ );
+
+	if( index >= 0 && world_point )
+	{
+		*world_point = glm::vec3( world_mat_ * glm::vec4( position( index ), 1.0f ) );
+	}
+	return index;
 }
 
 glm::mat4 PointCloud::combinedOffsetMatrix()
@@ -211,4 +426,442 @@ glm::mat4 PointCloud::combinedOffsetMatrix()
 	result *= glm::inverse( glm::toMat4( rotation ) );
 
 	return result;
-} 
\ No newline at end of file
+} 
+
+bool PointCloud::raycast( const glm::vec3& world_origin, const glm::vec3& world_direction, float radius, float max_distance, KdTree::RayHit* hit ) const
+{
+	if( kd_tree_.empty() || world_scale_ <= 0.0f ) return false;
+
+	glm::vec3 origin = glm::vec3( inverse_world_mat_ * glm::vec4( world_origin, 1.0f ) );
+	glm::vec3 direction = glm::normalize( glm::vec3( inverse_world_mat_ * glm::vec4( world_direction, 0.0f ) ) );
+
+	KdTree::RayHit local_hit;
+	if( !kd_tree_.raycast( origin, direction, radius / world_scale_, max_distance / world_scale_, &local_hit ) ) return false;
+
+	if( hit )
+	{
+		hit->index = local_hit.index;
+		hit->distance = local_hit.distance * world_scale_;
+		hit->position = glm::vec3( world_mat_ * glm::vec4( local_hit.position, 1.0f ) );
+	}
+	return true;
+}
+
+void PointCloud::selectSphere( const glm::vec3& world_centre, float radius, bool select )
+{
+	if( kd_tree_.empty() || world_scale_ <= 0.0f ) return;
+
+	glm::vec3 centre = glm::vec3( inverse_world_mat_ * glm::vec4( world_centre, 1.0f ) );
+	float local_radius = radius / world_scale_;
+	float radius2 = local_radius * local_radius;
+
+	kd_tree_.query(
+		[&]( const glm::vec3& lower, const glm::vec3& upper ) {
+			// Nearest and furthest corners of the bounds from the centre
+			glm::vec3 nearest = glm::clamp( centre, lower, upper );
+			glm::vec3 furthest = glm::max( glm::abs( centre - lower ), glm::abs( upper - centre ) );
+			if( glm::dot( nearest - centre, nearest - centre ) > radius2 ) return KdTree::Overlap::Outside;
+			if( glm::dot( furthest, furthest ) <= radius2 ) return KdTree::Overlap::Inside;
+			return KdTree::Overlap::Intersects;
+		},
+		[&]( size_t index, const glm::vec3& point ) {
+			glm::vec3 d = point - centre;
+			if( glm::dot( d, d ) <= radius2 ) selection_.set( index, select );
+		},
+		[&]( size_t first, size_t last ) {
+			selection_.setRange( first, last, select );
+		} );
+}
+
+void PointCloud::selectBox( const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper, bool select )
+{
+	box_query( box_to_world, lower, upper, selection_, select );
+}
+
+void PointCloud::box_query( const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper, Selection& target, bool select ) const
+{
+	if( kd_tree_.empty() ) return;
+
+	// Work in the box's space, where it is axis aligned
+	glm::mat4 to_box = glm::inverse( box_to_world ) * world_mat_;
+
+	kd_tree_.query(
+		[&]( const glm::vec3& range_lower, const glm::vec3& range_upper ) {
+			glm::vec3 corner_lower( 1e30f );
+			glm::vec3 corner_upper( -1e30f );
+			bool all_inside = true;
+			for( int i = 0; i < 8; i++ )
+			{
+				glm::vec3 corner( (i & 1) ? range_upper.x : range_lower.x, (i & 2) ? range_upper.y : range_lower.y, (i & 4) ? range_upper.z : range_lower.z );
+				corner = glm::vec3( to_box * glm::vec4( corner, 1.0f ) );
+				corner_lower = glm::min( corner_lower, corner );
+				corner_upper = glm::max( corner_upper, corner );
+				all_inside = all_inside && glm::all( glm::greaterThanEqual( corner, lower ) ) && glm::all( glm::lessThanEqual( corner, upper ) );
+			}
+
+			// The box is convex, so if every corner is inside then so is the whole range
+			if( all_inside ) return KdTree::Overlap::Inside;
+			if( glm::any( glm::lessThan( corner_upper, lower ) ) || glm::any( glm::greaterThan( corner_lower, upper ) ) ) return KdTree::Overlap::Outside;
+			return KdTree::Overlap::Intersects;
+		},
+		[&]( size_t index, const glm::vec3& point ) {
+			glm::vec3 p = glm::vec3( to_box * glm::vec4( point, 1.0f ) );
+			if( glm::all( glm::greaterThanEqual( p, lower ) ) && glm::all( glm::lessThanEqual( p, upper ) ) ) target.set( index, select );
+		},
+		[&]( size_t first, size_t last ) {
+			target.setRange( first, last, select );
+		} );
+}
+
+void PointCloud::selectLasso( const std::vector<glm::vec2>& polygon, const glm::mat4& view_projection, bool select )
+{
+	if( kd_tree_.empty() || polygon.size() < 3 ) return;
+
+	glm::mat4 mvp = view_projection * world_mat_;
+
+	glm::vec2 polygon_lower = polygon[0];
+	glm::vec2 polygon_upper = polygon[0];
+	for( const glm::vec2& p : polygon )
+	{
+		polygon_lower = glm::min( polygon_lower, p );
+		polygon_upper = glm::max( polygon_upper, p );
+	}
+
+	// Even-odd rule, count how many edges a line going right from the point crosses
+	auto inside_polygon = [&polygon]( const glm::vec2& p ) {
+		bool inside = false;
+		for( size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++ )
+		{
+			const glm::vec2& a = polygon[i];
+			const glm::vec2& b = polygon[j];
+			if( (a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x )
+			{
+				inside = !inside;
+			}
+		}
+		return inside;
+	};
+
+	kd_tree_.query(
+		[&]( const glm::vec3& lower, const glm::vec3& upper ) {
+			// Only ranges that are entirely on screen and away from the lasso's bounds can be skipped
+			glm::vec2 screen_lower( 1e30f );
+			glm::vec2 screen_upper( -1e30f );
+			for( int i = 0; i < 8; i++ )
+			{
+				glm::vec3 corner( (i & 1) ? upper.x : lower.x, (i & 2) ? upper.y : lower.y, (i & 4) ? upper.z : lower.z );
+				glm::vec4 clip = mvp * glm::vec4( corner, 1.0f );
+				if( clip.w <= 0.0f ) return KdTree::Overlap::Intersects;
+
+				glm::vec2 ndc = glm::vec2( clip ) / clip.w;
+				screen_lower = glm::min( screen_lower, ndc );
+				screen_upper = glm::max( screen_upper, ndc );
+			}
+
+			if( glm::any( glm::lessThan( screen_upper, polygon_lower ) ) || glm::any( glm::greaterThan( screen_lower, polygon_upper ) ) ) return KdTree::Overlap::Outside;
+			return KdTree::Overlap::Intersects;
+		},
+		[&]( size_t index, const glm::vec3& point ) {
+			glm::vec4 clip = mvp * glm::vec4( point, 1.0f );
+			if( clip.w > 0.0f && inside_polygon( glm::vec2( clip ) / clip.w ) ) selection_.set( index, select );
+		},
+		[&]( size_t first, size_t last ) {
+			selection_.setRange( first, last, select );
+		} );
+}
+
+void PointCloud::deleteSelection()
+{
+	if( selection_.count() == 0 ) return;
+	ply_writer_.wait();
+	swap_in_buffers( true );
+	std::lock_guard<std::mutex> index_lock( index_mutex_ );
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	EditDelta delta;
+	size_t first_changed = removePoints( selection_, delta );
+	finishEdit( first_changed, delta, true );
+
+	undo_stack_.push_back( std::move( delta ) );
+	redo_stack_.clear();
+
+	edit_ms_ = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	std::cout << "Deleted " << undo_stack_.back().indices.size() << " points in " << edit_ms_ << "ms" << std::endl;
+}
+
+void PointCloud::cropToSelection()
+{
+	if( selection_.count() == 0 || selection_.count() == selection_.size() ) return;
+
+	// Cropping is deleting everything that isn't selected. Inverting dirties every chunk, and reset() keeps
+	// them dirty, so the flags of the points that stay are all cleared on the GPU as well
+	selection_.invert();
+	deleteSelection();
+}
+
+void PointCloud::cropToBox( const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper )
+{
+	selection_.clear();
+	selectBox( box_to_world, lower, upper, true );
+	cropToSelection();
+}
+
+bool PointCloud::undo()
+{
+	if( undo_stack_.empty() ) return false;
+	ply_writer_.wait();
+	swap_in_buffers( true );
+	std::lock_guard<std::mutex> index_lock( index_mutex_ );
+
+	EditDelta delta = std::move( undo_stack_.back() );
+	undo_stack_.pop_back();
+
+	size_t first_changed = restorePoints( delta );
+	finishEdit( first_changed, delta, false );
+
+	redo_stack_.push_back( std::move( delta ) );
+	return true;
+}
+
+bool PointCloud::redo()
+{
+	if( redo_stack_.empty() ) return false;
+	ply_writer_.wait();
+	swap_in_buffers( true );
+	std::lock_guard<std::mutex> index_lock( index_mutex_ );
+
+	EditDelta delta = std::move( redo_stack_.back() );
+	redo_stack_.pop_back();
+
+	// Remove the same points again, they are back where they were before the edit
+	Selection remove;
+	remove.resize( num_verts_ );
+	for( unsigned int index : delta.indices ) remove.set( index, true );
+
+	size_t first_changed = removePoints( remove, delta );
+	finishEdit( first_changed, delta, true );
+
+	undo_stack_.push_back( std::move( delta ) );
+	return true;
+}
+
+size_t PointCloud::removePoints( const Selection& remove, EditDelta& delta )
+{
+	const size_t stride = 6;
+	const size_t count = (size_t)num_verts_;
+
+	// Split the points into blocks, one or more per core
+	unsigned int threads = std::max( 1u, std::thread::hardware_concurrency() );
+	const size_t block_size = std::max( (size_t)65536, (count + threads - 1) / threads );
+	const size_t num_blocks = (count + block_size - 1) / block_size;
+
+	// Count how many points each block loses, then a prefix sum gives where everything goes
+	std::vector<size_t> removed_offset( num_blocks + 1, 0 );
+	parallel_for( num_blocks, [&]( size_t first, size_t last ) {
+		for( size_t b = first; b < last; b++ )
+		{
+			size_t removed = 0;
+			for( size_t i = b * block_size; i < std::min( count, (b + 1) * block_size ); i++ )
+			{
+				if( remove.test( i ) ) removed++;
+			}
+			removed_offset[b + 1] = removed;
+		}
+	}, 2 );
+	for( size_t b = 0; b < num_blocks; b++ ) removed_offset[b + 1] += removed_offset[b];
+
+	const size_t total_removed = removed_offset[num_blocks];
+	delta.indices.resize( total_removed );
+	delta.records.resize( total_removed * stride );
+	delta.normals.resize( total_removed );
+	if( total_removed == 0 ) return count;
+
+	// Each block packs its kept points to its own start and copies out what it removed,
+	// the blocks don't overlap so they can all do this at the same time
+	std::vector<size_t> kept( num_blocks, 0 );
+	parallel_for( num_blocks, [&]( size_t first, size_t last ) {
+		for( size_t b = first; b < last; b++ )
+		{
+			size_t begin = b * block_size;
+			size_t end = std::min( count, begin + block_size );
+			size_t write = begin;
+			size_t removed = removed_offset[b];
+
+			for( size_t i = begin; i < end; i++ )
+			{
+				if( remove.test( i ) )
+				{
+					delta.indices[removed] = (unsigned int)i;
+					std::memcpy( &delta.records[removed * stride], &data_[i * stride], sizeof( GLfloat ) * stride );
+					delta.normals[removed] = normals_[i];
+					removed++;
+				}
+				else
+				{
+					if( write != i ) std::memcpy( &data_[write * stride], &data_[i * stride], sizeof( GLfloat ) * stride );
+					normals_[write] = normals_[i];
+					write++;
+				}
+			}
+			kept[b] = write - begin;
+		}
+	}, 2 );
+
+	// Slide the packed blocks down into place, the destination is always before the source
+	size_t write = 0;
+	for( size_t b = 0; b < num_blocks; b++ )
+	{
+		size_t begin = b * block_size;
+		if( write != begin )
+		{
+			std::memmove( &data_[write * stride], &data_[begin * stride], sizeof( GLfloat ) * stride * kept[b] );
+			std::memmove( &normals_[write], &normals_[begin], sizeof( normals_[0] ) * kept[b] );
+		}
+		write += kept[b];
+	}
+	data_.resize( write * stride );
+	normals_.resize( write );
+
+	return delta.indices.front();
+}
+
+size_t PointCloud::restorePoints( const EditDelta& delta )
+{
+	const size_t stride = 6;
+	const size_t old_count = (size_t)num_verts_;
+	const size_t added = delta.indices.size();
+	if( added == 0 ) return old_count;
+
+	data_.resize( (old_count + added) * stride );
+	normals_.resize( old_count + added );
+
+	// Merge from the back, each removed point goes back to its old index and everything
+	// after it shifts up, the points before the first one don't move at all
+	size_t read_end = old_count;
+	size_t write_end = old_count + added;
+	for( size_t j = added; j-- > 0; )
+	{
+		size_t target = delta.indices[j];
+		size_t moving = write_end - target - 1;
+
+		if( moving > 0 )
+		{
+			std::memmove( &data_[(target + 1) * stride], &data_[(read_end - moving) * stride], sizeof( GLfloat ) * stride * moving );
+			std::memmove( &normals_[target + 1], &normals_[read_end - moving], sizeof( normals_[0] ) * moving );
+		}
+		read_end -= moving;
+
+		std::memcpy( &data_[target * stride], &delta.records[j * stride], sizeof( GLfloat ) * stride );
+		normals_[target] = delta.normals[j];
+		write_end = target;
+	}
+
+	return delta.indices.front();
+}
+
+void PointCloud::finishEdit( size_t first_changed, const EditDelta& delta, bool removed )
+{
+	GLsizei count = (GLsizei)(data_.size() / 6);
+
+	// Positions have changed index, the data can't be moved again or the buffer would need sending in full
+	kd_tree_.build( data_, 6, false );
+
+	// Only the points from the first change onwards have moved
+	edit_upload_bytes_ = 0;
+	GLState::bindBuffer( GL_ARRAY_BUFFER, vbo_ );
+	if( count > vbo_capacity_ )
+	{
+		glBufferData( GL_ARRAY_BUFFER, sizeof( data_[0] ) * data_.size(), data_.data(), GL_STATIC_DRAW );
+		edit_upload_bytes_ = sizeof( data_[0] ) * data_.size();
+
+		GLState::bindBuffer( GL_ARRAY_BUFFER, normal_vbo_ );
+		glBufferData( GL_ARRAY_BUFFER, sizeof( normals_[0] ) * normals_.size(), normals_.data(), GL_STATIC_DRAW );
+		edit_upload_bytes_ += sizeof( normals_[0] ) * normals_.size();
+
+		GLState::bindBuffer( GL_ARRAY_BUFFER, flag_vbo_ );
+		glBufferData( GL_ARRAY_BUFFER, count, nullptr, GL_DYNAMIC_DRAW );
+		vbo_capacity_ = count;
+		first_changed = 0;
+	}
+	else if( first_changed < (size_t)count )
+	{
+		size_t offset = first_changed * 6;
+		glBufferSubData( GL_ARRAY_BUFFER, sizeof( data_[0] ) * offset, sizeof( data_[0] ) * (data_.size() - offset), &data_[offset] );
+		edit_upload_bytes_ = sizeof( data_[0] ) * (data_.size() - offset);
+
+		GLState::bindBuffer( GL_ARRAY_BUFFER, normal_vbo_ );
+		glBufferSubData( GL_ARRAY_BUFFER, sizeof( normals_[0] ) * first_changed, sizeof( normals_[0] ) * (normals_.size() - first_changed), &normals_[first_changed] );
+		edit_upload_bytes_ += sizeof( normals_[0] ) * (normals_.size() - first_changed);
+	}
+	num_verts_ = count;
+
+	// Chunks before the first change still hold the same points
+	compute_chunk_bounds( data_, 6, normals_, first_changed / ChunkBounds::CHUNK_POINTS, chunk_bounds_ );
+
+	// The selection is cleared, flags before the first change only need clearing if any were set
+	size_t first_dirty = std::min( first_changed, selection_.firstSet() );
+	selection_.reset( count, first_dirty );
+
+	// Bounds of the points that were added or removed
+	glm::vec3 changed_max( -1e30f );
+	glm::vec3 changed_min( 1e30f );
+	for( size_t i = 0; i < delta.indices.size(); i++ )
+	{
+		glm::vec3 p( delta.records[i * 6 + 0], delta.records[i * 6 + 1], delta.records[i * 6 + 2] );
+		changed_max = glm::max( changed_max, p );
+		changed_min = glm::min( changed_min, p );
+	}
+
+	if( removed )
+	{
+		// The bounds can only shrink if a removed point was on them
+		if( glm::any( glm::greaterThanEqual( changed_max, lower_bound_ ) ) || glm::any( glm::lessThanEqual( changed_min, upper_bound_ ) ) )
+		{
+			calculateAABB();
+		}
+	}
+	else
+	{
+		lower_bound_ = glm::max( lower_bound_, changed_max );
+		upper_bound_ = glm::min( upper_bound_, changed_min );
+	}
+}
+
+bool PointCloud::exportFile( std::string filepath, PlyWriter::Format format, bool selected_only )
+{
+	if( selected_only && selection_.count() == 0 )
+	{
+		std::cout << "ERROR: nothing is selected to export" << std::endl;
+		return false;
+	}
+
+	return ply_writer_.writeAsync( filepath, data_, format, selected_only ? &selection_ : nullptr );
+}
+
+bool PointCloud::exportBox( std::string filepath, PlyWriter::Format format, const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper )
+{
+	Selection inside;
+	inside.resize( num_verts_ );
+	box_query( box_to_world, lower, upper, inside, true );
+
+	return ply_writer_.writeAsync( filepath, data_, format, &inside );
+}
+
+void PointCloud::setViewpoints( const glm::vec3* world_eyes, int count )
+{
+	num_eyes_ = std::min( count, MAX_EYES );
+	for( int e = 0; e < num_eyes_; e++ ) eyes_[e] = world_eyes[e];
+}
+
+void PointCloud::setViews( const LodStreamer::View* views, int count )
+{
+	num_views_ = std::min( count, MAX_EYES );
+	for( int v = 0; v < num_views_; v++ ) views_[v] = views[v];
+}
+
+void PointCloud::setPrefetchViews( const LodStreamer::View* views, int count )
+{
+	num_prefetch_views_ = std::min( count, MAX_EYES );
+	for( int v = 0; v < num_prefetch_views_; v++ ) prefetch_views_[v] = views[v];
+}
\ No newline at end of file
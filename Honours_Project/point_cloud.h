@@ -4,6 +4,15 @@
 #include <glm.hpp>
 #include <openvr.h>
 #include "ply_loader.h"
+#include "ply_writer.h"
+#include "render_queue.h"
+#include "transform.h"
+#include "kd_tree.h"
+#include "selection.h"
+#include "chunk_bounds.h"
+#include "lod_streamer.h"
+#include "buffer_uploader.h"
+#include <mutex>
 
 class MoveTool;
 
@@ -16,45 +25,190 @@ public:
 	bool init();
 	void shutdown();
 	void update( float dt );
-	void render( const glm::mat4& view, const glm::mat4& projection );
+	void submit( RenderQueue& queue );
 	void resetPosition();
 	void loadFile( std::string filepath );
+	// Streams a hierarchy made by Octree_Converter instead of loading every point. While streaming the
+	// cloud has no points of its own, so queries, selection and editing find nothing
+	bool loadHierarchy( std::string directory );
 
 	// Getters
 	glm::mat4 modelMatrix() const { return model_mat_; }
 	glm::mat4 offsetMatrix() const { return offset_mat_; }
 	glm::mat4 combinedOffsetMatrix();
+	// Follows the combined offset matrix, parent objects to this to move them with the point cloud
+	Transform* node() { return &node_; }
+	// The points in tree order, which is also the order they are in the vertex buffer
+	const KdTree& kdTree() const { return kd_tree_; }
+	// Held while the points or the tree change, other threads must hold it while using the tree
+	std::mutex& indexMutex() const { return index_mutex_; }
+	const Selection& selection() const { return selection_; }
+	size_t selectionUploadBytes() const { return selection_upload_bytes_; }
+	const glm::mat4& worldMatrix() const { return world_mat_; }
+	GLuint vao() const { return vao_; }
 	glm::vec3 lowerBound() const { return lower_bound_; }
 	glm::vec3 upperBound() const { return upper_bound_; }
 	ShaderProgram** activeShaderAddr() { return &active_shader_; }
+	bool backfaceCulling() const { return backface_culling_; }
+	size_t culledPoints() const { return culled_points_; }
+	const std::vector<ChunkBounds>& chunkBounds() const { return chunk_bounds_; }
+	// Octahedral encoded, see normals.h
+	const std::vector<uint32_t>& normals() const { return normals_; }
+	bool streaming() const { return streamer_.isOpen(); }
+	// True while a loaded file is still being uploaded, nothing is drawn until it finishes
+	bool buffersPending() const { return pending_vbo_ != nullptr; }
+	const LodStreamer& streamer() const { return streamer_; }
+	LodStreamer& streamer() { return streamer_; }
 
 	// Setters
 	void setMoveTool( MoveTool* move_tool ) { move_tool_ = move_tool; }
-	void setOffsetMatrix( glm::mat4 offset ) { offset_mat_ = offset; }
-	void setModelMatrix( const glm::mat4& model ) { model_mat_ = model; }
+	void setOffsetMatrix( glm::mat4 offset ) { offset_mat_ = offset; updateNode(); }
+	void setModelMatrix( const glm::mat4& model ) { model_mat_ = model; updateNode(); }
 	void setActiveShader( ShaderProgram* shader ) { active_shader_ = shader; }
+	// World positions of the eyes this frame will be drawn from, chunks facing away from all of them aren't drawn
+	void setViewpoints( const glm::vec3* world_eyes, int count );
+	void setBackfaceCulling( bool culling ) { backface_culling_ = culling; }
+	// Views a streamed hierarchy is culled and refined against, one per eye
+	void setViews( const LodStreamer::View* views, int count );
+	// Views predicted the streamer's prefetch time ahead, the point cloud predicts its own movement to match
+	void setPrefetchViews( const LodStreamer::View* views, int count );
+
+	// Queries, positions and distances are all in world space
+
+	glm::vec3 toLocal( const glm::vec3& world_position ) const { return glm::vec3( inverse_world_mat_ * glm::vec4( world_position, 1.0f ) ); }
+	float worldScale() const { return world_scale_; }
+	// Position of a point from the XYZRGB data, in the point cloud's own space
+	glm::vec3 position( size_t index ) const { return glm::vec3( data_[index * 6 + 0], data_[index * 6 + 1], data_[index * 6 + 2] ); }
+	glm::vec3 worldPosition( size_t index ) const { return glm::vec3( world_mat_ * glm::vec4( position( index ), 1.0f ) ); }
+	// Index of the point nearest a world space position, or -1 if none are within max_distance metres
+	int nearestPoint( const glm::vec3& world_position, float max_distance, glm::vec3* world_point = nullptr ) const;
+	// First point hit by a world space ray, each point is treated as a sphere of 'radius' metres.
+	// The hit distance and position are returned in world space
+	bool raycast( const glm::vec3& world_origin, const glm::vec3& world_direction, float radius, float max_distance, KdTree::RayHit* hit ) const;
+
+	// Selection, pass false for 'select' to deselect instead.
+	// Only the parts of the flag buffer that changed are sent to the GPU during update()
+	void selectSphere( const glm::vec3& world_centre, float radius, bool select = true );
+	// The box is from lower to upper in the space given by box_to_world
+	void selectBox( const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper, bool select = true );
+	// The polygon is in normalised device coordinates of the given view projection
+	void selectLasso( const std::vector<glm::vec2>& polygon, const glm::mat4& view_projection, bool select = true );
+	void selectPoint( size_t index, bool select = true ) { selection_.set( index, select ); }
+	void clearSelection() { selection_.clear(); }
+
+	// Editing, every edit can be undone. The points keep their order, so only the part of the
+	// vertex buffer after the first point that moved is sent again
+	void deleteSelection();
+	void cropToSelection();
+	void cropToBox( const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper );
+	bool undo();
+	bool redo();
+	bool canUndo() const { return !undo_stack_.empty(); }
+	bool canRedo() const { return !redo_stack_.empty(); }
+	size_t numPoints() const { return (size_t)num_verts_; }
+	size_t lastEditUploadBytes() const { return edit_upload_bytes_; }
+	double lastEditTime() const { return edit_ms_; }
+
+	// Exporting runs on a background thread and reads the points in place, so editing
+	// and loading wait for it to finish. Returns false if it couldn't be started
+	bool exportFile( std::string filepath, PlyWriter::Format format, bool selected_only = false );
+	bool exportBox( std::string filepath, PlyWriter::Format format, const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper );
+	const PlyWriter& plyWriter() const { return ply_writer_; }
 
 protected:
 
 	PlyLoader ply_loader_;
+	PlyWriter ply_writer_;
 	std::vector<GLfloat> data_;
 
 	ShaderProgram* active_shader_;
 	MoveTool* move_tool_;
 
 	GLint modl_matrix_location_;
-	GLint view_matrix_location_;
-	GLint proj_matrix_location_;
+	ShaderProgram* located_shader_ = nullptr;
 	glm::mat4 offset_mat_;
 	glm::mat4 model_mat_;
 
+	// Only recalculated when the model or offset matrix changes
+	void updateNode();
+	Transform node_;
+	glm::mat4 world_mat_;
+	glm::mat4 inverse_world_mat_;
+	float world_scale_ = 1.0f;
+
+	KdTree kd_tree_;
+	mutable std::mutex index_mutex_;
+
+	// Sets or clears the points inside the box in 'target', see selectBox()
+	void box_query( const glm::mat4& box_to_world, const glm::vec3& lower, const glm::vec3& upper, Selection& target, bool select ) const;
+
+	// The points an edit removed, enough to put them back. The indices are sorted and refer to
+	// the data from before the edit, the records are the removed XYZRGB values and normals in the same order
+	struct EditDelta {
+		std::vector<unsigned int> indices;
+		std::vector<GLfloat> records;
+		std::vector<uint32_t> normals;
+	};
+
+	// Both return the index of the first point that moved, or the point count if nothing changed
+	size_t removePoints( const Selection& remove, EditDelta& delta );
+	size_t restorePoints( const EditDelta& delta );
+	// Rebuild the index and send what changed after an edit
+	void finishEdit( size_t first_changed, const EditDelta& delta, bool removed );
+
+	std::vector<EditDelta> undo_stack_;
+	std::vector<EditDelta> redo_stack_;
+	GLsizei vbo_capacity_ = 0;
+	size_t edit_upload_bytes_ = 0;
+	double edit_ms_ = 0.0;
+
+	// Octahedral encoded, one per point in the same order as the data. Read from the file if it has them,
+	// otherwise estimated from the NORMAL_NEIGHBOURS nearest points and cached next to the file
+	static const size_t NORMAL_NEIGHBOURS = 16;
+	std::vector<uint32_t> normals_;
+	GLuint normal_vbo_ = 0;
+
+	// Backface culling by chunk, the ranges that are left are drawn with one multi draw
+	static const int MAX_EYES = 2;
+	std::vector<ChunkBounds> chunk_bounds_;
+	glm::vec3 eyes_[MAX_EYES];
+	int num_eyes_ = 0;
+	// Off by default, estimated normals only face away from the centroid so they are wrong in concave parts
+	// and from inside the cloud. Only worth turning on when the file's normals are known to be consistent
+	bool backface_culling_ = false;
+	size_t culled_points_ = 0;
+	std::vector<GLint> draw_firsts_;
+	std::vector<GLsizei> draw_counts_;
+
+	// Only used by hierarchies, which bring their own node buffers
+	LodStreamer streamer_;
+	LodStreamer::View views_[MAX_EYES];
+	int num_views_ = 0;
+	LodStreamer::View prefetch_views_[MAX_EYES];
+	int num_prefetch_views_ = 0;
+
+	// One byte per point on the GPU, 1 when selected, sent a chunk at a time when it changes
+	void uploadSelection();
+	Selection selection_;
+	GLuint flag_vbo_ = 0;
+	std::vector<GLubyte> flag_chunk_;
+	size_t selection_upload_bytes_ = 0;
+
 	GLuint vao_;
 	GLuint vbo_;
 	GLsizei num_verts_;
 
+	// Buffers the upload thread is filling from a newly loaded file, data_ and normals_ must not change until they are swapped in
+	BufferUploader::Handle pending_vbo_;
+	BufferUploader::Handle pending_normal_vbo_;
+	// Replaces vbo_ and normal_vbo_ with the pending buffers once both are finished, or waits for them if 'wait' is true
+	void swap_in_buffers( bool wait );
+	// Points the vertex array's position, colour and normal attributes at vbo_ and normal_vbo_
+	void bind_attributes();
+
+	// Note this stores the largest XYZ in lower_bound_ and the smallest in upper_bound_
 	void calculateAABB();
 
-	GLuint aabb_vao_;
 	glm::vec3 lower_bound_;
 	glm::vec3 upper_bound_;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "point_light_tool.h"
 #include "controller.h"
+#include "gl_state.h"
 #include "gtx/matrix_decompose.hpp"
 
 PointLightTool::PointLightTool() :
@@ -56,9 +57,9 @@ void PointLightTool::update( float dt )
 		activate_shader_->bind();
 
 		// Send the position to the shader
-		glUniform3f( tool_shader_position_location_, light_pos_.x, light_pos_.y, light_pos_.x );
+		glUniform3f( tool_shader_position_location_, light_pos_.x, light_pos_.y, light_pos_.z );
 
-		glUseProgram( 0 );
+		GLState::useProgram( 0 );
 	}
 	else
 	{
@@ -1,9 +1,11 @@
 #include "pointer_tool.h"
 #include "shader_program.h"
 #include "vr_system.h"
+#include "debug_draw.h"
+#include "point_cloud.h"
+#include "proximity_service.h"
 #include <glm.hpp>
 #include <gtc/type_ptr.hpp>
-#include <vector>
 
 PointerTool::PointerTool() :
 	VRTool( VRToolType::Pointer )
@@ -17,43 +19,14 @@ bool PointerTool::init()
 	initialised_ = true;
 	bool success = true;
 
-	glGenVertexArrays( 1, &vao_ );
-	glBindVertexArray( vao_ );
-	glGenBuffers( 1, &vbo_ );
-	glBindBuffer( GL_ARRAY_BUFFER, vbo_ );
-
-	GLuint stride = 2 * 3 * sizeof( GLfloat );
-	GLuint offset = 0;
-
-	glEnableVertexAttribArray( 0 );
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
-
-	offset += sizeof( GLfloat ) * 3;
-	glEnableVertexAttribArray( 1 );
-	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
-
-	shader_modl_mat_location_ = shader_->getUniformLocation( "model" );
-	shader_view_mat_location_ = shader_->getUniformLocation( "view" );
-	shader_proj_mat_location_ = shader_->getUniformLocation( "projection" );
-
 	sphere_.setRadius( 0.04f );
-	sphere_.init();
+	sphere_.setParent( &controller_node_ );
 
 	return success;
 }
 
 void PointerTool::shutdown()
 {
-	if( vao_ )
-	{
-		glDeleteVertexArrays( 1, &vao_ );
-		vao_ = 0;
-	}
-	if( vbo_ )
-	{
-		glDeleteBuffers( 1, &vbo_ );
-		vbo_ = 0;
-	}
 }
 
 void PointerTool::activate()
@@ -70,41 +43,95 @@ void PointerTool::deactivate()
 
 void PointerTool::update( float dt )
 {
-	if( controller_ && controller_->isButtonDown( vr::k_EButton_SteamVR_Touchpad ) )
+	// The sphere is drawn by the scene along with the targets
+	if( controller_ )
 	{
-		glBindVertexArray( vao_ );
-		glBindBuffer( GL_ARRAY_BUFFER, vbo_ );
-		float length = -0.45f + -0.4f * controller_->axis( vr::k_EButton_Axis0 ).y;
-
-		std::vector<GLfloat> verts = {
-			0.0f, 0.0f, 0.0f,   1.0f, 1.0f, 1.0f,
-			0.0f, 0.0f, length, 1.0f, 0.0f, 1.0f
-		};
+		controller_node_.setLocal( controller_->deviceToAbsoluteTracking() );
+	}
 
-		glBufferData( GL_ARRAY_BUFFER, sizeof( verts[0] ) * verts.size(), verts.data(), GL_STREAM_DRAW );
-		num_verts_ = verts.size() / 6;
+	if( controller_ && controller_->isButtonDown( vr::k_EButton_SteamVR_Touchpad ) )
+	{
+		line_length_ = -0.45f + -0.4f * controller_->axis( vr::k_EButton_Axis0 ).y;
+		show_line_ = true;
+
+		glm::vec3 tip( 0.0f, 0.0f, line_length_ );
+		snapped_point_ = -1;
+
+		KdTree::RayHit hit;
+		const glm::mat4& controller = controller_node_.world();
+		if( ray_casting_ && point_cloud_ )
+		{
+			// The controller points down its negative z axis
+			glm::vec3 origin = glm::vec3( controller[3] );
+			glm::vec3 direction = -glm::vec3( controller[2] );
+			if( point_cloud_->raycast( origin, direction, ray_point_radius_, ray_length_, &hit ) )
+			{
+				snapped_point_ = hit.index;
+				tip = glm::vec3( glm::inverse( controller ) * glm::vec4( hit.position, 1.0f ) );
+			}
+		}
+
+		if( snapped_point_ < 0 && snapping_ && point_cloud_ )
+		{
+			glm::vec3 world_tip = glm::vec3( controller * glm::vec4( tip, 1.0f ) );
+
+			glm::vec3 world_point;
+			snapped_point_ = point_cloud_->nearestPoint( world_tip, snap_distance_, &world_point );
+			if( snapped_point_ >= 0 )
+			{
+				tip = glm::vec3( glm::inverse( controller ) * glm::vec4( world_point, 1.0f ) );
+			}
+		}
 
 		sphere_.setActive( true );
-		sphere_.setPosition( { 0.0f, 0.0f, length } );
-		sphere_.update( dt );
+		sphere_.setPosition( tip );
+
+		// Paint the selection with the sphere, the grip takes points away
+		if( point_cloud_ )
+		{
+			if( controller_->isButtonDown( vr::k_EButton_SteamVR_Trigger ) )
+			{
+				point_cloud_->selectSphere( sphere_.worldPosition(), sphere_.radius(), true );
+			}
+			else if( controller_->isButtonDown( vr::k_EButton_Grip ) )
+			{
+				point_cloud_->selectSphere( sphere_.worldPosition(), sphere_.radius(), false );
+			}
+		}
 	}
 	else
 	{
 		sphere_.setActive( false );
-		num_verts_ = 0;
+		show_line_ = false;
+		snapped_point_ = -1;
 	}
+
+	update_proximity();
 }
 
-void PointerTool::render( const glm::mat4& view, const glm::mat4& projection )
+void PointerTool::update_proximity()
 {
-	shader_->bind();
-	glUniformMatrix4fv( shader_view_mat_location_, 1, GL_FALSE, glm::value_ptr( view ) );
-	glUniformMatrix4fv( shader_proj_mat_location_, 1, GL_FALSE, glm::value_ptr( projection ) );
-	glUniformMatrix4fv( shader_modl_mat_location_, 1, GL_FALSE, glm::value_ptr( controller_->deviceToAbsoluteTracking() ) );
+	if( !proximity_ || !controller_ ) return;
+
+	// The tip of the pointer when it is out, otherwise the controller itself
+	ProximityService::PoseSample pose;
+	pose.time = ProximityService::now();
+	if( point_cloud_ && controller_->isPoseValid() )
+	{
+		glm::vec3 tip = sphere_.active() ? sphere_.worldPosition() : controller_node_.worldPosition();
+		pose.position = point_cloud_->toLocal( tip );
+		pose.scale = point_cloud_->worldScale();
+		pose.valid = true;
+	}
 
-	glBindVertexArray( vao_ );
-	glDrawArrays( GL_LINES, 0, num_verts_ );
+	proximity_->publish( pose );
+	proximity_->drain( *controller_ );
+}
+
+void PointerTool::submit( RenderQueue& queue )
+{
+	if( !show_line_ || !controller_ ) return;
 
-	sphere_.setParentTransform( controller_->deviceToAbsoluteTracking() );
-	sphere_.render( view, projection );
+	// Ray from the controller out to the sphere, which may have snapped off the end
+	DebugDraw::line( glm::vec3( 0.0f ), sphere_.position(), glm::vec3( 1.0f, 1.0f, 1.0f ), glm::vec3( 1.0f, 0.0f, 1.0f ), controller_node_.world() );
 }
\ No newline at end of file
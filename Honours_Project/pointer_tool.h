@@ -4,6 +4,9 @@
 #include "GL/glew.h"
 #include "sphere.h"
 
+class PointCloud;
+class ProximityService;
+
 class PointerTool : public VRTool
 {
 public:
@@ -16,21 +19,48 @@ public:
 	void activate() override;
 	void deactivate() override;
 	void update( float dt ) override;
-	void render( const glm::mat4& view, const glm::mat4& projection ) override;
+	void submit( RenderQueue& queue ) override;
 
 	// Getters
 
 	// If you want to return a sphere copy you will need to define an explicit copy constructor
 	const Sphere& sphere() const { return sphere_; }
+	// World transform of the controller the pointer is attached to, looking down -Z
+	const glm::mat4& controllerMatrix() const { return controller_node_.world(); }
+	// Index of the point the tip snapped to this frame, or -1
+	int snappedPoint() const { return snapped_point_; }
+	bool snapping() const { return snapping_; }
+	bool rayCasting() const { return ray_casting_; }
+	ProximityService* proximityService() const { return proximity_; }
+
+	// Setters
+	void setPointCloud( PointCloud* point_cloud ) { point_cloud_ = point_cloud; }
+	// The tip is published to the service every update and any pulses it queued are played on the controller
+	void setProximityService( ProximityService* proximity ) { proximity_ = proximity; }
+	void setSnapping( bool snapping ) { snapping_ = snapping; }
+	void setRayCasting( bool ray_casting ) { ray_casting_ = ray_casting; }
 
 protected:
 
+	// Follows the controller, the sphere sits at the end of the pointer
+	Transform controller_node_;
 	Sphere sphere_;
 
-	GLuint vao_ = 0;
-	GLuint vbo_ = 0;
-	GLsizei num_verts_ = 0;
-	GLint shader_view_mat_location_ = 0;
-	GLint shader_proj_mat_location_ = 0;
-	GLint shader_modl_mat_location_ = 0;
+	bool show_line_ = false;
+	float line_length_ = 0.0f;
+
+	// Move the tip onto the nearest point of the cloud if there is one close enough
+	PointCloud* point_cloud_ = nullptr;
+	bool snapping_ = true;
+	float snap_distance_ = 0.05f;
+	int snapped_point_ = -1;
+
+	// Put the tip where the controller's ray first hits the cloud, so distant points can be reached
+	bool ray_casting_ = false;
+	float ray_length_ = 10.0f;
+	float ray_point_radius_ = 0.005f;
+
+	// Buzz as the tip gets close to the surface
+	void update_proximity();
+	ProximityService* proximity_ = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "proximity_service.h"
+#include "point_cloud.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+ProximityService::ProximityService()
+{
+
+}
+
+ProximityService::~ProximityService()
+{
+	stop();
+}
+
+bool ProximityService::start( const PointCloud* point_cloud )
+{
+	if( running_ || !point_cloud ) return false;
+
+	point_cloud_ = point_cloud;
+	running_ = true;
+	thread_ = std::thread( &ProximityService::run, this );
+	return true;
+}
+
+void ProximityService::stop()
+{
+	running_ = false;
+	if( thread_.joinable() ) thread_.join();
+	last_distance_ = -1.0f;
+}
+
+void ProximityService::publish( const PoseSample& pose )
+{
+	{
+		std::lock_guard<std::mutex> lock( pose_mutex_ );
+		pose_ = pose;
+	}
+
+	if( recording_ ) recorded_poses_.push_back( pose );
+}
+
+void ProximityService::drain( HapticsSink& sink )
+{
+	HapticPulse strongest;
+	HapticPulse pulse;
+	while( pulses_.pop( pulse ) )
+	{
+		strongest.duration_us = std::max( strongest.duration_us, pulse.duration_us );
+	}
+
+	if( strongest.duration_us > 0 ) sink.pulse( strongest );
+}
+
+void ProximityService::startRecording()
+{
+	recorded_poses_.clear();
+	recording_ = true;
+}
+
+double ProximityService::now()
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void ProximityService::run()
+{
+	const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( 1.0 / query_hz_ ) );
+	auto next_tick = std::chrono::steady_clock::now();
+
+	double last_pulse = 0.0;
+	double rate_start = now();
+	unsigned int queries = 0;
+
+	while( running_ )
+	{
+		PoseSample pose;
+		{
+			std::lock_guard<std::mutex> lock( pose_mutex_ );
+			pose = pose_;
+		}
+
+		double time = now();
+		float distance = -1.0f;
+
+		if( pose.valid && pose.scale > 0.0f && time - pose.time < max_pose_age_ )
+		{
+			// Edits and loading rebuild the tree, they hold this lock while they do
+			float local_distance = 0.0f;
+			int index;
+			{
+				std::lock_guard<std::mutex> lock( point_cloud_->indexMutex() );
+				index = point_cloud_->kdTree().nearest( pose.position, range_ / pose.scale, &local_distance );
+			}
+			queries++;
+
+			if( index >= 0 ) distance = local_distance * pose.scale;
+		}
+		last_distance_ = distance;
+
+		// Stronger the closer the pointer is to the surface
+		if( distance >= 0.0f && time - last_pulse >= pulse_interval_ )
+		{
+			float closeness = 1.0f - distance / range_;
+			HapticPulse pulse;
+			pulse.duration_us = (unsigned short)std::max( 100.0f, max_pulse_us_ * closeness * closeness );
+
+			// A full queue means nobody is draining it, dropping the pulse is the right thing to do
+			if( pulses_.push( pulse ) ) pulses_queued_++;
+			last_pulse = time;
+		}
+
+		if( time - rate_start >= 1.0 )
+		{
+			queries_per_second_ = (unsigned int)(queries / (time - rate_start));
+			queries = 0;
+			rate_start = time;
+		}
+
+		next_tick += tick;
+		std::this_thread::sleep_until( next_tick );
+	}
+}
+
+bool ProximityService::saveRecording( const std::string& filepath, const std::vector<PoseSample>& poses )
+{
+	std::ofstream file( filepath );
+	if( !file.good() )
+	{
+		std::cout << "ERROR: could not open '" << filepath << "' for writing" << std::endl;
+		return false;
+	}
+
+	// One pose per line: time x y z scale valid
+	file.precision( 9 );
+	for( const PoseSample& pose : poses )
+	{
+		file << pose.time << " " << pose.position.x << " " << pose.position.y << " " << pose.position.z << " " << pose.scale << " " << (pose.valid ? 1 : 0) << "\n";
+	}
+
+	std::cout << "Saved " << poses.size() << " poses to '" << filepath << "'" << std::endl;
+	return file.good();
+}
+
+bool ProximityService::loadRecording( const std::string& filepath, std::vector<PoseSample>& poses )
+{
+	std::ifstream file( filepath );
+	if( !file.good() )
+	{
+		std::cout << "ERROR: could not open '" << filepath << "'" << std::endl;
+		return false;
+	}
+
+	poses.clear();
+	PoseSample pose;
+	int valid;
+	while( file >> pose.time >> pose.position.x >> pose.position.y >> pose.position.z >> pose.scale >> valid )
+	{
+		pose.valid = valid != 0;
+		poses.push_back( pose );
+	}
+
+	std::cout << "Loaded " << poses.size() << " poses from '" << filepath << "'" << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "haptics.h"
+#include "spsc_queue.h"
+
+class PointCloud;
+
+// Buzzes the controller as the pointer gets close to the scan. The main thread publishes the latest
+// pointer pose each frame, a thread of its own finds the distance to the nearest point many times
+// a frame and queues pulses, which the main thread then hands to a HapticsSink.
+//
+// Poses can be recorded to a file and replayed against any sink, see replay_proximity().
+
+class ProximityService
+{
+public:
+	// Where the pointer was, in the point cloud's own space so a recording still lines up if the cloud is moved
+	struct PoseSample {
+		double time = 0.0;           // Seconds
+		glm::vec3 position;
+		float scale = 1.0f;          // Metres per point cloud unit
+		bool valid = false;
+	};
+
+	ProximityService();
+	~ProximityService();
+
+	// Starts querying the point cloud's k-d tree on a new thread
+	bool start( const PointCloud* point_cloud );
+	void stop();
+
+	// Main thread only. The newest pose replaces the last one, poses older than max_pose_age_ are ignored
+	void publish( const PoseSample& pose );
+	// Main thread only. Only the strongest pulse queued since the last drain is played, so the sink
+	// is never asked for more than one pulse a frame
+	void drain( HapticsSink& sink );
+
+	// Every published pose is kept while recording
+	void startRecording();
+	void stopRecording() { recording_ = false; }
+	const std::vector<PoseSample>& recording() const { return recorded_poses_; }
+	static bool saveRecording( const std::string& filepath, const std::vector<PoseSample>& poses );
+	static bool loadRecording( const std::string& filepath, std::vector<PoseSample>& poses );
+
+	// Seconds on the same clock the service uses, for stamping poses
+	static double now();
+
+	// Setters, only while stopped
+	void setRange( float metres ) { range_ = metres; }
+	void setQueryRate( float hz ) { query_hz_ = hz; }
+
+	// Getters
+	bool isRunning() const { return running_; }
+	bool isRecording() const { return recording_; }
+	float range() const { return range_; }
+	// Metres from the pointer to the nearest point, or -1 if there isn't one in range
+	float lastDistance() const { return last_distance_; }
+	unsigned int queriesPerSecond() const { return queries_per_second_; }
+	unsigned int pulsesQueued() const { return pulses_queued_; }
+
+protected:
+	void run();
+
+	const PointCloud* point_cloud_ = nullptr;
+	std::thread thread_;
+	std::atomic<bool> running_{ false };
+
+	// The latest pose, only ever held for a copy
+	std::mutex pose_mutex_;
+	PoseSample pose_;
+
+	// Written by the query thread, read by drain()
+	SpscQueue<HapticPulse, 64> pulses_;
+
+	float range_ = 0.05f;
+	float query_hz_ = 1000.0f;
+	double pulse_interval_ = 0.01;
+	double max_pose_age_ = 0.1;
+	unsigned short max_pulse_us_ = 3000;
+
+	std::atomic<float> last_distance_{ -1.0f };
+	std::atomic<unsigned int> queries_per_second_{ 0 };
+	std::atomic<unsigned int> pulses_queued_{ 0 };
+
+	bool recording_ = false;
+	std::vector<PoseSample> recorded_poses_;
+};
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "render_model_cache.h"
+#include "gl_state.h"
+#include <iostream>
+#include <cstddef>
+
+RenderModelCache::RenderModelCache()
+{}
+
+RenderModelCache::~RenderModelCache()
+{
+	shutdown();
+}
+
+const RenderModelCache::Model* RenderModelCache::request( const std::string& name )
+{
+	auto found = models_.find( name );
+	if( found != models_.end() )
+	{
+		Model& model = *found->second;
+		if( model.state == State::Failed )
+		{
+			std::cout << "Retrying render model '" << name << "'" << std::endl;
+			model.state = State::LoadingModel;
+		}
+		return &model;
+	}
+
+	std::unique_ptr<Model> model( new Model() );
+	model->name = name;
+	if( name.empty() )
+	{
+		std::cout << "ERROR: device has no render model name!" << std::endl;
+		model->state = State::Failed;
+	}
+	else
+	{
+		std::cout << "Loading render model '" << name << "'..." << std::endl;
+	}
+
+	Model* result = model.get();
+	models_[name] = std::move( model );
+	return result;
+}
+
+void RenderModelCache::update()
+{
+	vr::IVRRenderModels* render_models = vr::VRRenderModels();
+	if( !render_models ) return;
+
+	bool created = false;
+	for( auto& entry : models_ )
+	{
+		Model& model = *entry.second;
+
+		// Each call returns straight away, VRRenderModelError_Loading just means ask again next frame
+		if( model.state == State::LoadingModel )
+		{
+			vr::EVRRenderModelError error = render_models->LoadRenderModel_Async( model.name.c_str(), &model.vr_model );
+			if( error == vr::VRRenderModelError_None )
+			{
+				model.state = State::LoadingTexture;
+			}
+			else if( error != vr::VRRenderModelError_Loading )
+			{
+				std::cout << "ERROR: could not load render model '" << model.name << "', error " << error << std::endl;
+				free_vr_data( model );
+				model.state = State::Failed;
+			}
+		}
+
+		// A texture that arrived on a frame another model was made on is already held, it isn't asked for again
+		if( model.state == State::LoadingTexture )
+		{
+			vr::EVRRenderModelError error = vr::VRRenderModelError_None;
+			if( !model.vr_texture ) error = render_models->LoadTexture_Async( model.vr_model->diffuseTextureId, &model.vr_texture );
+
+			if( error == vr::VRRenderModelError_None && !created )
+			{
+				create_gl_objects( model );
+				free_vr_data( model );
+				model.state = State::Ready;
+				created = true;
+			}
+			else if( error != vr::VRRenderModelError_None && error != vr::VRRenderModelError_Loading )
+			{
+				std::cout << "ERROR: could not load texture for render model '" << model.name << "', error " << error << std::endl;
+				free_vr_data( model );
+				model.state = State::Failed;
+			}
+		}
+	}
+}
+
+void RenderModelCache::shutdown()
+{
+	for( auto& entry : models_ )
+	{
+		Model& model = *entry.second;
+		free_vr_data( model );
+
+		if( model.vao ) GLState::deleteVertexArrays( 1, &model.vao );
+		if( model.vbo ) GLState::deleteBuffers( 1, &model.vbo );
+		if( model.ebo ) GLState::deleteBuffers( 1, &model.ebo );
+		if( model.texture ) GLState::deleteTextures( 1, &model.texture );
+	}
+	models_.clear();
+}
+
+unsigned int RenderModelCache::numLoading() const
+{
+	unsigned int count = 0;
+	for( auto& entry : models_ )
+	{
+		if( entry.second->state == State::LoadingModel || entry.second->state == State::LoadingTexture ) count++;
+	}
+	return count;
+}
+
+unsigned int RenderModelCache::numReady() const
+{
+	unsigned int count = 0;
+	for( auto& entry : models_ )
+	{
+		if( entry.second->state == State::Ready ) count++;
+	}
+	return count;
+}
+
+void RenderModelCache::create_gl_objects( Model& model )
+{
+	const vr::RenderModel_t* vr_model = model.vr_model;
+	const vr::RenderModel_TextureMap_t* vr_texture = model.vr_texture;
+
+	glGenVertexArrays( 1, &model.vao );
+	GLState::bindVertexArray( model.vao );
+
+	glGenBuffers( 1, &model.ebo );
+	GLState::bindBuffer( GL_ELEMENT_ARRAY_BUFFER, model.ebo );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( uint16_t ) * vr_model->unTriangleCount * 3, vr_model->rIndexData, GL_STATIC_DRAW );
+	model.num_indices = vr_model->unTriangleCount * 3;
+
+	glGenBuffers( 1, &model.vbo );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, model.vbo );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( vr::RenderModel_Vertex_t ) * vr_model->unVertexCount, vr_model->rVertexData, GL_STATIC_DRAW );
+
+	// Identify the components in the vertex buffer
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( vr::RenderModel_Vertex_t ), (void *)offsetof( vr::RenderModel_Vertex_t, vPosition ) );
+	glEnableVertexAttribArray( 1 );
+	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( vr::RenderModel_Vertex_t ), (void *)offsetof( vr::RenderModel_Vertex_t, vNormal ) );
+	glEnableVertexAttribArray( 2 );
+	glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( vr::RenderModel_Vertex_t ), (void *)offsetof( vr::RenderModel_Vertex_t, rfTextureCoord ) );
+
+	GLState::bindVertexArray( 0 );
+
+	glGenTextures( 1, &model.texture );
+	GLState::bindTexture( GL_TEXTURE_2D, model.texture );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, vr_texture->unWidth, vr_texture->unHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, vr_texture->rubTextureMapData );
+	glGenerateMipmap( GL_TEXTURE_2D );
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+
+	GLfloat fLargest;
+	glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest );
+	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest );
+
+	std::cout << "Render model '" << model.name << "' OK " << vr_model->unTriangleCount << " triangles" << std::endl;
+}
+
+void RenderModelCache::free_vr_data( Model& model )
+{
+	if( model.vr_model )
+	{
+		vr::VRRenderModels()->FreeRenderModel( model.vr_model );
+		model.vr_model = nullptr;
+	}
+
+	if( model.vr_texture )
+	{
+		vr::VRRenderModels()->FreeTexture( model.vr_texture );
+		model.vr_texture = nullptr;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <openvr.h>
+#include <string>
+#include <map>
+#include <memory>
+
+// Loads OpenVR render models without ever waiting on them. Each model moves through a few states,
+// and update() is called once a frame to move every model along as far as it can without blocking:
+// asking OpenVR for the mesh, then for its texture, then making the GL objects. At most one model is
+// turned into GL objects a frame, since the texture upload and mipmaps are the only part that costs.
+//
+// Models are kept by name for as long as the cache lives, so both controllers and any controller
+// that is switched off and on again all draw from the same buffers and texture.
+
+class RenderModelCache
+{
+public:
+	enum class State { LoadingModel, LoadingTexture, Ready, Failed };
+
+	struct Model {
+		std::string name;
+		State state = State::LoadingModel;
+
+		GLuint vao          = 0;
+		GLuint vbo          = 0;
+		GLuint ebo          = 0;
+		GLuint texture      = 0;
+		GLsizei num_indices = 0;
+
+		// Only held while loading, handed back to OpenVR once the GL objects are made
+		vr::RenderModel_t* vr_model = nullptr;
+		vr::RenderModel_TextureMap_t* vr_texture = nullptr;
+	};
+
+	RenderModelCache();
+	~RenderModelCache();
+
+	// Returns the model with this name, starting to load it if it hasn't been asked for yet. A model
+	// that failed before is tried again. The pointer stays valid until shutdown()
+	const Model* request( const std::string& name );
+	// Moves every model that is still loading along, call once a frame
+	void update();
+	// Deletes every model's GL objects, needs the GL context
+	void shutdown();
+
+	// Getters
+	unsigned int numLoading() const;
+	unsigned int numReady() const;
+
+private:
+	// Makes the VAO, buffers and texture, then frees the OpenVR copies
+	void create_gl_objects( Model& model );
+	void free_vr_data( Model& model );
+
+	std::map<std::string, std::unique_ptr<Model>> models_;
+};
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include <gtc/type_ptr.hpp>
+#include <algorithm>
+
+RenderQueue::RenderQueue()
+{}
+
+RenderQueue::~RenderQueue()
+{}
+
+void RenderQueue::clear()
+{
+	items_.clear();
+
+	last_frame_stats_ = frame_stats_;
+	frame_stats_ = Stats();
+}
+
+void RenderQueue::submit( const DrawItem& item )
+{
+	if( item.count > 0 && item.program != 0 )
+	{
+		items_.push_back( item );
+	}
+}
+
+uint64_t RenderQueue::makeKey( const DrawItem& item, const glm::mat4& view ) const
+{
+	// Front to back within the same state, so the depth test rejects as much as possible
+	glm::vec4 view_pos = view * item.model * glm::vec4( item.centre, 1.0f );
+	float depth = glm::clamp( -view_pos.z / max_sort_depth_, 0.0f, 1.0f );
+
+	// | layer 8 | program 12 | vao 12 | texture 8 | depth 24 |
+	uint64_t key = 0;
+	key |= (uint64_t)(item.layer)              << 56;
+	key |= (uint64_t)(item.program & 0xFFF)    << 44;
+	key |= (uint64_t)(item.vao & 0xFFF)        << 32;
+	key |= (uint64_t)(item.texture & 0xFF)     << 24;
+	key |= (uint64_t)(depth * 0xFFFFFF);
+	return key;
+}
+
+void RenderQueue::execute( const glm::mat4& view )
+{
+	order_.clear();
+	for( size_t i = 0; i < items_.size(); i++ )
+	{
+		order_.push_back( SortEntry{ sorting_ ? makeKey( items_[i], view ) : 0, (uint32_t)i } );
+	}
+
+	if( sorting_ )
+	{
+		std::sort( order_.begin(), order_.end(), []( const SortEntry& a, const SortEntry& b ) { return a.key < b.key; } );
+	}
+
+	// The state cache drops any bind that would not change anything
+	for( const SortEntry& entry : order_ )
+	{
+		const DrawItem& item = items_[entry.index];
+
+		if( GLState::useProgram( item.program ) ) frame_stats_.program_binds++;
+		if( GLState::bindVertexArray( item.vao ) ) frame_stats_.vao_binds++;
+		if( item.texture != 0 ) GLState::bindTexture( GL_TEXTURE_2D, item.texture );
+
+		if( item.model_location >= 0 )
+		{
+			glUniformMatrix4fv( item.model_location, 1, GL_FALSE, glm::value_ptr( item.model ) );
+		}
+
+		if( item.index_type != GL_NONE )
+		{
+			if( item.instances > 0 )
+				glDrawElementsInstanced( item.primitive, item.count, item.index_type, (const void *)(intptr_t)item.first, item.instances );
+			else
+				glDrawElements( item.primitive, item.count, item.index_type, (const void *)(intptr_t)item.first );
+		}
+		else
+		{
+			if( item.instances > 0 )
+				glDrawArraysInstanced( item.primitive, item.first, item.count, item.instances );
+			else if( item.draw_count > 0 )
+				glMultiDrawArrays( item.primitive, item.firsts, item.counts, item.draw_count );
+			else
+				glDrawArrays( item.primitive, item.first, item.count );
+		}
+		frame_stats_.draw_calls++;
+	}
+}
\ No newline at end of file
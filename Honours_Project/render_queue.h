@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <vector>
+#include <cstdint>
+
+// Everything that needs drawing is submitted once per frame as a DrawItem. Each eye then sorts
+// the items by state and depth and draws them through GLState, which skips any program or VAO
+// bind that would not change anything. The view and projection are expected to already be in the camera uniforms.
+
+struct DrawItem
+{
+	GLuint program       = 0;
+	GLuint vao           = 0;
+	GLuint texture       = 0;          // Bound to GL_TEXTURE_2D when not 0
+	GLenum primitive     = GL_TRIANGLES;
+	GLint first          = 0;          // First vertex, or the byte offset into the element buffer for indexed draws
+	GLsizei count        = 0;
+	GLsizei instances    = 0;          // Greater than 0 for an instanced draw
+	GLenum index_type    = GL_NONE;    // Set to the index type for indexed draws
+	const GLint* firsts  = nullptr;    // With 'counts', draws 'draw_count' ranges of vertices in one call instead of first and count.
+	const GLsizei* counts = nullptr;   // The arrays must stay valid until the frame has been drawn, count should be the total
+	GLsizei draw_count   = 0;
+	GLint model_location = -1;         // The model matrix is only sent if this is a valid location
+	glm::mat4 model;
+	glm::vec3 centre;                  // Position in model space used for depth sorting
+	unsigned char layer  = 0;          // Lower layers are always drawn before higher ones
+};
+
+class RenderQueue
+{
+public:
+	struct Stats {
+		unsigned int draw_calls    = 0;
+		unsigned int program_binds = 0;
+		unsigned int vao_binds     = 0;
+	};
+
+	RenderQueue();
+	~RenderQueue();
+
+	// Call at the start of each frame, before anything is submitted
+	void clear();
+	void submit( const DrawItem& item );
+
+	// Sort for this eye and draw everything that was submitted
+	void execute( const glm::mat4& view );
+
+	// Setters
+	void setSorting( bool sorting ) { sorting_ = sorting; }
+
+	// Getters
+	bool sorting() const { return sorting_; }
+	size_t numItems() const { return items_.size(); }
+	const Stats& lastFrameStats() const { return last_frame_stats_; }
+
+protected:
+	struct SortEntry {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	uint64_t makeKey( const DrawItem& item, const glm::mat4& view ) const;
+
+	bool sorting_ = true;
+	float max_sort_depth_ = 100.0f;
+
+	std::vector<DrawItem> items_;
+	std::vector<SortEntry> order_;
+
+	Stats frame_stats_;
+	Stats last_frame_stats_;
+};
\ No newline at end of file
@@ -1,17 +1,14 @@
 #include "scene.h"
 #include "window.h"
 #include "vr_system.h"
+#include "debug_draw.h"
 #include "imgui\imgui.h"
 
 #include <gtc/type_ptr.hpp>
 #include <vector>
 #include <iostream>
-#include <iomanip>
-#include <sstream>
-#include <fstream>
 #include <functional>
 #include <algorithm>
-#include <ctime>
 
 Scene::Scene() {}
 
@@ -22,19 +19,15 @@ bool Scene::init()
 	window_ = Window::get();
 	vr_system_ = VRSystem::get();
 
-	shader_.loadVertexSourceFile( "colour_shader_vs.glsl" );
+	shader_.loadVertexSourceFile( "point_cloud_shader_vs.glsl" );
 	shader_.loadFragmentSourceFile( "colour_shader_fs.glsl" );
 	shader_.init();
-
-	modl_matrix_location_ = shader_.getUniformLocation( "model" );
-	view_matrix_location_ = shader_.getUniformLocation( "view" );
-	proj_matrix_location_ = shader_.getUniformLocation( "projection" );
 	
 	// Play sounds during testing to help the user
 	//init_audio();
 
-	// Give the user some ground to stand on
-	init_floor();
+	// All spheres are drawn together
+	sphere_renderer_.init();
 
 	// Init the point cloud
 	point_cloud_.setActiveShader( &shader_ );
@@ -45,6 +38,10 @@ bool Scene::init()
 	//init_testing();
 	//stop_testing();
 
+	// The targets are fixed from here on
+	simulation_.setColours( default_sphere_colour_, highlight_sphere_colour_ );
+	simulation_.start();
+
 	return true;
 }
 
@@ -52,56 +49,39 @@ void Scene::shutdown()
 {
 	//shutdown_audio();
 
-	glDeleteVertexArrays( 1, &floor_vao_ );
-	floor_vao_ = 0;
+	simulation_.stop();
+	sphere_renderer_.shutdown();
 }
 
 void Scene::update( float dt )
 {
-	for( auto& s : spheres_ )
-	{
-		// Parent all spheres to the point cloud
-		s->setParentTransform( point_cloud_.combinedOffsetMatrix() );
+	// Moves the spheres along with it if the point cloud has changed
+	point_cloud_.update( dt );
 
-		// Highlight those touching the cursor
-		if( s->isTouching( vr_system_->pointerTool()->sphere() ) )
-		{
-			s->setColour( highlight_sphere_colour_ );
-		} else {
-			s->setColour( default_sphere_colour_ );
-		}
+	// Queries are made in the point cloud's space, only needs updating when it moves
+	if( point_cloud_.node()->version() != cloud_version_ )
+	{
+		cloud_inverse_ = glm::inverse( point_cloud_.node()->world() );
+		cloud_version_ = point_cloud_.node()->version();
 	}
 
-	if( test_mode_ )
+	// Hand the simulation this frame's pointer, it works in the point cloud's space where the targets never move
+	const Sphere& pointer = vr_system_->pointerTool()->sphere();
+	SceneSimulation::Input input;
+	input.frame = ++frame_;
+	input.pointer = glm::vec3( cloud_inverse_ * glm::vec4( pointer.worldPosition(), 1.0f ) );
+	input.pointer_radius = pointer.radius();
+	input.pointer_active = pointer.active();
+	simulation_.publish( input );
+
+	// Draw from the newest snapshot, or the last one again if the simulation hasn't made another since
+	if( simulation_.update() )
 	{
-		// Check if the pointer is touching the next sphere in the list
-		if( spheres_[sphere_indecies_.back()]->isTouching( vr_system_->pointerTool()->sphere() ) )
+		const SceneSimulation::Snapshot& snapshot = simulation_.snapshot();
+		for( size_t i = 0; i < spheres_.size() && i < snapshot.targets.size(); i++ )
 		{
-			// If it's the first sphere, we can start the timer
-			if( spheres_.size() == sphere_indecies_.size() )
-			{
-				start_timer();
-			}
-
-			// Print out which sphere was hit
-			Uint32 current_time = SDL_GetTicks();
-			std::cout << "\t: " << sphere_indecies_.back() << " took "
-				<< (current_time - previous_time_) / 1000.0f << " (s)" << std::endl;
-			previous_time_ = current_time;
-
-			// Deactivate the sphere that was hit
-			spheres_[sphere_indecies_.back()]->setActive( false );
-			sphere_indecies_.pop_back();
-
-			// Activate the next sphere
-			if( sphere_indecies_.empty() )
-			{
-				stop_testing();
-			}
-			else
-			{
-				spheres_[sphere_indecies_.back()]->setActive( true );
-			}
+			spheres_[i]->setColour( snapshot.targets[i].colour );
+			spheres_[i]->setActive( snapshot.targets[i].active );
 		}
 	}
 
@@ -142,11 +122,17 @@ void Scene::update( float dt )
 	}
 	*/
 
-	// Update all the spheres
+	// Gather the spheres into one instance buffer so they can be drawn together
+	sphere_renderer_.begin( (GLsizei)spheres_.size() + 1 );
 	for( auto& s : spheres_ )
 	{
-		s->update( dt );
+		sphere_renderer_.addSphere( *s );
 	}
+	if( vr_system_->pointerTool()->isInitialised() )
+	{
+		sphere_renderer_.addSphere( vr_system_->pointerTool()->sphere() );
+	}
+	sphere_renderer_.end();
 
 	/*
 	// Helper tool for positioning spheres
@@ -190,113 +176,39 @@ void Scene::update( float dt )
 	*/
 }
 
-void Scene::render( glm::mat4 view, glm::mat4 projection )
+void Scene::submit( RenderQueue& queue )
 {
-	// Parent all spheres to the point cloud
-	for( auto& sphere : spheres_ )
-	{
-		sphere->render( view, projection );
-	}
+	// Draw the targets and the pointer sphere in one go
+	sphere_renderer_.submit( queue );
 
-	render_floor( view, projection );
-	point_cloud_.render( view, projection );
+	// Give the user some ground to stand on
+	draw_floor();
+	point_cloud_.submit( queue );
 }
 
-void Scene::init_floor()
+void Scene::draw_floor()
 {
-	// Create circular floor grid
-	{
-		std::vector<GLfloat> verts;
-
-		int rings = 10;
-		float max_radius = 10.0f;
-
-		int segments = 60;
-		float inc = (3.1415f*2.0f) / (float)segments;
+	// Circular floor grid, fading out towards the edge
+	int rings = 10;
+	float max_radius = 10.0f;
+	int segments = 60;
 
-		for( int r = 0; r < rings; r++ )
-		{
-			for( int i = 0; i < segments; i++ )
-			{
-				verts.push_back( std::sin( i * inc ) * max_radius * (r / float( rings )) );
-				verts.push_back( 0.0f );
-				verts.push_back( std::cos( i * inc ) * max_radius * (r / float( rings )) );
-				verts.push_back( (1.0f - (r / float( rings ))) * 0.0f );
-				verts.push_back( (1.0f - (r / float( rings ))) * 0.8f );
-				verts.push_back( (1.0f - (r / float( rings ))) * 0.9f );
-
-				if( i == segments - 1 )
-				{
-					verts.push_back( std::sin( 0.0f ) * max_radius * (r / float( rings )) );
-					verts.push_back( 0.0f );
-					verts.push_back( std::cos( 0.0f ) * max_radius * (r / float( rings )) );
-				}
-				else {
-					verts.push_back( std::sin( (i + 1) * inc ) * max_radius * (r / float( rings )) );
-					verts.push_back( 0.0f );
-					verts.push_back( std::cos( (i + 1) * inc ) * max_radius * (r / float( rings )) );
-				}
-
-				verts.push_back( (1.0f - (r / float( rings ))) * 0.0f );
-				verts.push_back( (1.0f - (r / float( rings ))) * 0.8f );
-				verts.push_back( (1.0f - (r / float( rings ))) * 0.9f );
-			}
-		}
-
-		// create triangle at feet
-		verts.push_back( 0.0f ); verts.push_back( 0.0f ); verts.push_back( -0.7f );
-		verts.push_back( 0.2f ); verts.push_back( 0.5f ); verts.push_back( 0.2f );
-
-		verts.push_back( 0.5f ); verts.push_back( 0.0f ); verts.push_back( 0.5f );
-		verts.push_back( 0.4f ); verts.push_back( 0.2f ); verts.push_back( 0.4f );
-
-		verts.push_back( 0.5f ); verts.push_back( 0.0f ); verts.push_back( 0.5f );
-		verts.push_back( 0.4f ); verts.push_back( 0.2f ); verts.push_back( 0.4f );
-
-		verts.push_back( -0.5f ); verts.push_back( 0.0f ); verts.push_back( 0.5f );
-		verts.push_back( 0.4f ); verts.push_back( 0.2f ); verts.push_back( 0.4f );
-
-		verts.push_back( -0.5f ); verts.push_back( 0.0f ); verts.push_back( 0.5f );
-		verts.push_back( 0.4f ); verts.push_back( 0.2f ); verts.push_back( 0.4f );
-
-		verts.push_back( 0.0f ); verts.push_back( 0.0f ); verts.push_back( -0.7f );
-		verts.push_back( 0.2f ); verts.push_back( 0.5f ); verts.push_back( 0.2f );
-
-		GLuint vbo;
-		glGenVertexArrays( 1, &floor_vao_ );
-		glBindVertexArray( floor_vao_ );
-		glGenBuffers( 1, &vbo );
-		glBindBuffer( GL_ARRAY_BUFFER, vbo );
-		glBufferData( GL_ARRAY_BUFFER, sizeof( verts[0] ) * verts.size(), verts.data(), GL_STATIC_DRAW );
-		num_floor_verts_ = (GLsizei)verts.size() / 6;
-
-		GLuint stride = 2 * 3 * sizeof( GLfloat );
-		GLuint offset = 0;
-
-		GLint posAttrib = shader_.getAttribLocation( "vPosition" );
-		glEnableVertexAttribArray( posAttrib );
-		glVertexAttribPointer( posAttrib, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
-
-		offset += sizeof( GLfloat ) * 3;
-		GLint colAttrib = shader_.getAttribLocation( "vColour" );
-		glEnableVertexAttribArray( colAttrib );
-		glVertexAttribPointer( colAttrib, 3, GL_FLOAT, GL_FALSE, stride, (const void *)offset );
+	for( int r = 1; r < rings; r++ )
+	{
+		float t = r / float( rings );
+		glm::vec3 colour( 0.0f, (1.0f - t) * 0.8f, (1.0f - t) * 0.9f );
+		DebugDraw::circle( glm::vec3( 0.0f ), max_radius * t, glm::vec3( 0.0f, 1.0f, 0.0f ), colour, glm::mat4(), segments );
 	}
-}
-
-void Scene::render_floor( glm::mat4 view, glm::mat4 projection )
-{
-	shader_.bind();
 
-	model_mat_ = glm::mat4( 1.0 );
-
-	// Send matricies
-	glUniformMatrix4fv( modl_matrix_location_, 1, GL_FALSE, glm::value_ptr( model_mat_ ) );
-	glUniformMatrix4fv( view_matrix_location_, 1, GL_FALSE, glm::value_ptr( view ) );
-	glUniformMatrix4fv( proj_matrix_location_, 1, GL_FALSE, glm::value_ptr( projection ) );
-
-	glBindVertexArray( floor_vao_ );
-	glDrawArrays( GL_LINES, 0, num_floor_verts_ );
+	// Triangle at feet
+	glm::vec3 tip( 0.0f, 0.0f, -0.7f );
+	glm::vec3 right( 0.5f, 0.0f, 0.5f );
+	glm::vec3 left( -0.5f, 0.0f, 0.5f );
+	glm::vec3 tip_colour( 0.2f, 0.5f, 0.2f );
+	glm::vec3 base_colour( 0.4f, 0.2f, 0.4f );
+	DebugDraw::line( tip, right, tip_colour, base_colour );
+	DebugDraw::line( right, left, base_colour );
+	DebugDraw::line( left, tip, base_colour, tip_colour );
 }
 
 void Scene::init_bunny()
@@ -305,6 +217,7 @@ void Scene::init_bunny()
 
 	// Place spheres
 	spheres_.clear();
+	simulation_.clearTargets();
 	addSphere( { -0.313105,  0.46811,   0.189758 } );
 	addSphere( { -0.0528103, 0.703198, -0.0966756 } );
 	addSphere( { -0.25695,   0.689998, -0.221692 } );
@@ -331,119 +244,10 @@ void Scene::init_dragon()
 void Scene::addSphere( glm::vec3 position )
 {
 	spheres_.push_back( std::unique_ptr<Sphere>( new Sphere( position ) ) );
-	spheres_.back()->setParentTransform( point_cloud_.combinedOffsetMatrix() );
-	spheres_.back()->setShader( &shader_ );
+	spheres_.back()->setParent( point_cloud_.node() );
 	spheres_.back()->setRadius( 0.01f );
-	spheres_.back()->init();
-}
 
-void Scene::init_testing()
-{
-	if( test_mode_ )
-	{
-		std::cout << "WARNING: testing was cancelled early!" << std::endl;
-		start_time_ = SDL_GetTicks();
-		stop_testing();
-	}
-
-	// Populate sphere indecies
-	sphere_indecies_.clear();
-	for( size_t i = 0; i < spheres_.size(); i++ )
-	{
-		sphere_indecies_.push_back( i );
-	}
-
-	// Then randomize the order
-	std::random_shuffle( sphere_indecies_.begin(), sphere_indecies_.end() );
-
-	if( !spheres_.empty() )
-	{
-		// Deactivate all the spheres
-		for( auto& s : spheres_ )
-		{
-			s->setActive( false );
-		}
-
-		// Except one
-		spheres_[sphere_indecies_.back()]->setActive( true );
-	}
-
-	test_mode_ = true;
-}
-
-void Scene::start_timer()
-{
-	times_.clear();
-	
-	start_time_ = SDL_GetTicks();
-	previous_time_ = start_time_;
-	
-	times_.push_back( start_time_ );
-
-	std::cout << "[ Beginning testing ]" << std::endl;
-}
-
-void Scene::stop_testing()
-{
-	end_time_ = SDL_GetTicks();
-	test_mode_ = false;
-	times_.push_back( end_time_ );
-
-	Uint32 time_taken = end_time_ - start_time_;
-
-	std::cout << "[ Done testing ]" << std::endl;
-	std::cout << "\tTotal time taken : " << time_taken/1000.0f << " (s)" << std::endl;
-
-	for( auto& sphere : spheres_ )
-	{
-		sphere->setActive( true );
-	}
-
-	// Format the current time as the name for the file
-	time_t t = std::time( nullptr );
-	std::tm tm;
-	localtime_s( &tm, &t );
-
-	std::ostringstream oss;
-	oss << std::put_time( &tm, "%Y-%m-%d_%H:%M:%S" ) << ".txt";
-	std::string filename = oss.str();
-
-	std::ofstream logfile(filename, std::ios::ate );
-
-	// Dump the times in a log file
-	logfile << "Started at: " << times_[0] << std::endl;
-
-	for( int i = 1; i < times_.size() - 1; i++ )
-	{
-		logfile << i << ":\t" << times_[i] << std::endl;
-	}
-
-	logfile << "Finished at: " << times_.back() << std::endl;
-	logfile << "Time taken: " << (times_.back() - times_.front()) / 1000.0f << " (s)" << std::endl;
-
-	logfile.close();
-	std::cout << "Written log: " << filename << std::endl;
-}
-
-void Scene::toggle_spheres()
-{
-	if( !test_mode_ )
-	{
-		if( !spheres_.empty() && spheres_[0]->active() )
-		{
-			for( auto& s : spheres_ )
-			{
-				s->setActive( false );
-			}
-		}
-		else
-		{
-			for( auto& s : spheres_ )
-			{
-				s->setActive( true );
-			}
-		}
-	}
+	simulation_.addTarget( position, spheres_.back()->radius() );
 }
 
  void Scene::audio_callback( void* userdata, Uint8* stream, int length )
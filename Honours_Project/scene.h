@@ -9,6 +9,9 @@
 #include "shader_program.h"
 #include "point_cloud.h"
 #include "sphere.h"
+#include "sphere_renderer.h"
+#include "render_queue.h"
+#include "scene_simulation.h"
 
 // Forward declarations
 class Window;
@@ -23,16 +26,20 @@ public:
 	bool init();
 	void shutdown();
 	void update( float dt );
-	void render( glm::mat4 view, glm::mat4 projection );
+	void submit( RenderQueue& queue );
 
-	void init_testing();
-	void stop_testing();
+	// Testing runs on the simulation thread, these take effect on its next tick
+	void init_testing() { simulation_.startTesting(); }
+	void stop_testing() { simulation_.stopTesting(); }
 
 	// Hide spheres if testing is disabled
-	void toggle_spheres();
+	void toggle_spheres() { simulation_.toggleTargets(); }
 
 	// Getters
 	PointCloud* pointCloud() { return &point_cloud_; }
+	size_t numTargets() const { return spheres_.size(); }
+	unsigned int targetTests() const { return simulation_.snapshot().target_tests; }
+	const SceneSimulation& simulation() const { return simulation_; }
 
 protected:
 	Window* window_                    = nullptr;
@@ -41,36 +48,26 @@ protected:
 
 	glm::vec3 default_sphere_colour_   = { 1.0f, 0.0f, 1.0f };
 	glm::vec3 highlight_sphere_colour_ = { 1.0f, 1.0f, 1.0f };
+	// Only placement and radius live here, their colour and active flag come from the simulation's snapshots
 	std::vector<std::unique_ptr<Sphere>> spheres_;
+	SphereRenderer sphere_renderer_;
 
 	void addSphere( glm::vec3 position );
 
+	// Highlighting and testing, the pointer is passed in the point cloud's space so it lines up with the targets
+	SceneSimulation simulation_;
+	glm::mat4 cloud_inverse_;
+	unsigned int cloud_version_     = ~0u;
+	uint64_t frame_                 = 0;
+
 	ShaderProgram shader_;
-	GLint modl_matrix_location_ = 0;
-	GLint view_matrix_location_ = 0;
-	GLint proj_matrix_location_ = 0;
-	glm::mat4 model_mat_;
-	
-	// Testing
-	void start_timer();
-
-	bool test_mode_       = false;
-	Uint32 start_time_    = 0;
-	Uint32 end_time_      = 0;
-	Uint32 previous_time_ = 0;
-	std::vector<Uint32> times_;
-	std::vector<size_t> sphere_indecies_;
 
 	// Scene
-	void init_floor();
-	void render_floor( glm::mat4 view, glm::mat4 projection );
+	void draw_floor();
 
 	void init_bunny();
 	void init_dragon();
 
-	GLuint floor_vao_        = 0;
-	GLsizei num_floor_verts_ = 0;
-
 	// Sounds
 	void init_audio();
 	void shutdown_audio();
@@ -0,0 +1,287 @@
+#include "scene_simulation.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+SceneSimulation::SceneSimulation()
+{}
+
+SceneSimulation::~SceneSimulation()
+{
+	stop();
+}
+
+void SceneSimulation::clearTargets()
+{
+	if( running_ )
+	{
+		std::cout << "ERROR: targets can't be changed while the simulation is running" << std::endl;
+		return;
+	}
+
+	targets_.clear();
+	target_hash_.clear();
+	max_target_radius_ = 0.0f;
+}
+
+void SceneSimulation::addTarget( const glm::vec3& position, float radius )
+{
+	if( running_ )
+	{
+		std::cout << "ERROR: targets can't be changed while the simulation is running" << std::endl;
+		return;
+	}
+
+	targets_.push_back( Target{ position, radius } );
+	target_hash_.insert( (unsigned int)(targets_.size() - 1), position );
+	max_target_radius_ = std::max( max_target_radius_, radius );
+}
+
+bool SceneSimulation::start()
+{
+	if( running_ ) return false;
+
+	// Every target starts out active and not highlighted
+	TargetState state;
+	state.colour = default_colour_;
+	states_.assign( targets_.size(), state );
+	highlighted_.clear();
+	test_mode_ = false;
+
+	running_ = true;
+	thread_ = std::thread( &SceneSimulation::run, this );
+	return true;
+}
+
+void SceneSimulation::stop()
+{
+	running_ = false;
+	if( thread_.joinable() ) thread_.join();
+}
+
+void SceneSimulation::publish( const Input& input )
+{
+	inputs_.back() = input;
+	inputs_.publish();
+}
+
+void SceneSimulation::run()
+{
+	const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( 1.0 / tick_hz_ ) );
+	auto next_tick = std::chrono::steady_clock::now();
+	auto rate_start = next_tick;
+	unsigned int ticks = 0;
+
+	while( running_ )
+	{
+		// Only the newest input matters, any the main thread published in between are skipped
+		inputs_.update();
+		tick( inputs_.front() );
+		ticks++;
+
+		auto now = std::chrono::steady_clock::now();
+		if( now - rate_start >= std::chrono::seconds( 1 ) )
+		{
+			ticks_per_second_ = (unsigned int)(ticks / std::chrono::duration<double>( now - rate_start ).count());
+			ticks = 0;
+			rate_start = now;
+		}
+
+		// A tick that ran long is not caught up on, the next one just starts straight away
+		next_tick = std::max( next_tick + interval, now );
+		std::this_thread::sleep_until( next_tick );
+	}
+}
+
+void SceneSimulation::tick( const Input& input )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Command command;
+	while( commands_.pop( command ) )
+	{
+		if( command == Command::StartTesting ) start_testing();
+		else if( command == Command::StopTesting && test_mode_ ) stop_testing();
+		else if( command == Command::ToggleTargets ) toggle_targets();
+	}
+
+	// Put back anything highlighted last tick, then highlight those touching the pointer
+	for( unsigned int i : highlighted_ )
+	{
+		states_[i].colour = default_colour_;
+	}
+	highlighted_.clear();
+	target_tests_ = 0;
+
+	highlight_touching( input );
+
+	if( test_mode_ && !sphere_indecies_.empty() )
+	{
+		// Check if the pointer is touching the next sphere in the list
+		size_t next = sphere_indecies_.back();
+		bool touching = input.pointer_active && states_[next].active &&
+			glm::length( targets_[next].position - input.pointer ) <= targets_[next].radius + input.pointer_radius;
+		if( touching )
+		{
+			// If it's the first sphere, we can start the timer
+			if( targets_.size() == sphere_indecies_.size() )
+			{
+				start_timer();
+			}
+
+			// Print out which sphere was hit
+			Uint32 current_time = SDL_GetTicks();
+			std::cout << "\t: " << next << " took "
+				<< (current_time - previous_time_) / 1000.0f << " (s)" << std::endl;
+			previous_time_ = current_time;
+
+			// Deactivate the sphere that was hit
+			states_[next].active = false;
+			sphere_indecies_.pop_back();
+
+			// Activate the next sphere
+			if( sphere_indecies_.empty() )
+			{
+				stop_testing();
+			}
+			else
+			{
+				states_[sphere_indecies_.back()].active = true;
+			}
+		}
+	}
+
+	// The main thread may still be drawing from the other two copies, this one is all ours
+	Snapshot& snapshot = snapshots_.back();
+	snapshot.tick = ++ticks_;
+	snapshot.input_frame = input.frame;
+	snapshot.targets.assign( states_.begin(), states_.end() );
+	snapshot.test_mode = test_mode_;
+	snapshot.targets_left = (unsigned int)sphere_indecies_.size();
+	snapshot.target_tests = target_tests_;
+	snapshot.tick_ms = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+	snapshots_.publish();
+}
+
+void SceneSimulation::highlight_touching( const Input& input )
+{
+	if( !input.pointer_active ) return;
+
+	candidates_.clear();
+	target_hash_.query( input.pointer, input.pointer_radius + max_target_radius_, candidates_ );
+
+	for( unsigned int i : candidates_ )
+	{
+		target_tests_++;
+		if( states_[i].active && glm::length( targets_[i].position - input.pointer ) <= targets_[i].radius + input.pointer_radius )
+		{
+			states_[i].colour = highlight_colour_;
+			highlighted_.push_back( i );
+		}
+	}
+}
+
+void SceneSimulation::start_testing()
+{
+	if( test_mode_ )
+	{
+		std::cout << "WARNING: testing was cancelled early!" << std::endl;
+		start_time_ = SDL_GetTicks();
+		stop_testing();
+	}
+
+	// Populate sphere indecies
+	sphere_indecies_.clear();
+	for( size_t i = 0; i < targets_.size(); i++ )
+	{
+		sphere_indecies_.push_back( i );
+	}
+
+	// Then randomize the order
+	std::random_shuffle( sphere_indecies_.begin(), sphere_indecies_.end() );
+
+	if( !targets_.empty() )
+	{
+		// Deactivate all the spheres
+		for( auto& state : states_ )
+		{
+			state.active = false;
+		}
+
+		// Except one
+		states_[sphere_indecies_.back()].active = true;
+	}
+
+	test_mode_ = true;
+}
+
+void SceneSimulation::start_timer()
+{
+	times_.clear();
+
+	start_time_ = SDL_GetTicks();
+	previous_time_ = start_time_;
+
+	times_.push_back( start_time_ );
+
+	std::cout << "[ Beginning testing ]" << std::endl;
+}
+
+void SceneSimulation::stop_testing()
+{
+	end_time_ = SDL_GetTicks();
+	test_mode_ = false;
+	sphere_indecies_.clear();
+	times_.push_back( end_time_ );
+
+	Uint32 time_taken = end_time_ - start_time_;
+
+	std::cout << "[ Done testing ]" << std::endl;
+	std::cout << "\tTotal time taken : " << time_taken/1000.0f << " (s)" << std::endl;
+
+	for( auto& state : states_ )
+	{
+		state.active = true;
+	}
+
+	// Format the current time as the name for the file, the log is written here so the frame never waits on the disk
+	time_t t = std::time( nullptr );
+	std::tm tm;
+	localtime_s( &tm, &t );
+
+	std::ostringstream oss;
+	oss << std::put_time( &tm, "%Y-%m-%d_%H:%M:%S" ) << ".txt";
+	std::string filename = oss.str();
+
+	std::ofstream logfile(filename, std::ios::ate );
+
+	// Dump the times in a log file
+	logfile << "Started at: " << times_[0] << std::endl;
+
+	for( size_t i = 1; i < times_.size() - 1; i++ )
+	{
+		logfile << i << ":\t" << times_[i] << std::endl;
+	}
+
+	logfile << "Finished at: " << times_.back() << std::endl;
+	logfile << "Time taken: " << (times_.back() - times_.front()) / 1000.0f << " (s)" << std::endl;
+
+	logfile.close();
+	std::cout << "Written log: " << filename << std::endl;
+}
+
+void SceneSimulation::toggle_targets()
+{
+	// Hide spheres if testing is disabled
+	if( test_mode_ ) return;
+
+	bool active = !(!states_.empty() && states_[0].active);
+	for( auto& state : states_ )
+	{
+		state.active = active;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <glm.hpp>
+#include <SDL.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "spatial_hash.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
+// Runs the scene's logic on a thread of its own: which targets the pointer touches and the timed
+// test that walks the user through them. The main thread publishes where the pointer is each frame
+// and gets back immutable snapshots of every target's colour and active flag, both through triple
+// buffers, so neither side ever waits on the other and a slow tick never holds up a frame.
+//
+// Everything is in the point cloud's space, where the targets sit still however the cloud is moved.
+
+class SceneSimulation
+{
+public:
+	// Published by the main thread every frame
+	struct Input {
+		uint64_t frame = 0;
+		glm::vec3 pointer;           // Point cloud space
+		float pointer_radius = 0.0f;
+		bool pointer_active = false;
+	};
+
+	struct TargetState {
+		glm::vec3 colour;
+		bool active = true;
+	};
+
+	// Everything the main thread needs to draw the scene, never changed once published
+	struct Snapshot {
+		uint64_t tick = 0;
+		uint64_t input_frame = 0;    // The frame whose input this was made from
+		std::vector<TargetState> targets;
+		bool test_mode = false;
+		unsigned int targets_left = 0;
+		unsigned int target_tests = 0;
+		double tick_ms = 0.0;        // How long the simulation took to make this
+	};
+
+	SceneSimulation();
+	~SceneSimulation();
+
+	// Targets can only be changed while stopped
+	void clearTargets();
+	void addTarget( const glm::vec3& position, float radius );
+
+	bool start();
+	void stop();
+
+	// Main thread only
+	void publish( const Input& input );
+	// Main thread only, swaps in the newest snapshot if there is one and returns true if it did
+	bool update() { return snapshots_.update(); }
+	const Snapshot& snapshot() const { return snapshots_.front(); }
+
+	// Main thread only, carried out at the start of the next tick
+	void startTesting() { commands_.push( Command::StartTesting ); }
+	void stopTesting() { commands_.push( Command::StopTesting ); }
+	void toggleTargets() { commands_.push( Command::ToggleTargets ); }
+
+	// Setters, only while stopped
+	void setTickRate( float hz ) { tick_hz_ = hz; }
+	void setColours( const glm::vec3& default_colour, const glm::vec3& highlight_colour ) { default_colour_ = default_colour; highlight_colour_ = highlight_colour; }
+
+	// Getters
+	bool isRunning() const { return running_; }
+	size_t numTargets() const { return targets_.size(); }
+	float tickRate() const { return tick_hz_; }
+	unsigned int ticksPerSecond() const { return ticks_per_second_; }
+
+protected:
+	enum class Command { StartTesting, StopTesting, ToggleTargets };
+
+	void run();
+	void tick( const Input& input );
+	void highlight_touching( const Input& input );
+
+	void start_testing();
+	void start_timer();
+	void stop_testing();
+	void toggle_targets();
+
+	struct Target {
+		glm::vec3 position;
+		float radius;
+	};
+	std::vector<Target> targets_;
+	SpatialHash target_hash_;
+	float max_target_radius_ = 0.0f;
+	glm::vec3 default_colour_   = { 1.0f, 0.0f, 1.0f };
+	glm::vec3 highlight_colour_ = { 1.0f, 1.0f, 1.0f };
+
+	std::thread thread_;
+	std::atomic<bool> running_{ false };
+	float tick_hz_ = 250.0f;
+	std::atomic<unsigned int> ticks_per_second_{ 0 };
+
+	TripleBuffer<Input> inputs_;
+	TripleBuffer<Snapshot> snapshots_;
+	SpscQueue<Command, 16> commands_;
+
+	// Only touched by the simulation thread while running
+	std::vector<TargetState> states_;
+	std::vector<unsigned int> candidates_;
+	std::vector<unsigned int> highlighted_;
+	unsigned int target_tests_ = 0;
+	uint64_t ticks_ = 0;
+
+	// Testing
+	bool test_mode_       = false;
+	Uint32 start_time_    = 0;
+	Uint32 end_time_      = 0;
+	Uint32 previous_time_ = 0;
+	std::vector<Uint32> times_;
+	std::vector<size_t> sphere_indecies_;
+};
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "selection.h"
+#include <algorithm>
+
+namespace
+{
+	size_t count_bits( uint64_t word )
+	{
+		size_t count = 0;
+		while( word )
+		{
+			word &= word - 1;
+			count++;
+		}
+		return count;
+	}
+
+	// Bits first to last within a single word, last is exclusive and at most 64
+	uint64_t bit_mask( size_t first, size_t last )
+	{
+		uint64_t upper = last >= 64 ? ~0ull : ((1ull << last) - 1);
+		uint64_t lower = (1ull << first) - 1;
+		return upper & ~lower;
+	}
+}
+
+void Selection::resize( size_t count )
+{
+	size_ = count;
+	count_ = 0;
+	words_.assign( (count + 63) / 64, 0 );
+	dirty_.assign( (count + CHUNK_SIZE - 1) / CHUNK_SIZE, 1 );
+	any_dirty_ = !dirty_.empty();
+}
+
+void Selection::reset( size_t count, size_t first_dirty )
+{
+	size_ = count;
+	count_ = 0;
+	words_.assign( (count + 63) / 64, 0 );
+
+	// Chunks still waiting to be sent stay dirty, what the GPU holds for them is out of date
+	dirty_.resize( (count + CHUNK_SIZE - 1) / CHUNK_SIZE, 1 );
+	for( size_t chunk = first_dirty / CHUNK_SIZE; chunk < dirty_.size(); chunk++ )
+	{
+		dirty_[chunk] = 1;
+	}
+	any_dirty_ = std::find( dirty_.begin(), dirty_.end(), 1 ) != dirty_.end();
+}
+
+void Selection::invert()
+{
+	for( uint64_t& word : words_ ) word = ~word;
+
+	// Keep the bits past the end clear
+	if( size_ & 63 ) words_.back() &= bit_mask( 0, size_ & 63 );
+
+	count_ = size_ - count_;
+	std::fill( dirty_.begin(), dirty_.end(), 1 );
+	any_dirty_ = !dirty_.empty();
+}
+
+size_t Selection::firstSet() const
+{
+	for( size_t w = 0; w < words_.size(); w++ )
+	{
+		if( words_[w] == 0 ) continue;
+
+		size_t bit = 0;
+		while( ((words_[w] >> bit) & 1) == 0 ) bit++;
+		return std::min( (w << 6) + bit, size_ );
+	}
+	return size_;
+}
+
+void Selection::clear()
+{
+	if( count_ == 0 ) return;
+	setRange( 0, size_, false );
+}
+
+void Selection::set( size_t index, bool selected )
+{
+	if( index >= size_ || test( index ) == selected ) return;
+
+	uint64_t bit = 1ull << (index & 63);
+	if( selected ) {
+		words_[index >> 6] |= bit;
+		count_++;
+	} else {
+		words_[index >> 6] &= ~bit;
+		count_--;
+	}
+
+	dirty_[index / CHUNK_SIZE] = 1;
+	any_dirty_ = true;
+}
+
+void Selection::setRange( size_t first, size_t last, bool selected )
+{
+	last = std::min( last, size_ );
+	if( first >= last ) return;
+
+	// Work a whole word at a time, only the words at each end are partial
+	size_t first_word = first >> 6;
+	size_t last_word = (last - 1) >> 6;
+	for( size_t w = first_word; w <= last_word; w++ )
+	{
+		size_t begin = (w == first_word) ? (first & 63) : 0;
+		size_t end = (w == last_word) ? (last - (w << 6)) : 64;
+		uint64_t mask = bit_mask( begin, end );
+
+		uint64_t before = words_[w];
+		words_[w] = selected ? (before | mask) : (before & ~mask);
+
+		// Only chunks that actually changed need uploading
+		size_t changed = count_bits( before ^ words_[w] );
+		if( changed )
+		{
+			count_ = selected ? count_ + changed : count_ - changed;
+			dirty_[(w << 6) / CHUNK_SIZE] = 1;
+			any_dirty_ = true;
+		}
+	}
+}
+
+void Selection::clearDirty()
+{
+	std::fill( dirty_.begin(), dirty_.end(), 0 );
+	any_dirty_ = false;
+}
+
+size_t Selection::expandChunk( size_t chunk, GLubyte* out ) const
+{
+	size_t first = chunk * CHUNK_SIZE;
+	size_t last = std::min( first + CHUNK_SIZE, size_ );
+
+	for( size_t i = first; i < last; i++ )
+	{
+		out[i - first] = test( i ) ? 255 : 0;
+	}
+	return last - first;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Which points of the cloud are selected, one bit per point. The points are grouped into chunks
+// and any chunk that changes is marked dirty, so only those need sending to the GPU again.
+
+class Selection
+{
+public:
+	// Points per dirty chunk, each chunk is uploaded as one byte per point
+	static const size_t CHUNK_SIZE = 65536;
+
+	// Deselects everything and marks it all dirty
+	void resize( size_t count );
+	// Deselects everything and marks the chunks from first_dirty onwards dirty, chunks that were already dirty stay so.
+	// For when the points have changed but everything before first_dirty is known to be unselected on the GPU
+	void reset( size_t count, size_t first_dirty );
+	void clear();
+	void invert();
+
+	void set( size_t index, bool selected );
+	void setRange( size_t first, size_t last, bool selected );
+	bool test( size_t index ) const { return (words_[index >> 6] >> (index & 63)) & 1; }
+	// Index of the first selected point, or size() if there isn't one
+	size_t firstSet() const;
+
+	// Writes one byte per point in the chunk, 255 for selected and 0 for not, returns the number of points
+	size_t expandChunk( size_t chunk, GLubyte* out ) const;
+
+	// Dirty tracking
+	size_t numChunks() const { return dirty_.size(); }
+	bool isChunkDirty( size_t chunk ) const { return dirty_[chunk] != 0; }
+	bool isDirty() const { return any_dirty_; }
+	void clearDirty();
+
+	// Getters
+	size_t size() const { return size_; }
+	size_t count() const { return count_; }
+	const std::vector<uint64_t>& words() const { return words_; }
+
+private:
+	std::vector<uint64_t> words_;
+	std::vector<unsigned char> dirty_;
+	bool any_dirty_ = false;
+
+	size_t size_ = 0;
+	size_t count_ = 0;
+};
\ No newline at end of file
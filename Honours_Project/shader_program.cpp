@@ -1,4 +1,6 @@
 #include "shader_program.h"
+#include "camera_uniforms.h"
+#include "gl_state.h"
 #include <fstream>
 #include <sstream>
 
@@ -96,6 +98,9 @@ bool ShaderProgram::init()
         glDetachShader( program_, fragment_shader_ );
         glDeleteShader( vertex_shader_ );
         glDeleteShader( fragment_shader_ ); 
+
+        // Shaders that use the camera block all read from the same buffer
+        bindUniformBlock( "Camera", CAMERA_UNIFORM_BINDING );
     }
 
     // Return true on success, false on error
@@ -104,14 +109,14 @@ bool ShaderProgram::init()
 
 void ShaderProgram::shutdown()
 {
-    glDeleteProgram( program_ );
+    GLState::deleteProgram( program_ );
     glDeleteShader( vertex_shader_ );
     glDeleteShader( fragment_shader_ );
 }
 
 void ShaderProgram::bind() const
 {
-	glUseProgram( program_ );
+	GLState::useProgram( program_ );
 }
 
 GLint ShaderProgram::getUniformLocation( const GLchar* name ) const
@@ -133,6 +138,16 @@ GLint ShaderProgram::getAttribLocation( const GLchar* name ) const
     return attribute;
 }
 
+bool ShaderProgram::bindUniformBlock( const GLchar* name, GLuint binding ) const
+{
+    GLuint index = glGetUniformBlockIndex( program_, name );
+    if( index == GL_INVALID_INDEX ) {
+        return false;
+    }
+    glUniformBlockBinding( program_, index, binding );
+    return true;
+}
+
 bool ShaderProgram::loadVertexSourceFile( std::string file_path )
 {
     return load_file( file_path, &vertex_source_ );
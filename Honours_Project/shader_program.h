@@ -33,6 +33,9 @@ public:
 	GLint getAttribLocation( const GLchar* name ) const;
 	GLint getProgram() const { return program_; }
 
+	// Connects a uniform block in the program to a buffer binding point, returns false if the block is not used
+	bool bindUniformBlock( const GLchar* name, GLuint binding ) const;
+
 private:
 	// Loads the text file 'filename' and passes the contents to the pointer
 	bool load_file( std::string filename, std::string* file_contents  );
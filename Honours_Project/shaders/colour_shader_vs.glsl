@@ -1,8 +1,15 @@
 #version 410
 
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	vec4 camera_position;
+	int eye;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vColour;
@@ -12,5 +19,5 @@ out vec3 fColour;
 void main()
 {
 	fColour = vColour;
-	gl_Position = projection * view * model * vec4(vPosition, 1.0);
+	gl_Position = view_projection * model * vec4(vPosition, 1.0);
 }
\ No newline at end of file
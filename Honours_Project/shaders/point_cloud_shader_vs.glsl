@@ -0,0 +1,27 @@
+#version 410
+
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	vec4 camera_position;
+	int eye;
+};
+
+uniform mat4 model;
+
+layout(location = 0) in vec3 vPosition;
+layout(location = 1) in vec3 vColour;
+layout(location = 2) in float vSelected;
+
+out vec3 fColour;
+
+const vec3 selected_colour = vec3(1.0, 0.8, 0.0);
+
+void main()
+{
+	// Selected points are tinted towards the highlight colour
+	fColour = mix(vColour, selected_colour, vSelected * 0.8);
+	gl_Position = view_projection * model * vec4(vPosition, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 410
+
+flat in uint fId;
+
+out uint outId;
+
+void main()
+{
+	outId = fId;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 410
+
+// Already includes the pick region and the point cloud's model matrix
+uniform mat4 pick_matrix;
+
+layout(location = 0) in vec3 vPosition;
+
+flat out uint fId;
+
+void main()
+{
+	// 0 is left for the background
+	fId = uint(gl_VertexID) + 1u;
+	gl_Position = pick_matrix * vec4(vPosition, 1.0);
+}
\ No newline at end of file
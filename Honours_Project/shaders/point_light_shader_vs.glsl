@@ -1,23 +1,53 @@
 #version 410
 
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	vec4 camera_position;
+	int eye;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform vec3 tool_position;
 
 layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vColour;
+layout(location = 2) in float vSelected;
+layout(location = 3) in vec2 vNormal;
 
 out vec3 fColour;
 
+const vec3 selected_colour = vec3(1.0, 0.8, 0.0);
+const float ambient = 0.15;
+const float light_range = 1.0;
+
+// Octahedral encoding, the lower half of the sphere is folded out over the corners
+vec3 decode_normal(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
-	vec4 projected = projection * view * model * vec4(vPosition, 1.0);
-	vec4 transformed = view * model * vec4(vPosition, 1.0);
+	vec4 world_position = model * vec4(vPosition, 1.0);
+
+	// The model matrix only scales uniformly, so it can transform the normal directly
+	vec3 normal = normalize(mat3(model) * decode_normal(vNormal));
+	vec3 to_light = tool_position - world_position.xyz;
+	float light_distance = length(to_light);
+
+	// Estimated normals can face either way, so light both sides
+	float diffuse = abs(dot(normal, to_light / max(light_distance, 0.0001)));
+	float attenuation = clamp(1.0 - light_distance / light_range, 0.0, 1.0);
 
-	//fColour = vColour;
-	//fColour.r = clamp( abs(distance(tool_position, transformed.xyz)) * 0.2, 0.1, 1.0 );
-	fColour = vec3( tool_position.x, vColour.y, vColour.x );
+	vec3 colour = mix(vColour, selected_colour, vSelected * 0.8);
+	fColour = colour * (ambient + diffuse * attenuation * attenuation);
 
-	gl_Position = projected;
+	gl_Position = view_projection * world_position;
 }
\ No newline at end of file
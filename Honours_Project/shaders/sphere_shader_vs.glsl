@@ -0,0 +1,34 @@
+#version 410
+
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	vec4 camera_position;
+	int eye;
+};
+
+layout(location = 0) in vec3 vPosition;
+
+// Per instance attributes, the transform takes up locations 1 to 4
+layout(location = 1) in mat4 iTransform;
+layout(location = 5) in vec3 iColour;
+layout(location = 6) in float iRadius;
+layout(location = 7) in float iActive;
+
+out vec3 fColour;
+
+void main()
+{
+	fColour = iColour;
+
+	// Inactive spheres are collapsed to a point outside of the clip volume
+	if( iActive < 0.5 )
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+
+	gl_Position = view_projection * iTransform * vec4(vPosition * iRadius, 1.0);
+}
\ No newline at end of file
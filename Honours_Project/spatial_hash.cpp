@@ -0,0 +1,91 @@
+#include "spatial_hash.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialHash::SpatialHash( float cell_size )
+{
+	setCellSize( cell_size );
+}
+
+void SpatialHash::setCellSize( float cell_size )
+{
+	cell_size_ = cell_size > 0.0f ? cell_size : 0.1f;
+	inv_cell_size_ = 1.0f / cell_size_;
+	clear();
+}
+
+void SpatialHash::clear()
+{
+	cells_.clear();
+	size_ = 0;
+}
+
+glm::ivec3 SpatialHash::cell( const glm::vec3& position ) const
+{
+	return glm::ivec3(
+		(int)std::floor( position.x * inv_cell_size_ ),
+		(int)std::floor( position.y * inv_cell_size_ ),
+		(int)std::floor( position.z * inv_cell_size_ ) );
+}
+
+SpatialHash::Key SpatialHash::key( const glm::ivec3& cell )
+{
+	// Pack 21 bits of each coordinate into one 64 bit key
+	const int64_t mask = (1 << 21) - 1;
+	return ((int64_t)(cell.x & mask) << 42) | ((int64_t)(cell.y & mask) << 21) | (int64_t)(cell.z & mask);
+}
+
+void SpatialHash::insert( unsigned int id, const glm::vec3& position )
+{
+	cells_[key( cell( position ) )].push_back( id );
+	size_++;
+}
+
+void SpatialHash::remove( unsigned int id, const glm::vec3& position )
+{
+	auto it = cells_.find( key( cell( position ) ) );
+	if( it == cells_.end() ) return;
+
+	std::vector<unsigned int>& ids = it->second;
+	auto found = std::find( ids.begin(), ids.end(), id );
+	if( found == ids.end() ) return;
+
+	// Order within a cell doesn't matter
+	*found = ids.back();
+	ids.pop_back();
+	size_--;
+
+	if( ids.empty() ) cells_.erase( it );
+}
+
+void SpatialHash::move( unsigned int id, const glm::vec3& old_position, const glm::vec3& new_position )
+{
+	// Most moves stay in the same cell
+	if( cell( old_position ) == cell( new_position ) ) return;
+
+	remove( id, old_position );
+	insert( id, new_position );
+}
+
+void SpatialHash::query( const glm::vec3& centre, float radius, std::vector<unsigned int>& results ) const
+{
+	if( cells_.empty() ) return;
+
+	glm::ivec3 lower = cell( centre - glm::vec3( radius ) );
+	glm::ivec3 upper = cell( centre + glm::vec3( radius ) );
+
+	for( int x = lower.x; x <= upper.x; x++ )
+	{
+		for( int y = lower.y; y <= upper.y; y++ )
+		{
+			for( int z = lower.z; z <= upper.z; z++ )
+			{
+				auto it = cells_.find( key( glm::ivec3( x, y, z ) ) );
+				if( it != cells_.end() )
+				{
+					results.insert( results.end(), it->second.begin(), it->second.end() );
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
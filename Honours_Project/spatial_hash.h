@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Uniform grid over a set of points, stored sparsely in a hash map so the space can be any size.
+// Used as a broad phase, a query returns everything in the cells overlapping a sphere and the caller
+// does the exact test on just those. Points can be moved one at a time, which only touches the two
+// cells involved, so there is no need to rebuild the whole thing when a few points change.
+
+class SpatialHash
+{
+public:
+	SpatialHash( float cell_size = 0.1f );
+
+	// Changing the cell size empties the hash
+	void setCellSize( float cell_size );
+	void clear();
+
+	void insert( unsigned int id, const glm::vec3& position );
+	void remove( unsigned int id, const glm::vec3& position );
+	void move( unsigned int id, const glm::vec3& old_position, const glm::vec3& new_position );
+
+	// Appends the id of everything in the cells overlapping the sphere, does not clear 'results'
+	void query( const glm::vec3& centre, float radius, std::vector<unsigned int>& results ) const;
+
+	// Getters
+	float cellSize() const { return cell_size_; }
+	size_t size() const { return size_; }
+	size_t numCells() const { return cells_.size(); }
+
+private:
+	typedef int64_t Key;
+
+	glm::ivec3 cell( const glm::vec3& position ) const;
+	static Key key( const glm::ivec3& cell );
+
+	float cell_size_;
+	float inv_cell_size_;
+	size_t size_ = 0;
+
+	std::unordered_map<Key, std::vector<unsigned int>> cells_;
+};
\ No newline at end of file
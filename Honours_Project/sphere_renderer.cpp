@@ -0,0 +1,154 @@
+#include "sphere_renderer.h"
+#include "sphere.h"
+#include "gl_state.h"
+#include "stream_buffer.h"
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+SphereRenderer::SphereRenderer()
+{}
+
+SphereRenderer::~SphereRenderer()
+{
+	shutdown();
+}
+
+bool SphereRenderer::init()
+{
+	shader_.loadVertexSourceFile( "sphere_shader_vs.glsl" );
+	shader_.loadFragmentSourceFile( "colour_shader_fs.glsl" );
+	if( !shader_.init() )
+	{
+		std::cout << "ERROR: failed to init sphere shader!" << std::endl;
+		return false;
+	}
+
+	init_mesh();
+
+	return true;
+}
+
+void SphereRenderer::shutdown()
+{
+	if( vao_ ) {
+		GLState::deleteVertexArrays( 1, &vao_ );
+		vao_ = 0;
+	}
+	if( mesh_vbo_ ) {
+		GLState::deleteBuffers( 1, &mesh_vbo_ );
+		mesh_vbo_ = 0;
+	}
+	num_instances_ = 0;
+	instances_ = nullptr;
+	instance_capacity_ = 0;
+}
+
+void SphereRenderer::init_mesh()
+{
+	// Three unit circles, one around each axis, scaled by the radius in the shader
+	std::vector<GLfloat> verts;
+	verts.reserve( segments_ * 3 * 2 * 3 );
+
+	const float incr = 6.283f / (float)segments_;
+	for( int i = 0; i < segments_; i++ )
+	{
+		float s0 = std::sin( incr * i );
+		float c0 = std::cos( incr * i );
+		float s1 = std::sin( incr * (i + 1) );
+		float c1 = std::cos( incr * (i + 1) );
+
+		// first circle
+		verts.push_back( s0 ); verts.push_back( c0 ); verts.push_back( 0.0f );
+		verts.push_back( s1 ); verts.push_back( c1 ); verts.push_back( 0.0f );
+
+		// second circle
+		verts.push_back( s0 ); verts.push_back( 0.0f ); verts.push_back( c0 );
+		verts.push_back( s1 ); verts.push_back( 0.0f ); verts.push_back( c1 );
+
+		// third circle
+		verts.push_back( 0.0f ); verts.push_back( s0 ); verts.push_back( c0 );
+		verts.push_back( 0.0f ); verts.push_back( s1 ); verts.push_back( c1 );
+	}
+	num_verts_ = (GLsizei)verts.size() / 3;
+
+	glGenVertexArrays( 1, &vao_ );
+	GLState::bindVertexArray( vao_ );
+
+	// Static mesh
+	glGenBuffers( 1, &mesh_vbo_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, mesh_vbo_ );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( verts[0] ) * verts.size(), verts.data(), GL_STATIC_DRAW );
+
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), (const void *)0 );
+
+	// Per instance data, a mat4 takes up four attribute locations.
+	// The pointers are set each frame in end(), once we know where the data was written
+	for( GLuint location = 1; location <= 7; location++ )
+	{
+		glEnableVertexAttribArray( location );
+		glVertexAttribDivisor( location, 1 );
+	}
+
+	GLState::bindVertexArray( 0 );
+}
+
+void SphereRenderer::begin( GLsizei max_spheres )
+{
+	num_instances_ = 0;
+	instance_capacity_ = 0;
+	instances_ = nullptr;
+	if( max_spheres <= 0 ) return;
+
+	instances_ = StreamBuffer::get()->allocate<Instance>( max_spheres, &instance_offset_ );
+	if( instances_ ) instance_capacity_ = max_spheres;
+}
+
+void SphereRenderer::addSphere( const Sphere& sphere )
+{
+	if( num_instances_ >= instance_capacity_ ) return;
+
+	// Written straight into mapped memory, so only ever write to it
+	Instance& instance = instances_[num_instances_++];
+	instance.transform = sphere.transform();
+	instance.colour = sphere.colour();
+	instance.radius = sphere.radius();
+	instance.active = sphere.active() ? 1.0f : 0.0f;
+}
+
+void SphereRenderer::end()
+{
+	instances_ = nullptr;
+	if( num_instances_ == 0 ) return;
+
+	// Point the instance attributes at this frame's region of the stream buffer
+	GLState::bindVertexArray( vao_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, StreamBuffer::get()->buffer() );
+
+	GLsizei stride = sizeof( Instance );
+	GLintptr base = instance_offset_;
+	for( GLuint column = 0; column < 4; column++ )
+	{
+		glVertexAttribPointer( 1 + column, 4, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof( Instance, transform ) + sizeof( glm::vec4 ) * column) );
+	}
+	glVertexAttribPointer( 5, 3, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof( Instance, colour )) );
+	glVertexAttribPointer( 6, 1, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof( Instance, radius )) );
+	glVertexAttribPointer( 7, 1, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof( Instance, active )) );
+
+	GLState::bindVertexArray( 0 );
+}
+
+void SphereRenderer::submit( RenderQueue& queue )
+{
+	if( num_instances_ == 0 ) return;
+
+	// The transforms are per instance, the view and projection come from the camera uniform block
+	DrawItem item;
+	item.program = shader_.getProgram();
+	item.vao = vao_;
+	item.primitive = GL_LINES;
+	item.count = num_verts_;
+	item.instances = num_instances_;
+	queue.submit( item );
+}
\ No newline at end of file
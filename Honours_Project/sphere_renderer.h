@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+#include <vector>
+
+#include "shader_program.h"
+#include "render_queue.h"
+
+class Sphere;
+
+// Draws any number of wireframe spheres with a single instanced draw call.
+// Every sphere shares one static unit mesh, the per sphere transform, radius,
+// colour and active flag are written into the shared stream buffer each frame.
+
+class SphereRenderer
+{
+public:
+	SphereRenderer();
+	~SphereRenderer();
+
+	bool init();
+	void shutdown();
+
+	// Rebuild the instance list, call once per frame after the spheres have been updated.
+	// Reserves room for up to max_spheres in the stream buffer, extra spheres are ignored.
+	void begin( GLsizei max_spheres );
+	void addSphere( const Sphere& sphere );
+	void end();
+
+	void submit( RenderQueue& queue );
+
+	// Getters
+	GLsizei numInstances() const { return num_instances_; }
+
+protected:
+	// Layout must match the instance attributes in sphere_shader_vs.glsl
+	struct Instance {
+		glm::mat4 transform;
+		glm::vec3 colour;
+		GLfloat radius;
+		GLfloat active;
+	};
+
+	void init_mesh();
+
+	ShaderProgram shader_;
+
+	int segments_ = 20;
+
+	GLuint vao_                  = 0;
+	GLuint mesh_vbo_             = 0;
+	GLsizei num_verts_           = 0;
+	GLsizei num_instances_       = 0;
+
+	// This frame's instances, pointing into the stream buffer
+	Instance* instances_         = nullptr;
+	GLsizei instance_capacity_   = 0;
+	GLintptr instance_offset_    = 0;
+};
\ No newline at end of file
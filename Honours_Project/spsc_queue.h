@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed size queue for passing values from exactly one producer thread to exactly one consumer
+// thread without locking. Capacity must be a power of two, one slot is always left empty.
+
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert( Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two" );
+
+public:
+	// Producer only, returns false if the queue is full
+	bool push( const T& value )
+	{
+		size_t head = head_.load( std::memory_order_relaxed );
+		size_t next = (head + 1) & (Capacity - 1);
+		if( next == tail_.load( std::memory_order_acquire ) ) return false;
+
+		items_[head] = value;
+		head_.store( next, std::memory_order_release );
+		return true;
+	}
+
+	// Consumer only, returns false if the queue is empty
+	bool pop( T& value )
+	{
+		size_t tail = tail_.load( std::memory_order_relaxed );
+		if( tail == head_.load( std::memory_order_acquire ) ) return false;
+
+		value = items_[tail];
+		tail_.store( (tail + 1) & (Capacity - 1), std::memory_order_release );
+		return true;
+	}
+
+	bool empty() const { return tail_.load( std::memory_order_acquire ) == head_.load( std::memory_order_acquire ); }
+
+private:
+	T items_[Capacity];
+
+	// Kept on separate cache lines so the two threads don't fight over them
+	alignas( 64 ) std::atomic<size_t> head_{ 0 };
+	alignas( 64 ) std::atomic<size_t> tail_{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include <iostream>
+
+// Static member delcarations
+StreamBuffer* StreamBuffer::self_ = nullptr;
+
+StreamBuffer::StreamBuffer()
+{}
+
+StreamBuffer::~StreamBuffer()
+{
+	if( buffer_ )
+	{
+		GLState::bindBuffer( GL_ARRAY_BUFFER, buffer_ );
+		if( mapped_ ) glUnmapBuffer( GL_ARRAY_BUFFER );
+		GLState::deleteBuffers( 1, &buffer_ );
+		buffer_ = 0;
+	}
+	mapped_ = nullptr;
+
+	self_ = nullptr;
+}
+
+StreamBuffer* StreamBuffer::get()
+{
+	if( self_ == nullptr )
+	{
+		self_ = new StreamBuffer();
+		bool success = self_->init();
+
+		if( success == false )
+		{
+			delete self_;
+		}
+	}
+
+	return self_;
+}
+
+bool StreamBuffer::init()
+{
+	region_size_ = DEFAULT_REGION_SIZE;
+	GLsizeiptr total_size = region_size_ * NUM_REGIONS;
+
+	glGenBuffers( 1, &buffer_ );
+	GLState::bindBuffer( GL_ARRAY_BUFFER, buffer_ );
+
+	if( GLEW_ARB_buffer_storage )
+	{
+		// Map the whole thing once and leave it mapped
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_ARRAY_BUFFER, total_size, nullptr, flags );
+		mapped_ = (unsigned char*)glMapBufferRange( GL_ARRAY_BUFFER, 0, total_size, flags );
+		persistent_ = mapped_ != nullptr;
+	}
+
+	if( !persistent_ )
+	{
+		// Fall back to mapping one region at a time without synchronising, the fences protect it instead
+		glBufferData( GL_ARRAY_BUFFER, total_size, nullptr, GL_STREAM_DRAW );
+		mapped_ = nullptr;
+	}
+
+	std::cout << "Stream buffer: " << (total_size / 1024) << "KB, " << (persistent_ ? "persistently mapped" : "mapped per frame") << std::endl;
+
+	return buffer_ != 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+	last_frame_bytes_ = cursor_;
+
+	// The pipeline has already waited for the GPU to finish with the last frame in this slot
+	region_ = FramePipeline::get()->frameSlot();
+	cursor_ = 0;
+	overflowed_ = false;
+
+	if( !persistent_ )
+	{
+		GLState::bindBuffer( GL_ARRAY_BUFFER, buffer_ );
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		mapped_ = (unsigned char*)glMapBufferRange( GL_ARRAY_BUFFER, region_size_ * region_, region_size_, flags );
+	}
+}
+
+void StreamBuffer::flush()
+{
+	if( !persistent_ && mapped_ )
+	{
+		GLState::bindBuffer( GL_ARRAY_BUFFER, buffer_ );
+		glUnmapBuffer( GL_ARRAY_BUFFER );
+		mapped_ = nullptr;
+	}
+}
+
+void StreamBuffer::endFrame()
+{
+	flush();
+}
+
+void* StreamBuffer::allocate( GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset )
+{
+	if( !mapped_ ) return nullptr;
+
+	// Align the absolute offset, so it divides evenly by the vertex size
+	GLintptr region_start = region_size_ * region_;
+	GLintptr start = region_start + cursor_;
+	if( alignment > 1 )
+	{
+		start = ((start + alignment - 1) / alignment) * alignment;
+	}
+
+	if( start + size > region_start + region_size_ )
+	{
+		if( !overflowed_ )
+		{
+			std::cout << "WARNING: stream buffer is full, " << size << " bytes were not written this frame" << std::endl;
+			overflowed_ = true;
+		}
+		return nullptr;
+	}
+
+	cursor_ = start + size - region_start;
+	*offset = start;
+
+	// When mapped per frame the pointer is to the start of the current region
+	return persistent_ ? mapped_ + start : mapped_ + (start - region_start);
+}
\ No newline at end of file
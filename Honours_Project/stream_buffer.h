@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "frame_pipeline.h"
+
+// A single vertex buffer shared by everything that writes new geometry every frame.
+// The buffer is split into one region per FramePipeline slot and each frame writes into its slot's
+// region, so a region is only reused once the pipeline has seen the GPU finish with it.
+// If the driver has ARB_buffer_storage the buffer is mapped once and stays mapped, otherwise the
+// region is mapped unsynchronized at the start of the frame and unmapped before drawing.
+
+/* SINGLETON */
+class StreamBuffer
+{
+public:
+	// Returns a pointer to the stream buffer, or nullptr on failure. Needs a GL context.
+	static StreamBuffer* get();
+	~StreamBuffer();
+
+	// Call once at the start of the frame, after FramePipeline::beginFrame() and before anything is allocated
+	void beginFrame();
+	// Call after all writes for the frame and before anything that uses them is drawn
+	void flush();
+	// Call after everything that uses this frame's data has been submitted, before FramePipeline::endFrame()
+	void endFrame();
+
+	// Returns a pointer to write 'size' bytes to, and the offset of those bytes in the buffer.
+	// The offset is a multiple of 'alignment', so passing the vertex size allows drawing with first = offset / stride.
+	// Returns nullptr if the region for this frame is full.
+	void* allocate( GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset );
+
+	template<typename T>
+	T* allocate( GLsizei count, GLintptr* offset ) { return (T*)allocate( sizeof( T ) * count, sizeof( T ), offset ); }
+
+	// Getters
+	GLuint buffer() const { return buffer_; }
+	bool isPersistent() const { return persistent_; }
+	GLsizeiptr regionSize() const { return region_size_; }
+	GLsizeiptr lastFrameBytes() const { return last_frame_bytes_; }
+
+private:
+	StreamBuffer();
+	static StreamBuffer* self_;
+	bool init();
+
+	static const int NUM_REGIONS = FramePipeline::FRAMES_IN_FLIGHT;
+	static const GLsizeiptr DEFAULT_REGION_SIZE = 4 * 1024 * 1024;
+
+	GLuint buffer_ = 0;
+	bool persistent_ = false;
+	GLsizeiptr region_size_ = 0;
+
+	// Points at the start of the whole buffer when persistent, otherwise at the current region while mapped
+	unsigned char* mapped_ = nullptr;
+	int region_ = 0;
+	GLsizeiptr cursor_ = 0;
+	bool overflowed_ = false;
+
+	GLsizeiptr last_frame_bytes_ = 0;
+};
\ No newline at end of file
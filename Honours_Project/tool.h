@@ -1,6 +1,7 @@
 #pragma once
 #include "openvr.h"
 #include "glm.hpp"
+#include "render_queue.h"
 
 class VRSystem;
 class Controller;
@@ -19,7 +20,7 @@ public:
 	virtual void activate() = 0;
 	virtual void deactivate() = 0;
 	virtual void update( float dt ) = 0;
-	virtual void render( const glm::mat4& view, const glm::mat4& projection ) = 0;
+	virtual void submit( RenderQueue& queue ) = 0;
 
 	// Setters
 	void setController( Controller* controller ) { controller_ = controller; }
@@ -0,0 +1,80 @@
+#include "transform.h"
+#include <algorithm>
+
+Transform::Transform()
+{}
+
+Transform::~Transform()
+{
+	setParent( nullptr );
+
+	// Children stay where they are in the world but lose their parent
+	for( Transform* child : children_ )
+	{
+		child->parent_ = nullptr;
+		child->markDirty();
+	}
+	children_.clear();
+}
+
+void Transform::setParent( Transform* parent )
+{
+	if( parent == parent_ ) return;
+
+	if( parent_ )
+	{
+		auto it = std::find( parent_->children_.begin(), parent_->children_.end(), this );
+		if( it != parent_->children_.end() ) parent_->children_.erase( it );
+	}
+
+	parent_ = parent;
+	if( parent_ ) parent_->children_.push_back( this );
+
+	markDirty();
+}
+
+void Transform::setLocal( const glm::mat4& local )
+{
+	if( local == local_ ) return;
+
+	local_ = local;
+	markDirty();
+}
+
+void Transform::setLocalPosition( const glm::vec3& position )
+{
+	glm::mat4 local = local_;
+	local[3] = glm::vec4( position, 1.0f );
+	setLocal( local );
+}
+
+const glm::mat4& Transform::world() const
+{
+	if( dirty_ )
+	{
+		world_ = parent_ ? parent_->world() * local_ : local_;
+		dirty_ = false;
+		version_++;
+	}
+
+	return world_;
+}
+
+unsigned int Transform::version() const
+{
+	// Make sure the version is up to date
+	world();
+	return version_;
+}
+
+void Transform::markDirty()
+{
+	// If this node is already dirty then so are all of its children
+	if( dirty_ ) return;
+
+	dirty_ = true;
+	for( Transform* child : children_ )
+	{
+		child->markDirty();
+	}
+}
\ No newline at end of file
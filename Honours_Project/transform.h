@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+
+// A node in a simple transform hierarchy. Each node stores a transform relative to its parent,
+// the world transform is only recalculated when it is asked for after the node or one of its
+// parents has changed. Marking a node dirty stops at children that are already dirty, so the
+// cost of moving something is proportional to how much actually needs updating.
+
+class Transform
+{
+public:
+	Transform();
+	~Transform();
+
+	// Nodes keep pointers to each other, so they can't be copied
+	Transform( Transform const& ) = delete;
+	Transform& operator=( Transform const& ) = delete;
+
+	// Pass nullptr to detach from the current parent
+	void setParent( Transform* parent );
+	void setLocal( const glm::mat4& local );
+	void setLocalPosition( const glm::vec3& position );
+
+	// Getters
+	Transform* parent() const { return parent_; }
+	const glm::mat4& local() const { return local_; }
+	const glm::mat4& world() const;
+	glm::vec3 worldPosition() const { return glm::vec3( world()[3] ); }
+	// Increases every time the world transform is recalculated, so users can tell if it moved
+	unsigned int version() const;
+
+private:
+	void markDirty();
+
+	Transform* parent_ = nullptr;
+	std::vector<Transform*> children_;
+
+	glm::mat4 local_ = glm::mat4( 1.0f );
+
+	// The world transform is a cache, so it can be updated from const getters
+	mutable glm::mat4 world_ = glm::mat4( 1.0f );
+	mutable bool dirty_ = false;
+	mutable unsigned int version_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from exactly one writer thread to exactly one reader thread without locking
+// and without either ever waiting. There are three copies: the writer fills the back one and swaps it
+// into the middle, the reader swaps the middle out to the front when a newer one is there. Values the
+// reader never got round to are simply skipped, so it always sees the newest complete value.
+//
+// The copies are reused, so a T holding vectors stops allocating once they have grown to size.
+
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Writer only, the copy to fill. It still holds whatever was written to it three publishes ago
+	T& back() { return items_[back_]; }
+	// Writer only, makes back() visible to the reader and hands the writer an older copy
+	void publish()
+	{
+		uint8_t previous = middle_.exchange( (uint8_t)(back_ | NEW_BIT), std::memory_order_acq_rel );
+		back_ = previous & INDEX_MASK;
+	}
+
+	// Reader only, swaps in the newest published value if there is one, returns true if it did
+	bool update()
+	{
+		if( !(middle_.load( std::memory_order_relaxed ) & NEW_BIT) ) return false;
+
+		uint8_t previous = middle_.exchange( front_, std::memory_order_acq_rel );
+		front_ = previous & INDEX_MASK;
+		return true;
+	}
+	// Reader only, stays the same until the next update()
+	const T& front() const { return items_[front_]; }
+
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t NEW_BIT = 0x4;
+
+	T items_[3];
+	uint8_t back_ = 0;
+	alignas( 64 ) std::atomic<uint8_t> middle_{ 1 };
+	alignas( 64 ) uint8_t front_ = 2;
+};
\ No newline at end of file
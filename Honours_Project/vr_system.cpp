@@ -1,8 +1,12 @@
 #include "vr_system.h"
 #include "helpers.h"
+#include "gl_state.h"
 #include <gtc/type_ptr.hpp>
+#include <gtc/matrix_transform.hpp>
 #include <SDL.h>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "point_cloud.h"
 
 // Static member delcarations
@@ -22,13 +26,14 @@ VRSystem::VRSystem() :
 // Destructor
 VRSystem::~VRSystem()
 {
-	glDeleteFramebuffers( 1, &eye_buffers_[0].render_frame_buffer );
-	glDeleteFramebuffers( 1, &eye_buffers_[0].resolve_frame_buffer );
-	glDeleteFramebuffers( 1, &eye_buffers_[1].render_frame_buffer );
-	glDeleteFramebuffers( 1, &eye_buffers_[1].resolve_frame_buffer );
+	GLState::deleteFramebuffers( 1, &eye_buffers_[0].render_frame_buffer );
+	GLState::deleteFramebuffers( 1, &eye_buffers_[0].resolve_frame_buffer );
+	GLState::deleteFramebuffers( 1, &eye_buffers_[1].render_frame_buffer );
+	GLState::deleteFramebuffers( 1, &eye_buffers_[1].resolve_frame_buffer );
 
 	left_controller_.shutdown();
 	right_controller_.shutdown();
+	render_models_.shutdown();
 
 	vr::VR_Shutdown();
 	// TODO: should i manually delete the vr_system ptr?
@@ -97,18 +102,23 @@ bool VRSystem::init()
 	vr_system_->GetRecommendedRenderTargetSize( &render_target_width_, &render_target_height_ );
 	std::cout << "HMD requested resolution: " << render_target_width_ << " by " << render_target_height_ << std::endl;
 
+	// Needed to work out when a frame will be seen
+	float display_frequency = vr_system_->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+	if( display_frequency > 0.0f ) frame_duration_ = 1.0f / display_frequency;
+	vsync_to_photons_ = vr_system_->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float );
+
 	/* SETUP FRAME BUFFERS */
 	for( int i = 0; i < 2; i++ )
 	{
 		// Create render frame buffer
 		glGenFramebuffers( 1, &eye_buffers_[i].render_frame_buffer );						// Create a FBO
-		glBindFramebuffer( GL_FRAMEBUFFER, eye_buffers_[i].render_frame_buffer );			// Bind the FBO
+		GLState::bindFramebuffer( GL_FRAMEBUFFER, eye_buffers_[i].render_frame_buffer );			// Bind the FBO
 		// Attach colour component
 		glGenTextures( 1, &eye_buffers_[i].render_texture );																				// Generate a colour texture
 		//glBindTexture( GL_TEXTURE_2D, eye_buffers_[i].render_texture );																		// Bind the texture
 		//glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, render_target_width_, render_target_height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0 );			// Create texture data
 		//glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, eye_buffers_[i].render_texture, 0 );					// Attach the texture to the bound FBO
-		glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, eye_buffers_[i].render_texture );															// Bind the multisampled texture
+		GLState::bindTexture( GL_TEXTURE_2D_MULTISAMPLE, eye_buffers_[i].render_texture );															// Bind the multisampled texture
 		glTexImage2DMultisample( GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGBA8, render_target_width_, render_target_height_, true );				// Create multisampled data
 		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, eye_buffers_[i].render_texture, 0 );		// Attach the multisampled texture to the bound FBO
 
@@ -127,10 +137,10 @@ bool VRSystem::init()
 
 		// Create resolve frame buffer
 		glGenFramebuffers( 1, &eye_buffers_[i].resolve_frame_buffer );
-		glBindFramebuffer( GL_FRAMEBUFFER, eye_buffers_[i].resolve_frame_buffer );
+		GLState::bindFramebuffer( GL_FRAMEBUFFER, eye_buffers_[i].resolve_frame_buffer );
 		// Attach colour component
 		glGenTextures( 1, &eye_buffers_[i].resolve_texture );
-		glBindTexture( GL_TEXTURE_2D, eye_buffers_[i].resolve_texture );
+		GLState::bindTexture( GL_TEXTURE_2D, eye_buffers_[i].resolve_texture );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GL_LINEAR );
 		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, render_target_width_, render_target_height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
@@ -151,7 +161,7 @@ bool VRSystem::init()
 		}
 
 		// Unbind any bound frame buffer
-		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		GLState::bindFramebuffer( GL_FRAMEBUFFER, 0 );
 	}
 
 	/* INIT SHADERS */
@@ -166,8 +176,6 @@ bool VRSystem::init()
 		else
 		{
 			controller_shader_modl_mat_locaton_ = controller_shader_.getUniformLocation( "model" );
-			controller_shader_view_mat_locaton_ = controller_shader_.getUniformLocation( "view" );
-			controller_shader_proj_mat_locaton_ = controller_shader_.getUniformLocation( "projection" );
 		}
 	}
 
@@ -212,6 +220,9 @@ void VRSystem::processVREvents()
 
 void VRSystem::manageDevices()
 {
+	// Never waits, models that are still loading are just further along next frame
+	render_models_.update();
+
 	// Init the left controller if it hasn't been initialised already
 	if( !left_controller_.isInitialised() )
 	{
@@ -243,6 +254,14 @@ void VRSystem::updatePoses()
 	// Update the pose list
 	vr::VRCompositor()->WaitGetPoses( poses_, vr::k_unMaxTrackedDeviceCount, NULL, 0 );
 
+	// WaitGetPoses() returns just before a vsync, the frame drawn now is scanned out at the one after it.
+	// Both eyes are predicted for this same moment, however long the frame takes to draw
+	float seconds_to_photons = vr::VRCompositor()->GetFrameTimeRemaining() + frame_duration_ + vsync_to_photons_;
+	photon_time_ = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<float>( seconds_to_photons ) );
+
+	// Until a late update, each eye is drawn from this pose
+	eye_poses_[0] = eye_poses_[1] = poses_[vr::k_unTrackedDeviceIndex_Hmd].mDeviceToAbsoluteTracking;
+
 	for( int device_index = 0; device_index < vr::k_unMaxTrackedDeviceCount; device_index++ )
 	{
 		if( poses_[device_index].bPoseIsValid )
@@ -258,6 +277,84 @@ void VRSystem::updatePoses()
 	}
 }
 
+float VRSystem::secondsToPhotons()
+{
+	float seconds = std::chrono::duration<float>( photon_time_ - std::chrono::steady_clock::now() ).count();
+	return std::max( seconds, 0.0f );
+}
+
+void VRSystem::lateUpdateHmdPose( vr::Hmd_Eye eye )
+{
+	const vr::TrackedDevicePose_t& update_pose = poses_[vr::k_unTrackedDeviceIndex_Hmd];
+	if( !late_pose_update_ || !update_pose.bPoseIsValid ) return;
+
+	int e = (eye == vr::Eye_Left ? 0 : 1);
+	LatePose& late = late_poses_[e];
+	late.predicted_seconds = secondsToPhotons();
+
+	vr::TrackedDevicePose_t pose;
+	vr_system_->GetDeviceToAbsoluteTrackingPose( vr::VRCompositor()->GetTrackingSpace(), late.predicted_seconds, &pose, 1 );
+	if( !pose.bPoseIsValid ) return;
+
+	// Angle of the rotation between the two, from the trace of the relative rotation
+	glm::mat4 before = convertHMDmat3ToGLMMat4( update_pose.mDeviceToAbsoluteTracking );
+	glm::mat4 after = convertHMDmat3ToGLMMat4( pose.mDeviceToAbsoluteTracking );
+	glm::mat3 relative = glm::transpose( glm::mat3( before ) ) * glm::mat3( after );
+	float cosine = glm::clamp( (relative[0][0] + relative[1][1] + relative[2][2] - 1.0f) * 0.5f, -1.0f, 1.0f );
+	late.position_delta = glm::length( glm::vec3( after[3] - before[3] ) );
+	late.angle_delta = glm::degrees( std::acos( cosine ) );
+	late.valid = true;
+
+	transforms_[vr::k_unTrackedDeviceIndex_Hmd] = glm::inverse( after );
+	eye_poses_[e] = pose.mDeviceToAbsoluteTracking;
+
+	if( late_pose_log_.is_open() )
+	{
+		late_pose_log_ << SDL_GetTicks() << "," << (e == 0 ? "left" : "right") << "," << late.predicted_seconds * 1000.0f << ","
+			<< late.position_delta * 1000.0f << "," << late.angle_delta << "\n";
+	}
+}
+
+bool VRSystem::setLatePoseLog( const std::string& filepath )
+{
+	if( late_pose_log_.is_open() ) late_pose_log_.close();
+	if( filepath.empty() ) return true;
+
+	late_pose_log_.open( filepath );
+	if( !late_pose_log_.good() )
+	{
+		std::cout << "ERROR: could not open '" << filepath << "' for writing" << std::endl;
+		late_pose_log_.close();
+		return false;
+	}
+
+	late_pose_log_ << "ticks,eye,predicted_ms,position_delta_mm,angle_delta_degrees\n";
+	std::cout << "Logging late poses to '" << filepath << "'" << std::endl;
+	return true;
+}
+
+glm::mat4 VRSystem::predictedDeviceTransform( uint32_t device, float seconds )
+{
+	const vr::TrackedDevicePose_t& pose = poses_[device];
+	if( !pose.bPoseIsValid ) return transforms_[device];
+
+	glm::mat4 device_to_tracking = convertHMDmat3ToGLMMat4( pose.mDeviceToAbsoluteTracking );
+	glm::vec3 position = glm::vec3( device_to_tracking[3] );
+	glm::vec3 velocity( pose.vVelocity.v[0], pose.vVelocity.v[1], pose.vVelocity.v[2] );
+	glm::vec3 angular_velocity( pose.vAngularVelocity.v[0], pose.vAngularVelocity.v[1], pose.vAngularVelocity.v[2] );
+
+	// Both velocities are in tracking space, so the extra rotation goes on the left of the device's own
+	float angle = glm::length( angular_velocity ) * seconds;
+	if( angle > 0.0f )
+	{
+		device_to_tracking[3] = glm::vec4( 0.0f, 0.0f, 0.0f, 1.0f );
+		device_to_tracking = glm::rotate( glm::mat4(), angle, glm::normalize( angular_velocity ) ) * device_to_tracking;
+	}
+	device_to_tracking[3] = glm::vec4( position + velocity * seconds, 1.0f );
+
+	return glm::inverse( device_to_tracking );
+}
+
 void VRSystem::updateDevices( float dt )
 {
 	if( left_controller_.isInitialised() )
@@ -282,40 +379,36 @@ void VRSystem::updateDevices( float dt )
 	}
 }
 
-void VRSystem::render( const glm::mat4& view, const glm::mat4& projection )
+void VRSystem::submit( RenderQueue& queue )
 {
-	drawControllers( view, projection );
+	submitControllers( queue );
 
-	if( move_tool_.isInitialised() ) move_tool_.render( view, projection );
-	if( pointer_tool_.isInitialised() ) pointer_tool_.render( view, projection );
-	if( point_light_tool_.isInitialised() ) point_light_tool_.render( view, projection );
+	if( move_tool_.isInitialised() ) move_tool_.submit( queue );
+	if( pointer_tool_.isInitialised() ) pointer_tool_.submit( queue );
+	if( point_light_tool_.isInitialised() ) point_light_tool_.submit( queue );
 }
 
-void VRSystem::drawControllers( glm::mat4 view, glm::mat4 projection )
+void VRSystem::submitControllers( RenderQueue& queue )
 {
-	controller_shader_.bind();
-	glUniformMatrix4fv( controller_shader_view_mat_locaton_, 1, GL_FALSE, glm::value_ptr( view ) );
-	glUniformMatrix4fv( controller_shader_proj_mat_locaton_, 1, GL_FALSE, glm::value_ptr( projection ) );
+	GLuint program = controller_shader_.getProgram();
 
 	if( left_controller_.isInitialised() )
 	{
-		glUniformMatrix4fv( controller_shader_modl_mat_locaton_, 1, GL_FALSE, glm::value_ptr( left_controller_.deviceToAbsoluteTracking() ) );
-		left_controller_.draw();
+		left_controller_.submit( queue, program, controller_shader_modl_mat_locaton_ );
 	}
 	if( right_controller_.isInitialised() )
 	{
-		glUniformMatrix4fv( controller_shader_modl_mat_locaton_, 1, GL_FALSE, glm::value_ptr( right_controller_.deviceToAbsoluteTracking() ) );
-		right_controller_.draw();
+		right_controller_.submit( queue, program, controller_shader_modl_mat_locaton_ );
 	}
 }
 
 void VRSystem::bindEyeTexture( vr::EVREye eye )
 {
-	glEnable( GL_MULTISAMPLE );
-	glEnable( GL_DEPTH_TEST );
+	GLState::enable( GL_MULTISAMPLE );
+	GLState::enable( GL_DEPTH_TEST );
 	// TODO: this should be binding the renderEyeTexture instead
-	glBindFramebuffer( GL_FRAMEBUFFER, resolveEyeTexture(eye) );
-	glViewport( 0, 0, render_target_width_, render_target_height_ );
+	GLState::bindFramebuffer( GL_FRAMEBUFFER, resolveEyeTexture(eye) );
+	GLState::viewport( 0, 0, render_target_width_, render_target_height_ );
 }
 
 void VRSystem::blitEyeTextures()
@@ -323,9 +416,9 @@ void VRSystem::blitEyeTextures()
 	for( int i = 0; i < 2; i++ )
 	{
 		// Blit from the render frame buffer to the resolve
-		glViewport( 0, 0, render_target_width_, render_target_height_ );
-		glBindFramebuffer( GL_READ_BUFFER, eye_buffers_[i].render_frame_buffer );
-		glBindFramebuffer( GL_DRAW_BUFFER, eye_buffers_[i].resolve_frame_buffer );
+		GLState::viewport( 0, 0, render_target_width_, render_target_height_ );
+		GLState::bindFramebuffer( GL_READ_BUFFER, eye_buffers_[i].render_frame_buffer );
+		GLState::bindFramebuffer( GL_DRAW_BUFFER, eye_buffers_[i].resolve_frame_buffer );
 		glBlitFramebuffer(
 			0, 0, render_target_width_, render_target_height_,
 			0, 0, render_target_width_, render_target_height_,
@@ -340,12 +433,23 @@ void VRSystem::submitEyeTextures()
 		// NOTE: to find out what the error codes mean Ctal+F 'enum EVRCompositorError' in 'openvr.h'
 		vr::EVRCompositorError error = vr::VRCompositorError_None;
 
-		vr::Texture_t left = { (void*)eye_buffers_[0].resolve_texture, vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
-		error = vr::VRCompositor()->Submit( vr::Eye_Left, &left, NULL );
+		// Without a late update the poses are the ones the compositor handed out, so it would assume them anyway
+		vr::EVRSubmitFlags flags = late_pose_update_ ? vr::Submit_TextureWithPose : vr::Submit_Default;
+
+		vr::VRTextureWithPose_t left;
+		left.handle = (void*)eye_buffers_[0].resolve_texture;
+		left.eType = vr::TextureType_OpenGL;
+		left.eColorSpace = vr::ColorSpace_Gamma;
+		left.mDeviceToAbsoluteTracking = eye_poses_[0];
+		error = vr::VRCompositor()->Submit( vr::Eye_Left, &left, NULL, flags );
 		if( error != vr::VRCompositorError_None ) std::cout << "ERROR: left eye  " << error << std::endl;
 
-		vr::Texture_t right = { (void*)eye_buffers_[1].resolve_texture, vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
-		error = vr::VRCompositor()->Submit( vr::Eye_Right, &right, NULL );
+		vr::VRTextureWithPose_t right;
+		right.handle = (void*)eye_buffers_[1].resolve_texture;
+		right.eType = vr::TextureType_OpenGL;
+		right.eColorSpace = vr::ColorSpace_Gamma;
+		right.mDeviceToAbsoluteTracking = eye_poses_[1];
+		error = vr::VRCompositor()->Submit( vr::Eye_Right, &right, NULL, flags );
 		if( error != vr::VRCompositorError_None ) std::cout << "ERROR: right eye " << error << std::endl;
 
 		// Added on advice from comments in IVRCompositor::submit in openvr.h
@@ -2,9 +2,12 @@
 #include <openvr.h>
 #include <glm.hpp>
 #include <string>
+#include <fstream>
+#include <chrono>
 #include <GL/glew.h>
 #include "shader_program.h"
 #include "controller.h"
+#include "render_model_cache.h"
 #include "move_tool.h"
 #include "point_light_tool.h"
 #include "pointer_tool.h"
@@ -21,17 +24,42 @@ public:
 	void manageDevices();
 	void updatePoses();
 	void updateDevices( float dt );
-	void render( const glm::mat4& view, const glm::mat4& projection );
+	void submit( RenderQueue& queue );
 	void bindEyeTexture( vr::EVREye eye );
 	void blitEyeTextures();
+	// Each eye goes with the HMD pose it was drawn from, so the compositor reprojects from the right place
 	void submitEyeTextures();
 
+	// Asks again for the HMD pose predicted for when this frame reaches the display, call just before drawing
+	// the eye. viewMatrix() follows the new pose for the rest of the frame. Does nothing unless it is enabled
+	void lateUpdateHmdPose( vr::Hmd_Eye eye );
+	// Seconds from now until the frame being drawn is lit up on the display, as worked out in updatePoses()
+	float secondsToPhotons();
+
+	// How far the head moved between updatePoses() and the most recent late update for an eye
+	struct LatePose {
+		bool valid = false;
+		float predicted_seconds = 0.0f;
+		float position_delta = 0.0f;     // Metres
+		float angle_delta = 0.0f;        // Degrees
+	};
+	const LatePose& latePose( vr::Hmd_Eye eye ) const { return late_poses_[(eye == vr::Eye_Left ? 0 : 1)]; }
+	void setLatePoseUpdate( bool enabled ) { late_pose_update_ = enabled; late_poses_[0] = late_poses_[1] = LatePose(); }
+	bool latePoseUpdate() const { return late_pose_update_; }
+	// Every late update is written to the file as a line of CSV, an empty path stops logging
+	bool setLatePoseLog( const std::string& filepath );
+	bool isLoggingLatePoses() const { return late_pose_log_.is_open(); }
+
 	/* GETTERS */
 	uint32_t renderTargetWidth() { return render_target_width_; }
 	uint32_t renderTargetHeight() { return render_target_height_; }
 	glm::mat4 projectionMartix( vr::Hmd_Eye eye );
 	glm::mat4 eyePoseMatrix( vr::Hmd_Eye eye );
 	glm::mat4 viewMatrix( vr::Hmd_Eye eye ) { return eyePoseMatrix( eye ) * deviceTransform( vr::k_unTrackedDeviceIndex_Hmd ); }
+	// Where the eye will be looking from 'seconds' after this frame's poses if the head keeps moving the same way
+	glm::mat4 predictedViewMatrix( vr::Hmd_Eye eye, float seconds ) { return eyePoseMatrix( eye ) * predictedDeviceTransform( vr::k_unTrackedDeviceIndex_Hmd, seconds ); }
+	// Same as deviceTransform() but extrapolated with the pose's velocity and angular velocity
+	glm::mat4 predictedDeviceTransform( uint32_t device, float seconds );
 	vr::IVRSystem* openVRVRSystem() { return vr_system_; }
 
 	MoveTool* moveTool() { return &move_tool_; }
@@ -41,6 +69,7 @@ public:
 	// Returns NULL if the controller is not ready
 	Controller* leftControler() { return left_controller_.isInitialised() ? &left_controller_ : nullptr; }
 	Controller* rightControler() { return right_controller_.isInitialised() ? &right_controller_ : nullptr; }
+	RenderModelCache* renderModels() { return &render_models_; }
 
 	std::string getDeviceString( vr::TrackedDeviceIndex_t device, vr::TrackedDeviceProperty prop, vr::TrackedPropertyError* error );
 
@@ -51,7 +80,7 @@ public:
 	inline GLuint resolveEyeTexture( vr::Hmd_Eye eye ) { return eye_buffers_[(eye == vr::Eye_Left ? 0 : 1)].resolve_frame_buffer; }
 
 	/* SETTERS */
-	void setPointCloud( PointCloud* point_cloud ) { point_cloud_ = point_cloud; }
+	void setPointCloud( PointCloud* point_cloud ) { point_cloud_ = point_cloud; pointer_tool_.setPointCloud( point_cloud ); }
 
 private:
 	// Singleton variables
@@ -62,7 +91,7 @@ private:
 	vr::IVRSystem* vr_system_;
 
 	/* PRIVATE FUNCTIONS */
-	void drawControllers( glm::mat4 view, glm::mat4 projection );
+	void submitControllers( RenderQueue& queue );
 
 	/* MEMBER VARIBALES */
 	PointCloud* point_cloud_;
@@ -70,6 +99,15 @@ private:
 	vr::TrackedDevicePose_t poses_[vr::k_unMaxTrackedDeviceCount];
 	glm::mat4 transforms_[vr::k_unMaxTrackedDeviceCount];
 
+	// Late pose updates, read once at init
+	float frame_duration_ = 1.0f / 90.0f;
+	float vsync_to_photons_ = 0.0f;
+	std::chrono::steady_clock::time_point photon_time_;   // When this frame will be seen, set in updatePoses()
+	bool late_pose_update_ = false;
+	LatePose late_poses_[2];
+	vr::HmdMatrix34_t eye_poses_[2];          // The HMD pose each eye was drawn from
+	std::ofstream late_pose_log_;
+
 	// Controllers
 	Controller left_controller_;
 	Controller right_controller_;
@@ -80,10 +118,9 @@ private:
 	PointerTool pointer_tool_;
 
 	// Controller rendering
+	RenderModelCache render_models_;
 	ShaderProgram controller_shader_;
 	GLint controller_shader_modl_mat_locaton_;
-	GLint controller_shader_view_mat_locaton_;
-	GLint controller_shader_proj_mat_locaton_;
 
 	// VR rendering
 	uint32_t render_target_width_;
@@ -1,4 +1,5 @@
 #include "window.h"
+#include "gl_state.h"
 
 #include <iostream>
 
@@ -124,14 +125,14 @@ bool Window::init()
 		};
 		GLushort indices[] = { 0, 1, 3, 0, 3, 2, 4, 5, 7, 4, 7, 6 };
 		glGenVertexArrays( 1, &vao_ );
-		glBindVertexArray( vao_ );
+		GLState::bindVertexArray( vao_ );
 		GLuint vbo;
 		glGenBuffers( 1, &vbo );
-		glBindBuffer( GL_ARRAY_BUFFER, vao_ );
+		GLState::bindBuffer( GL_ARRAY_BUFFER, vbo );
 		glBufferData( GL_ARRAY_BUFFER, sizeof( verts ), verts, GL_STATIC_DRAW );
 		GLuint ebo;
 		glGenBuffers( 1, &ebo );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebo );
+		GLState::bindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebo );
 		glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( indices ), indices, GL_STATIC_DRAW );
 		GLint posAttrib = window_shader_.getAttribLocation( "vPosition" );
 		glEnableVertexAttribArray( posAttrib );
@@ -146,23 +147,23 @@ bool Window::init()
 
 void Window::render( GLuint left_eye_texture, GLuint right_eye_texture )
 {
-	glDisable( GL_DEPTH_TEST );
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-	glViewport( 0, 0, width_, height_ );
-	glClearColor( 0.0f, 0.5f, 0.0f, 1.0f );
+	GLState::disable( GL_DEPTH_TEST );
+	GLState::bindFramebuffer( GL_FRAMEBUFFER, 0 );
+	GLState::viewport( 0, 0, width_, height_ );
+	GLState::clearColor( 0.0f, 0.5f, 0.0f, 1.0f );
 	glClear( GL_COLOR_BUFFER_BIT );
 
 	window_shader_.bind();
-	glBindVertexArray( vao_ );
+	GLState::bindVertexArray( vao_ );
 
-	glBindTexture( GL_TEXTURE_2D, left_eye_texture );
+	GLState::bindTexture( GL_TEXTURE_2D, left_eye_texture );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 	glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0 );
 
-	glBindTexture( GL_TEXTURE_2D, right_eye_texture );
+	GLState::bindTexture( GL_TEXTURE_2D, right_eye_texture );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
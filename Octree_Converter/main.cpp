@@ -0,0 +1,89 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include "octree_converter.h"
+
+// Converts a .ply scan into a LOD hierarchy directory the viewer can stream from.
+//	Octree_Converter <input.ply> <output directory> [options]
+//	--memory <MB>			rough memory budget, default 2048
+//	--threads <n>			threads subdividing chunks, default every core
+//	--chunk-points <n>		most points loaded at once for one chunk, lowered to fit the memory budget
+//	--leaf-points <n>		nodes with fewer points are not subdivided
+
+namespace
+{
+	void print_usage()
+	{
+		std::cout << "Usage: Octree_Converter <input.ply> <output directory> [--memory MB] [--threads n] [--chunk-points n] [--leaf-points n]" << std::endl;
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	if( argc < 3 )
+	{
+		print_usage();
+		return 1;
+	}
+
+	std::string input = argv[1];
+	std::string output = argv[2];
+	OctreeConverter::Settings settings;
+
+	for( int i = 3; i < argc; i++ )
+	{
+		if( i + 1 >= argc )
+		{
+			std::cout << "ERROR: '" << argv[i] << "' needs a value" << std::endl;
+			print_usage();
+			return 1;
+		}
+
+		unsigned long long value = strtoull( argv[i + 1], nullptr, 10 );
+		if( strcmp( argv[i], "--memory" ) == 0 ) settings.memory_mb = (size_t)value;
+		else if( strcmp( argv[i], "--threads" ) == 0 ) settings.threads = (unsigned int)value;
+		else if( strcmp( argv[i], "--chunk-points" ) == 0 ) settings.chunk_points = (size_t)value;
+		else if( strcmp( argv[i], "--leaf-points" ) == 0 ) settings.leaf_points = (size_t)value;
+		else
+		{
+			std::cout << "ERROR: unknown option '" << argv[i] << "'" << std::endl;
+			print_usage();
+			return 1;
+		}
+		i++;
+	}
+
+	if( settings.memory_mb == 0 || settings.chunk_points == 0 || settings.leaf_points == 0 )
+	{
+		std::cout << "ERROR: memory, chunk points and leaf points must be more than zero" << std::endl;
+		return 1;
+	}
+
+	OctreeConverter converter;
+	if( !converter.convert( input, output, settings ) )
+	{
+		std::cout << "ERROR: conversion failed" << std::endl;
+		return 1;
+	}
+
+	// Enough to size a machine for a conversion: how fast each pass went and the most memory used
+	const OctreeConverter::Stats& stats = converter.stats();
+	const char* pass_names[] = { "bounds", "counting", "distribution", "subdivision" };
+	double mb = stats.input_bytes / (1024.0 * 1024.0);
+
+	std::cout << "Converted " << stats.points << " points into " << stats.nodes << " nodes over " << stats.levels << " levels ("
+		<< stats.chunks << " chunks on " << stats.workers << " threads)" << std::endl;
+	for( int pass = 0; pass < 4; pass++ )
+	{
+		double seconds = stats.pass_ms[pass] / 1000.0;
+		std::cout << "\t" << pass_names[pass] << ": " << seconds << "s, " << (seconds > 0.0 ? stats.points / seconds / 1e6 : 0.0) << "M points/s";
+		if( pass < 3 ) std::cout << ", " << (seconds > 0.0 ? mb / seconds : 0.0) << "MB/s";
+		std::cout << std::endl;
+	}
+	double total = stats.total_ms / 1000.0;
+	std::cout << "Total: " << total << "s, " << (total > 0.0 ? stats.points / total / 1e6 : 0.0) << "M points/s" << std::endl;
+	std::cout << "Peak RSS: " << stats.peak_rss / (1024 * 1024) << "MB" << std::endl;
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,651 @@
+#include "octree_converter.h"
+#include "ply_stream.h"
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#else
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// The counting grid is 2^COUNT_LEVELS cells along each edge of the root
+	const uint32_t COUNT_LEVELS = 7;
+
+	// Each node's sampling grid is GRID cells along an edge, so its spacing is its size / GRID
+	const uint32_t GRID_BITS = 7;
+	const uint32_t GRID = 1 << GRID_BITS;
+	const size_t GRID_WORDS = (size_t(1) << (3 * GRID_BITS)) / 64;
+
+	// Three bits per level in a 64 bit code, also stops duplicate points subdividing forever
+	const uint32_t MAX_LEVEL = 19;
+
+	// Vertices read from the input at a time
+	const size_t READ_BLOCK = 1 << 16;
+
+	// Rough bytes per point while a chunk is subdivided, the points plus the children they are split into
+	const size_t BYTES_PER_CHUNK_POINT = 3 * sizeof( lod::Point );
+
+	// Chunks get three quarters of the memory, the rest is for the distribution buffers
+	size_t chunk_budget( size_t memory_mb )
+	{
+		return memory_mb * 1024 * 1024 * 3 / 4;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	double ms_since( Clock::time_point start )
+	{
+		return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+	}
+
+	bool make_directory( const std::string& path )
+	{
+#ifdef _WIN32
+		return _mkdir( path.c_str() ) == 0 || errno == EEXIST;
+#else
+		return mkdir( path.c_str(), 0755 ) == 0 || errno == EEXIST;
+#endif
+	}
+
+	void remove_directory( const std::string& path )
+	{
+#ifdef _WIN32
+		_rmdir( path.c_str() );
+#else
+		rmdir( path.c_str() );
+#endif
+	}
+
+	uint64_t pack_key( uint32_t level, uint64_t code )
+	{
+		return (uint64_t)level << 58 | code;
+	}
+
+	uint32_t grid_cell( float value, float lower, float scale )
+	{
+		int cell = (int)((value - lower) * scale);
+		return (uint32_t)std::min( (int)GRID - 1, std::max( 0, cell ) );
+	}
+}
+
+OctreeConverter::OctreeConverter()
+{
+
+}
+
+OctreeConverter::~OctreeConverter()
+{
+	if( blocks_ ) fclose( blocks_ );
+}
+
+bool OctreeConverter::convert( const std::string& input, const std::string& output_dir, const Settings& settings )
+{
+	Clock::time_point start = Clock::now();
+	settings_ = settings;
+	stats_ = Stats();
+
+	// Even with one worker a chunk bigger than the budget would break it, so the chunks are made small enough to fit
+	size_t budget_points = std::max<size_t>( 1, chunk_budget( settings_.memory_mb ) / BYTES_PER_CHUNK_POINT );
+	if( settings_.chunk_points > budget_points )
+	{
+		std::cout << "Chunks limited to " << budget_points << " points to fit in " << settings_.memory_mb << "MB" << std::endl;
+		settings_.chunk_points = budget_points;
+	}
+
+	output_dir_ = output_dir;
+	temp_dir_ = output_dir + "/tmp";
+	buckets_.clear();
+	written_.clear();
+	write_failed_ = false;
+
+	PlyStream ply;
+	if( !ply.open( input ) ) return false;
+	stats_.points = ply.numVertices();
+	stats_.input_bytes = ply.fileSize();
+
+	if( !make_directory( output_dir_ ) || !make_directory( temp_dir_ ) )
+	{
+		std::cout << "ERROR: could not create '" << temp_dir_ << "'" << std::endl;
+		return false;
+	}
+
+	// Nothing is left behind in the output directory if a pass fails
+	auto fail = [this]() {
+		remove_temp_files();
+		return false;
+	};
+
+	Clock::time_point pass = Clock::now();
+	if( !find_bounds( ply ) ) return fail();
+	stats_.pass_ms[0] = ms_since( pass );
+
+	pass = Clock::now();
+	if( !count_points( ply ) ) return fail();
+	stats_.pass_ms[1] = ms_since( pass );
+
+	pass = Clock::now();
+	blocks_ = fopen( (output_dir_ + "/" + lod::BLOCK_FILE).c_str(), "wb" );
+	if( !blocks_ )
+	{
+		std::cout << "ERROR: could not create '" << output_dir_ << "/" << lod::BLOCK_FILE << "'" << std::endl;
+		return fail();
+	}
+	blocks_size_ = 0;
+	if( !distribute_points( ply ) ) return fail();
+	stats_.pass_ms[2] = ms_since( pass );
+
+	// Nothing needs the input from here on
+	ply.close();
+	counts_.clear();
+	bucket_at_.clear();
+
+	pass = Clock::now();
+	bool processed = process_chunks();
+	stats_.pass_ms[3] = ms_since( pass );
+
+	fclose( blocks_ );
+	blocks_ = nullptr;
+	remove_temp_files();
+	if( !processed || !write_index() ) return false;
+
+	stats_.total_ms = ms_since( start );
+	stats_.peak_rss = peak_rss();
+	return true;
+}
+
+size_t OctreeConverter::peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) ) return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss;
+#else
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+bool OctreeConverter::find_bounds( PlyStream& ply )
+{
+	double lower[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	double upper[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+
+	std::vector<PlyStream::Vertex> vertices( READ_BLOCK );
+	uint64_t total = 0;
+	size_t count;
+	while( (count = ply.read( vertices.data(), READ_BLOCK )) > 0 )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			const double position[3] = { vertices[i].x, vertices[i].y, vertices[i].z };
+			for( int axis = 0; axis < 3; axis++ )
+			{
+				lower[axis] = std::min( lower[axis], position[axis] );
+				upper[axis] = std::max( upper[axis], position[axis] );
+			}
+		}
+		total += count;
+	}
+
+	if( total == 0 )
+	{
+		std::cout << "ERROR: no points to convert" << std::endl;
+		return false;
+	}
+	stats_.points = total;
+
+	// The root is a cube around the bounds
+	size_ = 0.0;
+	for( int axis = 0; axis < 3; axis++ )
+	{
+		offset_[axis] = lower[axis];
+		size_ = std::max( size_, upper[axis] - lower[axis] );
+	}
+	if( size_ <= 0.0 ) size_ = 1.0;
+
+	std::cout << "Bounds: " << total << " points, cube of " << size_ << " from (" << offset_[0] << ", " << offset_[1] << ", " << offset_[2] << ")" << std::endl;
+	return ply.rewind();
+}
+
+bool OctreeConverter::count_points( PlyStream& ply )
+{
+	counts_.assign( COUNT_LEVELS + 1, std::vector<uint64_t>() );
+	bucket_at_.assign( COUNT_LEVELS + 1, std::vector<int32_t>() );
+	for( uint32_t level = 0; level <= COUNT_LEVELS; level++ )
+	{
+		counts_[level].assign( size_t(1) << (3 * level), 0 );
+		bucket_at_[level].assign( size_t(1) << (3 * level), -1 );
+	}
+
+	const uint32_t cells = 1 << COUNT_LEVELS;
+	const double scale = cells / size_;
+	std::vector<uint64_t>& finest = counts_[COUNT_LEVELS];
+
+	std::vector<PlyStream::Vertex> vertices( READ_BLOCK );
+	size_t count;
+	while( (count = ply.read( vertices.data(), READ_BLOCK )) > 0 )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			uint32_t x = (uint32_t)std::min( cells - 1.0, std::max( 0.0, (vertices[i].x - offset_[0]) * scale ) );
+			uint32_t y = (uint32_t)std::min( cells - 1.0, std::max( 0.0, (vertices[i].y - offset_[1]) * scale ) );
+			uint32_t z = (uint32_t)std::min( cells - 1.0, std::max( 0.0, (vertices[i].z - offset_[2]) * scale ) );
+			finest[x + (y << COUNT_LEVELS) + (z << (2 * COUNT_LEVELS))]++;
+		}
+	}
+
+	// Sum the counts up to the root
+	for( uint32_t level = COUNT_LEVELS; level > 0; level-- )
+	{
+		uint32_t child_cells = 1 << level;
+		for( uint32_t z = 0; z < child_cells; z++ )
+		for( uint32_t y = 0; y < child_cells; y++ )
+		for( uint32_t x = 0; x < child_cells; x++ )
+		{
+			uint64_t n = counts_[level][x + (y << level) + (z << (2 * level))];
+			uint32_t parent_level = level - 1;
+			counts_[parent_level][(x >> 1) + ((y >> 1) << parent_level) + ((z >> 1) << (2 * parent_level))] += n;
+		}
+	}
+
+	plan_buckets( 0, 0, 0, 0, 0 );
+
+	stats_.chunks = 0;
+	uint64_t largest = 0;
+	for( auto& bucket : buckets_ )
+	{
+		if( !bucket.chunk ) continue;
+		stats_.chunks++;
+		largest = std::max( largest, bucket.expected_points );
+	}
+	std::cout << "Counting: " << buckets_.size() - stats_.chunks << " nodes above " << stats_.chunks << " chunks, largest chunk " << largest << " points" << std::endl;
+	if( largest > settings_.chunk_points )
+	{
+		std::cout << "WARNING: some chunks are denser than the counting grid can split, they will use more memory than planned" << std::endl;
+	}
+
+	// Share a quarter of the memory between the distribution buffers
+	size_t buffer_bytes = settings_.memory_mb * 1024 * 1024 / 4;
+	bucket_capacity_ = buffer_bytes / (sizeof( lod::Point ) * buckets_.size());
+	bucket_capacity_ = std::min( (size_t)1 << 20, std::max( (size_t)1024, bucket_capacity_ ) );
+
+	return ply.rewind();
+}
+
+void OctreeConverter::plan_buckets( uint32_t level, uint32_t x, uint32_t y, uint32_t z, uint64_t code )
+{
+	size_t cell = x + ((size_t)y << level) + ((size_t)z << (2 * level));
+	uint64_t count = counts_[level][cell];
+	if( count == 0 ) return;
+
+	Bucket bucket;
+	bucket.key = NodeKey{ level, code };
+	bucket.chunk = count <= settings_.chunk_points || level == COUNT_LEVELS;
+	bucket.expected_points = count;
+	if( !bucket.chunk ) bucket.occupied.assign( GRID_WORDS, 0 );
+
+	bucket_at_[level][cell] = (int32_t)buckets_.size();
+	buckets_.push_back( std::move( bucket ) );
+
+	if( buckets_.back().chunk ) return;
+	for( uint32_t octant = 0; octant < 8; octant++ )
+	{
+		plan_buckets( level + 1, x * 2 + (octant & 1), y * 2 + ((octant >> 1) & 1), z * 2 + (octant >> 2), code << 3 | octant );
+	}
+}
+
+bool OctreeConverter::distribute_points( PlyStream& ply )
+{
+	const uint32_t cells = 1 << COUNT_LEVELS;
+	const double scale = cells / size_;
+
+	std::vector<PlyStream::Vertex> vertices( READ_BLOCK );
+	uint64_t done = 0;
+	int last_percent = 0;
+	size_t count;
+	while( (count = ply.read( vertices.data(), READ_BLOCK )) > 0 )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			const PlyStream::Vertex& v = vertices[i];
+			lod::Point point = { (float)(v.x - offset_[0]), (float)(v.y - offset_[1]), (float)(v.z - offset_[2]), v.r, v.g, v.b, 255 };
+
+			uint32_t x = (uint32_t)std::min( cells - 1.0, std::max( 0.0, (v.x - offset_[0]) * scale ) );
+			uint32_t y = (uint32_t)std::min( cells - 1.0, std::max( 0.0, (v.y - offset_[1]) * scale ) );
+			uint32_t z = (uint32_t)std::min( cells - 1.0, std::max( 0.0, (v.z - offset_[2]) * scale ) );
+
+			// Walk down from the root until a node keeps the point or it reaches its chunk
+			for( uint32_t level = 0; level <= COUNT_LEVELS; level++ )
+			{
+				uint32_t shift = COUNT_LEVELS - level;
+				size_t cell = (x >> shift) + ((size_t)(y >> shift) << level) + ((size_t)(z >> shift) << (2 * level));
+				size_t index = (size_t)bucket_at_[level][cell];
+				Bucket& bucket = buckets_[index];
+
+				if( !bucket.chunk )
+				{
+					float lower[3], node_size;
+					node_bounds( bucket.key, lower, node_size );
+					float grid_scale = GRID / node_size;
+
+					uint32_t sample = grid_cell( point.x, lower[0], grid_scale )
+						| grid_cell( point.y, lower[1], grid_scale ) << GRID_BITS
+						| grid_cell( point.z, lower[2], grid_scale ) << (2 * GRID_BITS);
+
+					uint64_t bit = (uint64_t)1 << (sample & 63);
+					if( bucket.occupied[sample >> 6] & bit ) continue;
+					bucket.occupied[sample >> 6] |= bit;
+				}
+
+				bucket.buffer.push_back( point );
+				if( bucket.buffer.size() >= bucket_capacity_ && !flush_bucket( index ) ) return false;
+				break;
+			}
+		}
+
+		done += count;
+		int percent = (int)(done * 100 / stats_.points);
+		if( percent / 10 > last_percent / 10 )
+		{
+			std::cout << "Distributing: " << percent << "%" << std::endl;
+		}
+		last_percent = percent;
+	}
+
+	for( size_t i = 0; i < buckets_.size(); i++ )
+	{
+		if( !flush_bucket( i ) ) return false;
+	}
+	return true;
+}
+
+bool OctreeConverter::flush_bucket( size_t index )
+{
+	Bucket& bucket = buckets_[index];
+	if( bucket.buffer.empty() ) return true;
+
+	FILE* file = fopen( bucket_path( index ).c_str(), "ab" );
+	bool written = file && fwrite( bucket.buffer.data(), sizeof( lod::Point ), bucket.buffer.size(), file ) == bucket.buffer.size();
+	if( file ) fclose( file );
+
+	if( !written )
+	{
+		std::cout << "ERROR: could not write '" << bucket_path( index ) << "', is the disk full?" << std::endl;
+		return false;
+	}
+
+	bucket.points_written += bucket.buffer.size();
+	std::vector<lod::Point>().swap( bucket.buffer );
+	return true;
+}
+
+bool OctreeConverter::process_chunks()
+{
+	unsigned int threads = settings_.threads ? settings_.threads : std::max( 1u, std::thread::hardware_concurrency() );
+	size_t chunk_bytes = settings_.chunk_points * BYTES_PER_CHUNK_POINT;
+	size_t budget = chunk_budget( settings_.memory_mb );
+	unsigned int workers = (unsigned int)std::max<size_t>( 1, std::min<size_t>( threads, budget / std::max<size_t>( 1, chunk_bytes ) ) );
+	stats_.workers = workers;
+
+	std::vector<size_t> chunks;
+	for( size_t i = 0; i < buckets_.size(); i++ )
+	{
+		if( buckets_[i].points_written == 0 ) continue;
+		if( buckets_[i].chunk ) chunks.push_back( i );
+		else
+		{
+			// Nodes above the chunks were sampled as the points went past, they are ready to write
+			std::vector<lod::Point> points( buckets_[i].points_written );
+			FILE* file = fopen( bucket_path( i ).c_str(), "rb" );
+			bool read = file && fread( points.data(), sizeof( lod::Point ), points.size(), file ) == points.size();
+			if( file ) fclose( file );
+			remove( bucket_path( i ).c_str() );
+
+			if( !read || !write_node( buckets_[i].key, points ) ) return false;
+			std::vector<uint64_t>().swap( buckets_[i].occupied );
+		}
+	}
+
+	// Biggest first so one large chunk doesn't leave the other threads idle at the end
+	std::sort( chunks.begin(), chunks.end(), [this]( size_t a, size_t b ) {
+		return buckets_[a].points_written > buckets_[b].points_written;
+	} );
+
+	// Chunks whose points were all kept by the nodes above them have nothing left to subdivide
+	stats_.chunks = (uint32_t)chunks.size();
+	std::cout << "Subdividing " << chunks.size() << " chunks on " << workers << " threads" << std::endl;
+
+	// Only a chunk the counting grid couldn't split can be this big, it still has to be loaded whole
+	size_t largest_bytes = chunks.empty() ? 0 : buckets_[chunks.front()].points_written * BYTES_PER_CHUNK_POINT;
+	if( largest_bytes > budget )
+	{
+		std::cout << "WARNING: the largest chunk needs about " << largest_bytes / (1024 * 1024) << "MB, over the " << settings_.memory_mb << "MB budget" << std::endl;
+	}
+
+	std::atomic<size_t> next{ 0 };
+	std::atomic<bool> failed{ false };
+	auto work = [&]() {
+		std::vector<uint64_t> occupied( GRID_WORDS );
+		size_t c;
+		while( !failed && (c = next++) < chunks.size() )
+		{
+			size_t index = chunks[c];
+			std::vector<lod::Point> points( buckets_[index].points_written );
+
+			FILE* file = fopen( bucket_path( index ).c_str(), "rb" );
+			bool read = file && fread( points.data(), sizeof( lod::Point ), points.size(), file ) == points.size();
+			if( file ) fclose( file );
+			remove( bucket_path( index ).c_str() );
+
+			if( !read )
+			{
+				std::cout << "ERROR: could not read back '" << bucket_path( index ) << "'" << std::endl;
+				failed = true;
+				break;
+			}
+
+			// Points arrive in scan order, shuffle them so keeping the first in each cell is an even sample
+			std::mt19937 random( (unsigned int)index );
+			std::shuffle( points.begin(), points.end(), random );
+
+			subdivide( points, buckets_[index].key, occupied );
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for( unsigned int t = 1; t < workers; t++ ) pool.push_back( std::thread( work ) );
+	work();
+	for( auto& thread : pool ) thread.join();
+
+	return !failed && !write_failed_;
+}
+
+void OctreeConverter::subdivide( std::vector<lod::Point>& points, NodeKey key, std::vector<uint64_t>& occupied )
+{
+	if( points.size() <= settings_.leaf_points || key.level >= MAX_LEVEL )
+	{
+		write_node( key, points );
+		return;
+	}
+
+	float lower[3], size;
+	node_bounds( key, lower, size );
+	float scale = GRID / size;
+	std::fill( occupied.begin(), occupied.end(), 0 );
+
+	std::vector<lod::Point> kept;
+	std::vector<lod::Point> children[8];
+	for( auto& p : points )
+	{
+		uint32_t x = grid_cell( p.x, lower[0], scale );
+		uint32_t y = grid_cell( p.y, lower[1], scale );
+		uint32_t z = grid_cell( p.z, lower[2], scale );
+		uint32_t sample = x | y << GRID_BITS | z << (2 * GRID_BITS);
+
+		uint64_t bit = (uint64_t)1 << (sample & 63);
+		if( !(occupied[sample >> 6] & bit) )
+		{
+			occupied[sample >> 6] |= bit;
+			kept.push_back( p );
+		}
+		else
+		{
+			// The upper half of the grid is the upper child, so points agree with the child's own grid
+			uint32_t octant = (x >> (GRID_BITS - 1)) | (y >> (GRID_BITS - 1)) << 1 | (z >> (GRID_BITS - 1)) << 2;
+			children[octant].push_back( p );
+		}
+	}
+	std::vector<lod::Point>().swap( points );
+
+	write_node( key, kept );
+	std::vector<lod::Point>().swap( kept );
+
+	for( uint32_t octant = 0; octant < 8; octant++ )
+	{
+		if( children[octant].empty() ) continue;
+		subdivide( children[octant], NodeKey{ key.level + 1, key.code << 3 | octant }, occupied );
+	}
+}
+
+bool OctreeConverter::write_node( NodeKey key, const std::vector<lod::Point>& points )
+{
+	if( points.empty() ) return true;
+
+	std::lock_guard<std::mutex> lock( output_mutex_ );
+	if( fwrite( points.data(), sizeof( lod::Point ), points.size(), blocks_ ) != points.size() )
+	{
+		if( !write_failed_ ) std::cout << "ERROR: could not write node blocks, is the disk full?" << std::endl;
+		write_failed_ = true;
+		return false;
+	}
+
+	written_.push_back( WrittenNode{ key, blocks_size_, (uint32_t)points.size() } );
+	blocks_size_ += points.size() * sizeof( lod::Point );
+	return true;
+}
+
+bool OctreeConverter::write_index()
+{
+	// Breadth first, so parents always come before their children
+	std::sort( written_.begin(), written_.end(), []( const WrittenNode& a, const WrittenNode& b ) {
+		return a.key.level != b.key.level ? a.key.level < b.key.level : a.key.code < b.key.code;
+	} );
+
+	std::unordered_map<uint64_t, int32_t> index_of;
+	std::vector<lod::NodeRecord> records( written_.size() );
+	uint64_t total = 0;
+	uint32_t max_level = 0;
+	for( size_t i = 0; i < written_.size(); i++ )
+	{
+		const WrittenNode& node = written_[i];
+		lod::NodeRecord& record = records[i];
+
+		record.offset = node.offset;
+		record.num_points = node.num_points;
+		record.level = node.key.level;
+		record.parent = lod::NO_NODE;
+		for( auto& child : record.children ) child = lod::NO_NODE;
+		node_bounds( node.key, record.lower, record.size );
+
+		if( node.key.level > 0 )
+		{
+			auto parent = index_of.find( pack_key( node.key.level - 1, node.key.code >> 3 ) );
+			if( parent == index_of.end() )
+			{
+				std::cout << "ERROR: node at level " << node.key.level << " has no parent" << std::endl;
+				return false;
+			}
+			record.parent = parent->second;
+			records[parent->second].children[node.key.code & 7] = (int32_t)i;
+		}
+
+		index_of[pack_key( node.key.level, node.key.code )] = (int32_t)i;
+		total += node.num_points;
+		max_level = std::max( max_level, node.key.level );
+	}
+
+	if( total != stats_.points )
+	{
+		std::cout << "ERROR: wrote " << total << " of " << stats_.points << " points" << std::endl;
+		return false;
+	}
+
+	lod::IndexHeader header;
+	memset( &header, 0, sizeof( header ) );
+	header.magic = lod::MAGIC;
+	header.version = lod::VERSION;
+	header.num_points = total;
+	header.num_nodes = (uint32_t)records.size();
+	header.max_level = max_level;
+	for( int axis = 0; axis < 3; axis++ ) header.offset[axis] = offset_[axis];
+	header.size = (float)size_;
+	header.spacing = (float)size_ / GRID;
+
+	std::string path = output_dir_ + "/" + lod::INDEX_FILE;
+	FILE* file = fopen( path.c_str(), "wb" );
+	bool written = file
+		&& fwrite( &header, sizeof( header ), 1, file ) == 1
+		&& fwrite( records.data(), sizeof( lod::NodeRecord ), records.size(), file ) == records.size();
+	if( file ) fclose( file );
+
+	if( !written )
+	{
+		std::cout << "ERROR: could not write '" << path << "'" << std::endl;
+		return false;
+	}
+
+	stats_.nodes = header.num_nodes;
+	stats_.levels = max_level + 1;
+	return true;
+}
+
+void OctreeConverter::node_bounds( NodeKey key, float lower[3], float& size ) const
+{
+	uint32_t cell[3] = { 0, 0, 0 };
+	for( uint32_t level = 0; level < key.level; level++ )
+	{
+		uint32_t octant = (key.code >> (3 * (key.level - 1 - level))) & 7;
+		cell[0] = cell[0] * 2 + (octant & 1);
+		cell[1] = cell[1] * 2 + ((octant >> 1) & 1);
+		cell[2] = cell[2] * 2 + (octant >> 2);
+	}
+
+	double node_size = size_ / (double)((uint64_t)1 << key.level);
+	for( int axis = 0; axis < 3; axis++ ) lower[axis] = (float)(cell[axis] * node_size);
+	size = (float)node_size;
+}
+
+void OctreeConverter::remove_temp_files()
+{
+	for( size_t i = 0; i < buckets_.size(); i++ )
+	{
+		remove( bucket_path( i ).c_str() );
+	}
+	remove_directory( temp_dir_ );
+}
+
+std::string OctreeConverter::bucket_path( size_t index ) const
+{
+	return temp_dir_ + "/bucket_" + std::to_string( index ) + ".bin";
+}
\ No newline at end of file
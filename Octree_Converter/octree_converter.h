@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include "lod_format.h"
+
+class PlyStream;
+
+// Converts a .ply file of any size into the LOD hierarchy described in lod_format.h, never holding
+// more than a bounded number of points in memory. The input is read three times:
+//	1. bounds, to fit the root cube
+//	2. counting, points per cell of a fixed grid, which decides where the tree is cut into chunks
+//	   small enough to fit in memory
+//	3. distribution, each point is either kept by one of the nodes above the chunks or appended to
+//	   its chunk's file on disk
+// The chunks are then loaded and subdivided independently on as many threads as the memory budget
+// allows. Every node keeps the first point to land in each cell of a GRID^3 grid over its cube and
+// passes the rest down, nodes with few enough points left become leaves and keep them all.
+
+class OctreeConverter
+{
+public:
+	OctreeConverter();
+	~OctreeConverter();
+
+	struct Settings {
+		size_t memory_mb = 2048;		// Rough limit for the point buffers and chunks in memory at once
+		unsigned int threads = 0;		// Zero uses every core
+		size_t chunk_points = 4000000;	// Most points loaded for a single chunk, lowered to fit in memory_mb
+		size_t leaf_points = 20000;		// Nodes with fewer points than this aren't subdivided
+	};
+
+	struct Stats {
+		uint64_t points = 0;
+		uint64_t input_bytes = 0;
+		uint32_t nodes = 0;
+		uint32_t chunks = 0;
+		uint32_t levels = 0;
+		unsigned int workers = 0;
+		double pass_ms[4] = { 0.0 };	// Bounds, counting, distribution, chunk subdivision
+		double total_ms = 0.0;
+		size_t peak_rss = 0;			// Bytes
+	};
+
+	// Returns false if the input can't be read or the output can't be written
+	bool convert( const std::string& input, const std::string& output_dir, const Settings& settings );
+
+	const Stats& stats() const { return stats_; }
+
+	// Largest resident set the process has had so far in bytes, zero where it can't be measured
+	static size_t peak_rss();
+
+protected:
+	// Nodes are named by their level and the octants taken to reach them from the root, three bits per level
+	struct NodeKey {
+		uint32_t level;
+		uint64_t code;
+	};
+
+	struct WrittenNode {
+		NodeKey key;
+		uint64_t offset;
+		uint32_t num_points;
+	};
+
+	// A node above the chunks, or a chunk. Points bound for one are buffered then appended to a temporary file
+	struct Bucket {
+		NodeKey key;
+		bool chunk;
+		uint64_t expected_points;
+		std::vector<uint64_t> occupied;		// Sampling grid, only used above the chunks
+		std::vector<lod::Point> buffer;
+		uint64_t points_written = 0;
+	};
+
+	bool find_bounds( PlyStream& ply );
+	bool count_points( PlyStream& ply );
+	void plan_buckets( uint32_t level, uint32_t x, uint32_t y, uint32_t z, uint64_t code );
+	bool distribute_points( PlyStream& ply );
+	bool flush_bucket( size_t index );
+	bool process_chunks();
+	void subdivide( std::vector<lod::Point>& points, NodeKey key, std::vector<uint64_t>& occupied );
+	bool write_node( NodeKey key, const std::vector<lod::Point>& points );
+	bool write_index();
+
+	void node_bounds( NodeKey key, float lower[3], float& size ) const;
+	std::string bucket_path( size_t index ) const;
+	// Deletes every bucket's file and the temporary directory, whether or not they were made
+	void remove_temp_files();
+
+	Settings settings_;
+	Stats stats_;
+	std::string output_dir_;
+	std::string temp_dir_;
+
+	double offset_[3] = { 0.0 };
+	double size_ = 0.0;
+
+	// Point counts for every cell of every level down to COUNT_LEVELS, and which bucket owns each cell
+	std::vector<std::vector<uint64_t>> counts_;
+	std::vector<std::vector<int32_t>> bucket_at_;
+	std::vector<Bucket> buckets_;
+	size_t bucket_capacity_ = 0;
+
+	std::mutex output_mutex_;
+	FILE* blocks_ = nullptr;
+	uint64_t blocks_size_ = 0;
+	std::vector<WrittenNode> written_;
+	bool write_failed_ = false;
+};
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "ply_stream.h"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define ftell64 _ftelli64
+#define fseek64 _fseeki64
+#else
+#define ftell64 ftello
+#define fseek64 fseeko
+#endif
+
+namespace
+{
+	// Vertices decoded from each read of the file
+	const size_t BUFFER_VERTICES = 1 << 16;
+
+	size_t scalar_size( int type )
+	{
+		static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+		return sizes[type];
+	}
+
+	bool read_line( FILE* file, std::string& line )
+	{
+		line.clear();
+		int c;
+		while( (c = fgetc( file )) != EOF && c != '\n' )
+		{
+			if( c != '\r' ) line.push_back( (char)c );
+		}
+		return c != EOF || !line.empty();
+	}
+
+	uint8_t to_byte( double value )
+	{
+		return (uint8_t)std::min( 255.0, std::max( 0.0, value + 0.5 ) );
+	}
+}
+
+PlyStream::PlyStream()
+{
+
+}
+
+PlyStream::~PlyStream()
+{
+	close();
+}
+
+bool PlyStream::open( const std::string& filepath )
+{
+	close();
+	filepath_ = filepath;
+
+	file_ = fopen( filepath.c_str(), "rb" );
+	if( !file_ )
+	{
+		std::cout << "ERROR: could not open '" << filepath << "'" << std::endl;
+		return false;
+	}
+
+	fseek64( file_, 0, SEEK_END );
+	file_size_ = ftell64( file_ );
+	fseek64( file_, 0, SEEK_SET );
+
+	std::string line;
+	read_line( file_, line );
+	if( line != "ply" )
+	{
+		std::cout << "ERROR: unknown file type '" << filepath << "'" << std::endl;
+		close();
+		return false;
+	}
+
+	// Only the properties of the vertex element matter, they have to come before any other element's data
+	bool in_vertex = false;
+	bool seen_vertex = false;
+	while( line != "end_header" )
+	{
+		if( !read_line( file_, line ) )
+		{
+			std::cout << "ERROR: header of '" << filepath << "' never ends" << std::endl;
+			close();
+			return false;
+		}
+		std::stringstream stream( line );
+
+		std::string identifier;
+		stream >> identifier;
+
+		if( identifier == "format" )
+		{
+			std::string type;
+			stream >> type;
+
+			if( type == "ascii" ) binary_ = false;
+			else if( type == "binary_little_endian" ) binary_ = true;
+			else if( type == "binary_big_endian" ) binary_ = swap_endian_ = true;
+			else
+			{
+				std::cout << "ERROR: unknown data format: '" << type << "'" << std::endl;
+				close();
+				return false;
+			}
+		}
+		else if( identifier == "element" )
+		{
+			std::string type;
+			uint64_t count = 0;
+			stream >> type >> count;
+
+			in_vertex = type == "vertex";
+			if( in_vertex ) num_vertices_ = count, seen_vertex = true;
+			else if( !seen_vertex && count > 0 )
+			{
+				std::cout << "ERROR: '" << filepath << "' has '" << type << "' data before the vertices" << std::endl;
+				close();
+				return false;
+			}
+		}
+		else if( identifier == "property" && in_vertex )
+		{
+			std::string type_name, name;
+			stream >> type_name >> name;
+
+			ScalarType type;
+			if( type_name == "list" || !parse_scalar_type( type_name, type ) )
+			{
+				std::cout << "ERROR: unsupported vertex property '" << line << "'" << std::endl;
+				close();
+				return false;
+			}
+
+			PropertyIdent ident = PropertyIdent::discard;
+			if( name == "x" ) ident = PropertyIdent::x;
+			else if( name == "y" ) ident = PropertyIdent::y;
+			else if( name == "z" ) ident = PropertyIdent::z;
+			else if( name == "r" || name == "red" || name == "diffuse_red" ) ident = PropertyIdent::r;
+			else if( name == "g" || name == "green" || name == "diffuse_green" ) ident = PropertyIdent::g;
+			else if( name == "b" || name == "blue" || name == "diffuse_blue" ) ident = PropertyIdent::b;
+
+			// Float colours are 0 to 1 like the ones PlyWriter makes, integer colours are 0 to 255
+			if( ident == PropertyIdent::r ) float_colour_ = type == ScalarType::float32 || type == ScalarType::float64;
+
+			properties_.push_back( VertexProperty{ ident, type, vertex_size_ } );
+			vertex_size_ += scalar_size( (int)type );
+		}
+	}
+
+	if( !seen_vertex || properties_.empty() )
+	{
+		std::cout << "ERROR: '" << filepath << "' has no vertices" << std::endl;
+		close();
+		return false;
+	}
+
+	data_start_ = ftell64( file_ );
+	vertices_read_ = 0;
+	buffer_.resize( BUFFER_VERTICES * vertex_size_ );
+
+	std::cout << "Opened '" << filepath << "', " << num_vertices_ << " vertices, " << file_size_ / (1024 * 1024) << "MB, "
+		<< (binary_ ? "binary" : "ascii") << std::endl;
+	return true;
+}
+
+void PlyStream::close()
+{
+	if( file_ ) fclose( file_ );
+	file_ = nullptr;
+	properties_.clear();
+	buffer_.clear();
+	binary_ = swap_endian_ = float_colour_ = false;
+	num_vertices_ = vertices_read_ = 0;
+	vertex_size_ = 0;
+}
+
+bool PlyStream::rewind()
+{
+	if( !file_ ) return false;
+
+	vertices_read_ = 0;
+	return fseek64( file_, data_start_, SEEK_SET ) == 0;
+}
+
+size_t PlyStream::read( Vertex* out, size_t max )
+{
+	if( !file_ ) return 0;
+	max = (size_t)std::min<uint64_t>( max, num_vertices_ - vertices_read_ );
+
+	size_t count = 0;
+	if( !binary_ )
+	{
+		while( count < max && read_ascii_vertex( out[count] ) ) count++;
+	}
+	else while( count < max )
+	{
+		size_t batch = std::min( max - count, BUFFER_VERTICES );
+		size_t got = fread( buffer_.data(), vertex_size_, batch, file_ );
+
+		for( size_t i = 0; i < got; i++ )
+		{
+			const unsigned char* vertex = &buffer_[i * vertex_size_];
+			Vertex& v = out[count + i];
+			v.x = v.y = v.z = 0.0;
+			v.r = v.g = v.b = 255;
+
+			for( auto& p : properties_ )
+			{
+				if( p.ident == PropertyIdent::discard ) continue;
+
+				double value = decode( vertex + p.offset, p.type );
+				switch( p.ident )
+				{
+				case PropertyIdent::x: v.x = value; break;
+				case PropertyIdent::y: v.y = value; break;
+				case PropertyIdent::z: v.z = value; break;
+				case PropertyIdent::r: v.r = to_byte( float_colour_ ? value * 255.0 : value ); break;
+				case PropertyIdent::g: v.g = to_byte( float_colour_ ? value * 255.0 : value ); break;
+				case PropertyIdent::b: v.b = to_byte( float_colour_ ? value * 255.0 : value ); break;
+				case PropertyIdent::discard: break;
+				}
+			}
+		}
+
+		count += got;
+		if( got < batch ) break;
+	}
+
+	if( count < max )
+	{
+		std::cout << "ERROR: '" << filepath_ << "' ended after " << vertices_read_ + count << " of " << num_vertices_ << " vertices" << std::endl;
+	}
+
+	vertices_read_ += count;
+	return count;
+}
+
+bool PlyStream::parse_scalar_type( const std::string& name, ScalarType& type ) const
+{
+	if( name == "char" || name == "int8" ) type = ScalarType::int8;
+	else if( name == "uchar" || name == "uint8" ) type = ScalarType::uint8;
+	else if( name == "short" || name == "int16" ) type = ScalarType::int16;
+	else if( name == "ushort" || name == "uint16" ) type = ScalarType::uint16;
+	else if( name == "int" || name == "int32" ) type = ScalarType::int32;
+	else if( name == "uint" || name == "uint32" ) type = ScalarType::uint32;
+	else if( name == "float" || name == "float32" ) type = ScalarType::float32;
+	else if( name == "double" || name == "float64" ) type = ScalarType::float64;
+	else return false;
+	return true;
+}
+
+double PlyStream::decode( const unsigned char* bytes, ScalarType type ) const
+{
+	unsigned char value[8];
+	size_t size = scalar_size( (int)type );
+	if( swap_endian_ ) for( size_t i = 0; i < size; i++ ) value[i] = bytes[size - 1 - i];
+	else memcpy( value, bytes, size );
+
+	switch( type )
+	{
+	case ScalarType::int8: { int8_t v; memcpy( &v, value, 1 ); return v; }
+	case ScalarType::uint8: return value[0];
+	case ScalarType::int16: { int16_t v; memcpy( &v, value, 2 ); return v; }
+	case ScalarType::uint16: { uint16_t v; memcpy( &v, value, 2 ); return v; }
+	case ScalarType::int32: { int32_t v; memcpy( &v, value, 4 ); return v; }
+	case ScalarType::uint32: { uint32_t v; memcpy( &v, value, 4 ); return v; }
+	case ScalarType::float32: { float v; memcpy( &v, value, 4 ); return v; }
+	case ScalarType::float64: { double v; memcpy( &v, value, 8 ); return v; }
+	}
+	return 0.0;
+}
+
+bool PlyStream::read_ascii_vertex( Vertex& out )
+{
+	out.x = out.y = out.z = 0.0;
+	out.r = out.g = out.b = 255;
+
+	for( auto& p : properties_ )
+	{
+		double value;
+		if( fscanf( file_, "%lf", &value ) != 1 ) return false;
+
+		switch( p.ident )
+		{
+		case PropertyIdent::x: out.x = value; break;
+		case PropertyIdent::y: out.y = value; break;
+		case PropertyIdent::z: out.z = value; break;
+		case PropertyIdent::r: out.r = to_byte( float_colour_ ? value * 255.0 : value ); break;
+		case PropertyIdent::g: out.g = to_byte( float_colour_ ? value * 255.0 : value ); break;
+		case PropertyIdent::b: out.b = to_byte( float_colour_ ? value * 255.0 : value ); break;
+		case PropertyIdent::discard: break;
+		}
+	}
+	return true;
+}
\ No newline at end of file
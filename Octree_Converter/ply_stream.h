@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+// Reads the vertices of a .ply file a block at a time so files far larger than memory can be
+// passed over as often as needed. Unlike PlyLoader positions stay in double precision and any
+// scalar property type is understood, big scans are often stored with double or int positions.
+
+class PlyStream
+{
+public:
+	PlyStream();
+	~PlyStream();
+
+	struct Vertex {
+		double x, y, z;
+		uint8_t r, g, b;
+	};
+
+	// Parses the header, returns false if the file can't be opened or read
+	bool open( const std::string& filepath );
+	void close();
+
+	// Goes back to the first vertex
+	bool rewind();
+
+	// Reads up to 'max' vertices into 'out', returns how many were read. Zero means the end of the file
+	size_t read( Vertex* out, size_t max );
+
+	// Getters
+	uint64_t numVertices() const { return num_vertices_; }
+	uint64_t fileSize() const { return file_size_; }
+	uint64_t vertexBytes() const { return num_vertices_ * vertex_size_; }
+
+protected:
+	enum class PropertyIdent { discard, x, y, z, r, g, b };
+	enum class ScalarType { int8, uint8, int16, uint16, int32, uint32, float32, float64 };
+
+	struct VertexProperty {
+		PropertyIdent ident;
+		ScalarType type;
+		size_t offset;
+	};
+
+	bool parse_scalar_type( const std::string& name, ScalarType& type ) const;
+	double decode( const unsigned char* bytes, ScalarType type ) const;
+	bool read_ascii_vertex( Vertex& out );
+
+	FILE* file_ = nullptr;
+	std::string filepath_;
+	std::vector<VertexProperty> properties_;
+	std::vector<unsigned char> buffer_;
+	bool binary_ = false;
+	bool swap_endian_ = false;
+	bool float_colour_ = false;
+	long long data_start_ = 0;
+	uint64_t file_size_ = 0;
+	uint64_t num_vertices_ = 0;
+	uint64_t vertices_read_ = 0;
+	size_t vertex_size_ = 0;
+};
\ No newline at end of file